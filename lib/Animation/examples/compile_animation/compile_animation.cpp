@@ -0,0 +1,58 @@
+/**
+ * Compiles a keyframe script into a binary animation.
+ *
+ * Usage: compile_animation <script> <animation> [clocks] [steps per revolution] [frame period in us]
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <AnimationCompiler.h>
+
+int main(int argc, char **argv)
+{
+  if (argc < 3)
+  {
+    fprintf(stderr, "Usage: %s <script> <animation> [clocks] [steps per revolution] [frame period in us]\n", argv[0]);
+    return 1;
+  }
+
+  size_t clocks = argc > 3 ? strtoul(argv[3], NULL, 10) : 24;
+  size_t steps = argc > 4 ? strtoul(argv[4], NULL, 10) : 3414;
+  unsigned long frame_period = argc > 5 ? strtoul(argv[5], NULL, 10) : 1100;
+  if (frame_period == 0 || frame_period > UINT16_MAX)
+  {
+    fprintf(stderr, "Frame period must be between 1 and %u us\n", UINT16_MAX);
+    return 1;
+  }
+
+  FILE *script = fopen(argv[1], "r");
+  if (script == NULL)
+  {
+    perror(argv[1]);
+    return 1;
+  }
+
+  FILE *output = fopen(argv[2], "wb");
+  if (output == NULL)
+  {
+    perror(argv[2]);
+    fclose(script);
+    return 1;
+  }
+
+  AnimationCompiler compiler(clocks, steps, frame_period);
+  AnimationWriter writer(output, clocks, frame_period);
+  bool success = writer.begin() && compiler.compileScript(script, writer) && writer.end();
+
+  fclose(script);
+  fclose(output);
+
+  if (!success)
+  {
+    fprintf(stderr, "Failed to compile %s\n", argv[1]);
+    return 1;
+  }
+
+  printf("%u frames\n", writer.getFrameCount());
+  return 0;
+}
@@ -0,0 +1,204 @@
+#include "AnimationCompiler.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCRIPT_MAX_LINE 2048
+
+AnimationCompiler::AnimationCompiler(size_t clocks, size_t steps_per_revolution, uint16_t frame_period)
+    : planner(clocks, steps_per_revolution)
+{
+  this->clocks = clocks > MAX_CHAIN_LENGTH ? MAX_CHAIN_LENGTH : clocks;
+  this->frame_period = frame_period;
+  for (size_t i = 0; i < MAX_CHAIN_LENGTH * 2; i++)
+  {
+    this->positions[i] = 0;
+  }
+}
+
+/**
+ * @brief Sets the hand positions at the start of the animation. Default: all hands at 12 o'clock.
+ */
+void AnimationCompiler::setStart(const uint16_t *positions)
+{
+  for (size_t i = 0; i < this->clocks * 2; i++)
+  {
+    this->positions[i] = positions[i];
+  }
+}
+
+/**
+ * @brief Hand positions after the last compiled keyframe.
+ */
+const uint16_t *AnimationCompiler::getPositions() const
+{
+  return this->positions;
+}
+
+/**
+ * @brief Writes the frames from the current positions to the keyframe.
+ *
+ * @return true The frames were written.
+ * @return false The frame period is 0 or a frame could not be written.
+ */
+bool AnimationCompiler::compileKeyframe(const Keyframe &keyframe, AnimationWriter &writer)
+{
+  if (this->frame_period == 0)
+    return false;
+
+  this->planner.plan(this->positions, keyframe.positions);
+
+  uint32_t frames = (uint64_t)keyframe.duration * 1000 / this->frame_period;
+  long moved[MAX_CHAIN_LENGTH * 2] = {};
+  bool moving = this->planner.getFrames() > 0;
+  uint32_t frame_index = 0;
+
+  while (frame_index < frames || moving)
+  {
+    float progress = frame_index + 1 >= frames ? 1.0f : ease(keyframe.easing, (float)(frame_index + 1) / frames);
+    Frame frame(this->clocks);
+    moving = false;
+
+    for (size_t clock = 0; clock < this->clocks; clock++)
+    {
+      for (size_t hand = 0; hand < 2; hand++)
+      {
+        long steps = this->planner.getSteps(clock, (Hand)hand);
+        long &hand_moved = moved[clock * 2 + hand];
+        long desired = lroundf(progress * steps);
+
+        if (desired > hand_moved)
+        {
+          frame.setHand(clock, (Hand)hand, HAND_FORWARD);
+          hand_moved++;
+        }
+        else if (desired < hand_moved)
+        {
+          frame.setHand(clock, (Hand)hand, HAND_BACKWARD);
+          hand_moved--;
+        }
+
+        moving = moving || hand_moved != steps;
+      }
+    }
+
+    if (!writer.write(frame))
+      return false;
+    frame_index++;
+  }
+
+  for (size_t i = 0; i < this->clocks * 2; i++)
+  {
+    this->positions[i] = keyframe.positions[i];
+  }
+  return true;
+}
+
+/**
+ * @brief Compiles a keyframe script.
+ *
+ * Every line is a keyframe: `<duration in ms> <easing> <angle> <angle> ...`
+ * with two angles (hour, minute) per clock in degrees. `-` keeps the angle of the previous keyframe.
+ * A line `start <angle> <angle> ...` sets the start positions. Empty lines and lines starting with `#` are ignored.
+ *
+ * Easings: linear, ease_in, ease_out, ease_in_out
+ *
+ * @return true The script was compiled.
+ * @return false The script contains an invalid line or the animation could not be written.
+ */
+bool AnimationCompiler::compileScript(FILE *script, AnimationWriter &writer)
+{
+  char line[SCRIPT_MAX_LINE];
+  while (fgets(line, sizeof(line), script) != NULL)
+  {
+    char *rest = NULL;
+    char *first = strtok_r(line, " \t\r\n", &rest);
+    if (first == NULL || first[0] == '#')
+      continue;
+
+    if (strcmp(first, "start") == 0)
+    {
+      uint16_t start[MAX_CHAIN_LENGTH * 2];
+      memcpy(start, this->positions, sizeof(start));
+      if (!this->parsePositions(rest, start))
+        return false;
+      this->setStart(start);
+      continue;
+    }
+
+    Keyframe keyframe;
+    char *end = NULL;
+    keyframe.duration = strtoul(first, &end, 10);
+    if (*end != '\0' || !parseEasing(strtok_r(NULL, " \t\r\n", &rest), keyframe.easing))
+      return false;
+
+    memcpy(keyframe.positions, this->positions, sizeof(keyframe.positions));
+    if (!this->parsePositions(rest, keyframe.positions))
+      return false;
+
+    if (!this->compileKeyframe(keyframe, writer))
+      return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Easing curve for a progress t between [0, 1].
+ */
+float AnimationCompiler::ease(Easing easing, float t)
+{
+  switch (easing)
+  {
+  case EASE_IN:
+    return t * t * t;
+  case EASE_OUT:
+    return 1 - (1 - t) * (1 - t) * (1 - t);
+  case EASE_IN_OUT:
+    return t < 0.5f ? 4 * t * t * t : 1 - 4 * (1 - t) * (1 - t) * (1 - t);
+  default:
+    return t;
+  }
+}
+
+bool AnimationCompiler::parseEasing(const char *name, Easing &easing)
+{
+  if (name == NULL)
+    return false;
+
+  if (strcmp(name, "linear") == 0)
+    easing = LINEAR;
+  else if (strcmp(name, "ease_in") == 0)
+    easing = EASE_IN;
+  else if (strcmp(name, "ease_out") == 0)
+    easing = EASE_OUT;
+  else if (strcmp(name, "ease_in_out") == 0)
+    easing = EASE_IN_OUT;
+  else
+    return false;
+  return true;
+}
+
+/**
+ * @brief Parses two angles per clock into positions. `-` keeps the given position.
+ */
+bool AnimationCompiler::parsePositions(char *values, uint16_t *positions)
+{
+  char *rest = NULL;
+  char *value = strtok_r(values, " \t\r\n", &rest);
+  for (size_t i = 0; i < this->clocks * 2; i++)
+  {
+    if (value == NULL)
+      return false;
+
+    if (strcmp(value, "-") != 0)
+    {
+      char *end = NULL;
+      float degrees = strtof(value, &end);
+      if (*end != '\0')
+        return false;
+      positions[i] = this->planner.angleToSteps(degrees);
+    }
+    value = strtok_r(NULL, " \t\r\n", &rest);
+  }
+  return value == NULL;
+}
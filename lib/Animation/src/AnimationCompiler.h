@@ -0,0 +1,52 @@
+#ifndef _ANIMATION_COMPILER_H_
+#define _ANIMATION_COMPILER_H_
+
+#include <MotionPlanner.h>
+#include "AnimationFile.h"
+
+enum Easing
+{
+  LINEAR,
+  EASE_IN,
+  EASE_OUT,
+  EASE_IN_OUT
+};
+
+struct Keyframe
+{
+  uint32_t duration; // ms to move from the previous keyframe to this one
+  Easing easing;
+  uint16_t positions[MAX_CHAIN_LENGTH * 2]; // target positions in steps: [clock * 2 + hand]
+};
+
+/**
+ * @brief Compiles keyframes of hand positions into the frames of a binary animation.
+ *
+ * Between two keyframes every hand follows the easing curve on its shortest path.
+ * A hand moves at most one step per frame. If the curve is too steep, the hand follows as fast as possible
+ * and the keyframe is extended until every hand reached its target.
+ */
+class AnimationCompiler
+{
+public:
+  AnimationCompiler(size_t clocks, size_t steps_per_revolution, uint16_t frame_period);
+
+  void setStart(const uint16_t *positions);
+  const uint16_t *getPositions() const;
+
+  bool compileKeyframe(const Keyframe &keyframe, AnimationWriter &writer);
+  bool compileScript(FILE *script, AnimationWriter &writer);
+
+  static float ease(Easing easing, float t);
+  static bool parseEasing(const char *name, Easing &easing);
+
+private:
+  bool parsePositions(char *values, uint16_t *positions);
+
+  size_t clocks;
+  uint16_t frame_period;
+  MotionPlanner planner;
+  uint16_t positions[MAX_CHAIN_LENGTH * 2];
+};
+
+#endif
@@ -0,0 +1,286 @@
+#include "AnimationFile.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const uint8_t ANIMATION_MAGIC[4] = {'A', 'D', 'C', 'A'};
+
+static void writeUint16(uint8_t *buffer, uint16_t value)
+{
+  buffer[0] = value & 0xFF;
+  buffer[1] = value >> 8;
+}
+
+static void writeUint32(uint8_t *buffer, uint32_t value)
+{
+  writeUint16(buffer, value & 0xFFFF);
+  writeUint16(buffer + 2, value >> 16);
+}
+
+static uint16_t readUint16(const uint8_t *buffer)
+{
+  return buffer[0] | (buffer[1] << 8);
+}
+
+static uint32_t readUint32(const uint8_t *buffer)
+{
+  return readUint16(buffer) | ((uint32_t)readUint16(buffer + 2) << 16);
+}
+
+AnimationWriter::AnimationWriter(FILE *file, size_t clocks, uint16_t frame_period)
+{
+  this->file = file;
+  this->clocks = clocks > MAX_CHAIN_LENGTH ? MAX_CHAIN_LENGTH : clocks;
+  this->frame_period = frame_period;
+  this->frame_count = 0;
+  this->idle_run = 0;
+}
+
+/**
+ * @brief Writes the header. The number of frames is updated by end().
+ */
+bool AnimationWriter::begin()
+{
+  this->frame_count = 0;
+  this->idle_run = 0;
+  return this->writeHeader();
+}
+
+/**
+ * @brief Appends a frame. Idle frames are collected and written as a single record.
+ */
+bool AnimationWriter::write(const Frame &frame)
+{
+  this->frame_count++;
+
+  size_t active = frame.getActiveClocks();
+  if (active == 0)
+  {
+    this->idle_run++;
+    return true;
+  }
+
+  if (!this->flushIdleRun())
+    return false;
+
+  uint8_t record[MAX_FRAME_BYTES + 1];
+  size_t size = (active + 1) / 2;
+  record[0] = active;
+  for (size_t i = 0; i < size; i++)
+  {
+    record[i + 1] = frame.getData()[i];
+  }
+  if (active % 2 == 1)
+    record[size] &= 0xF0;
+
+  return fwrite(record, 1, size + 1, this->file) == size + 1;
+}
+
+/**
+ * @brief Writes the remaining idle frames and the final number of frames into the header.
+ */
+bool AnimationWriter::end()
+{
+  if (!this->flushIdleRun())
+    return false;
+
+  long end = ftell(this->file);
+  if (end < 0 || fseek(this->file, 0, SEEK_SET) != 0 || !this->writeHeader())
+    return false;
+
+  return fseek(this->file, end, SEEK_SET) == 0 && fflush(this->file) == 0;
+}
+
+uint32_t AnimationWriter::getFrameCount() const
+{
+  return this->frame_count;
+}
+
+bool AnimationWriter::flushIdleRun()
+{
+  while (this->idle_run > 0)
+  {
+    uint16_t count = this->idle_run > ANIMATION_MAX_IDLE_RUN ? ANIMATION_MAX_IDLE_RUN : this->idle_run;
+    uint8_t record[3];
+    record[0] = 0;
+    writeUint16(record + 1, count);
+    if (fwrite(record, 1, sizeof(record), this->file) != sizeof(record))
+      return false;
+    this->idle_run -= count;
+  }
+  return true;
+}
+
+bool AnimationWriter::writeHeader()
+{
+  uint8_t header[ANIMATION_HEADER_SIZE];
+  for (size_t i = 0; i < 4; i++)
+  {
+    header[i] = ANIMATION_MAGIC[i];
+  }
+  header[4] = ANIMATION_VERSION;
+  header[5] = this->clocks;
+  writeUint16(header + 6, this->frame_period);
+  writeUint32(header + 8, this->frame_count);
+  return fwrite(header, 1, sizeof(header), this->file) == sizeof(header);
+}
+
+AnimationReader::AnimationReader(const uint8_t *data, size_t size)
+{
+  this->data = data;
+  this->size = size;
+  this->valid = false;
+  this->clocks = 0;
+  this->frame_period = 0;
+  this->frame_count = 0;
+
+  if (data != NULL && size >= ANIMATION_HEADER_SIZE)
+  {
+    this->valid = data[0] == ANIMATION_MAGIC[0] && data[1] == ANIMATION_MAGIC[1] && data[2] == ANIMATION_MAGIC[2] && data[3] == ANIMATION_MAGIC[3] &&
+                  data[4] == ANIMATION_VERSION && data[5] <= MAX_CHAIN_LENGTH;
+    this->clocks = data[5];
+    this->frame_period = readUint16(data + 6);
+    this->frame_count = readUint32(data + 8);
+  }
+
+  this->rewind();
+}
+
+bool AnimationReader::isValid() const
+{
+  return this->valid;
+}
+
+size_t AnimationReader::getClocks() const
+{
+  return this->clocks;
+}
+
+/**
+ * @brief Time between two frames in us.
+ */
+uint16_t AnimationReader::getFramePeriod() const
+{
+  return this->frame_period;
+}
+
+uint32_t AnimationReader::getFrameCount() const
+{
+  return this->frame_count;
+}
+
+/**
+ * @brief Reads the next frame.
+ *
+ * @param frame Receives the frame. Idle frames are returned as well, so the caller keeps the timing.
+ * @return true A frame was read.
+ * @return false End of the animation or the data is corrupted.
+ */
+bool AnimationReader::next(Frame &frame)
+{
+  if (!this->valid)
+    return false;
+
+  if (this->idle_remaining > 0)
+  {
+    this->idle_remaining--;
+    frame = Frame(this->clocks);
+    return true;
+  }
+
+  if (this->offset >= this->size)
+    return false;
+
+  uint8_t type = this->data[this->offset];
+  if (type == 0)
+  {
+    if (this->offset + 3 > this->size)
+      return false;
+    this->idle_remaining = readUint16(this->data + this->offset + 1);
+    this->offset += 3;
+    return this->next(frame);
+  }
+
+  size_t bytes = (type + 1) / 2;
+  if (type > this->clocks || this->offset + 1 + bytes > this->size)
+    return false;
+
+  frame = Frame(this->clocks);
+  const uint8_t *packed = this->data + this->offset + 1;
+  for (size_t clock = 0; clock < type; clock++)
+  {
+    frame.setInstruction(clock, clock % 2 == 0 ? packed[clock / 2] >> 4 : packed[clock / 2] & 0x0F);
+  }
+  this->offset += 1 + bytes;
+  return true;
+}
+
+/**
+ * @brief Starts reading at the first frame again.
+ */
+void AnimationReader::rewind()
+{
+  this->offset = ANIMATION_HEADER_SIZE;
+  this->idle_remaining = 0;
+}
+
+AnimationFile::AnimationFile()
+{
+  this->data = NULL;
+  this->size = 0;
+}
+
+AnimationFile::~AnimationFile()
+{
+  this->close();
+}
+
+/**
+ * @brief Maps the file read only. The kernel is told that it is read sequentially.
+ */
+bool AnimationFile::open(const char *path)
+{
+  this->close();
+
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0)
+  {
+    ::close(fd);
+    return false;
+  }
+
+  void *mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED)
+    return false;
+
+  madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+  this->data = (const uint8_t *)mapped;
+  this->size = info.st_size;
+  return true;
+}
+
+void AnimationFile::close()
+{
+  if (this->data != NULL)
+  {
+    munmap((void *)this->data, this->size);
+    this->data = NULL;
+    this->size = 0;
+  }
+}
+
+const uint8_t *AnimationFile::getData() const
+{
+  return this->data;
+}
+
+size_t AnimationFile::getSize() const
+{
+  return this->size;
+}
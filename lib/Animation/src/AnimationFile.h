@@ -0,0 +1,106 @@
+#ifndef _ANIMATION_FILE_H_
+#define _ANIMATION_FILE_H_
+
+#include <stdio.h>
+#include <Frame.h>
+
+#define ANIMATION_VERSION 1
+#define ANIMATION_HEADER_SIZE 12
+#define ANIMATION_MAX_IDLE_RUN 0xFFFF
+
+/**
+ * Binary animation format (little endian):
+ *
+ * Header (ANIMATION_HEADER_SIZE bytes):
+ *   'A' 'D' 'C' 'A'  magic
+ *   uint8_t          version (ANIMATION_VERSION)
+ *   uint8_t          clocks in the chain
+ *   uint16_t         frame period in us
+ *   uint32_t         number of frames (idle frames included)
+ *
+ * Followed by records:
+ *   0x00, uint16_t count   count idle frames (no hand moves)
+ *   n (1 - clocks), data   a frame with n instructions, packed like Frame: (n + 1) / 2 bytes
+ *
+ * Frames are truncated after the last moving clock, idle frames are run length encoded.
+ */
+
+/**
+ * @brief Writes frames as binary animation. Frames are streamed into the file, nothing is kept in memory.
+ */
+class AnimationWriter
+{
+public:
+  AnimationWriter(FILE *file, size_t clocks, uint16_t frame_period);
+
+  bool begin();
+  bool write(const Frame &frame);
+  bool end();
+
+  uint32_t getFrameCount() const;
+
+private:
+  bool flushIdleRun();
+  bool writeHeader();
+
+  FILE *file;
+  size_t clocks;
+  uint16_t frame_period;
+  uint32_t frame_count;
+  uint32_t idle_run; // idle frames that are not written yet
+};
+
+/**
+ * @brief Reads a binary animation sequentially from memory (e.g. a memory mapped file).
+ *
+ * Only the current position is kept, so the memory footprint does not depend on the length of the animation.
+ */
+class AnimationReader
+{
+public:
+  AnimationReader(const uint8_t *data, size_t size);
+
+  bool isValid() const;
+  size_t getClocks() const;
+  uint16_t getFramePeriod() const;
+  uint32_t getFrameCount() const;
+
+  bool next(Frame &frame);
+  void rewind();
+
+private:
+  const uint8_t *data;
+  size_t size;
+  size_t offset;
+  uint32_t idle_remaining;
+
+  bool valid;
+  size_t clocks;
+  uint16_t frame_period;
+  uint32_t frame_count;
+};
+
+/**
+ * @brief Maps an animation file into memory for an AnimationReader.
+ */
+class AnimationFile
+{
+public:
+  AnimationFile();
+  ~AnimationFile();
+
+  bool open(const char *path);
+  void close();
+
+  const uint8_t *getData() const;
+  size_t getSize() const;
+
+private:
+  AnimationFile(const AnimationFile &);
+  AnimationFile &operator=(const AnimationFile &);
+
+  const uint8_t *data;
+  size_t size;
+};
+
+#endif
@@ -0,0 +1,154 @@
+/**
+ * Decodes a logic analyzer capture of the bus between two clocks and reports its timing.
+ *
+ * Usage: analyze_capture [options] <capture.csv | capture.bin | ->
+ *   -r <Hz>          sample rate, required for binary captures and CSV without time column or samplerate comment
+ *   -b <bytes>       read a sigrok binary capture with the given unit size (default for *.bin: 1)
+ *   -c <channels>    clock,data 1,data 2,data 3,data 4[,next clock] (default: 0,1,2,3,4)
+ *   -v               print every decoded frame
+ *
+ * The capture is streamed, it can be much larger than the memory.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <BusDecoder.h>
+#include <Capture.h>
+
+class PrintOutput : public FrameOutput
+{
+public:
+  PrintOutput() : index(0)
+  {
+  }
+
+  bool send(const Frame &frame) override
+  {
+    printf("frame %llu:", (unsigned long long)this->index++);
+    for (size_t clock = 0; clock < frame.getClocks(); clock++)
+    {
+      printf(" %X", frame.getInstruction(clock));
+    }
+    printf("\n");
+    return true;
+  }
+
+private:
+  uint64_t index;
+};
+
+void printTiming(const char *name, const TimingStats &stats, unsigned int expected_us)
+{
+  if (stats.count == 0)
+  {
+    printf("%-14s -\n", name);
+    return;
+  }
+  printf("%-14s min %8.3f us  mean %8.3f us  max %8.3f us  (%llu)", name, stats.min / 1000.0, stats.mean() / 1000.0,
+         stats.max / 1000.0, (unsigned long long)stats.count);
+  if (expected_us > 0)
+    printf("  config %u us", expected_us);
+  printf("\n");
+}
+
+bool parseChannels(const char *text, BusChannels &channels)
+{
+  int values[6];
+  size_t count = 0;
+  const char *cursor = text;
+  while (count < 6 && *cursor != '\0')
+  {
+    char *end;
+    values[count++] = strtol(cursor, &end, 10);
+    if (end == cursor)
+      return false;
+    cursor = *end == ',' ? end + 1 : end;
+  }
+  if (count < 5)
+    return false;
+
+  channels.clock = values[0];
+  for (size_t i = 0; i < 4; i++)
+    channels.data[i] = values[1 + i];
+  channels.next_clock = count == 6 ? values[5] : BUS_NO_CHANNEL;
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  uint64_t sample_rate = 0;
+  size_t unit_size = 0;
+  bool verbose = false;
+  BusChannels channels;
+
+  int option;
+  while ((option = getopt(argc, argv, "r:b:c:v")) != -1)
+  {
+    switch (option)
+    {
+    case 'r':
+      sample_rate = strtoull(optarg, NULL, 10);
+      break;
+    case 'b':
+      unit_size = strtoul(optarg, NULL, 10);
+      break;
+    case 'c':
+      if (!parseChannels(optarg, channels))
+      {
+        fprintf(stderr, "Invalid channels %s\n", optarg);
+        return 1;
+      }
+      break;
+    case 'v':
+      verbose = true;
+      break;
+    default:
+      return 1;
+    }
+  }
+  if (optind >= argc)
+  {
+    fprintf(stderr, "Usage: %s [-r sample rate] [-b unit size] [-c clock,d1,d2,d3,d4[,next clock]] [-v] <capture>\n", argv[0]);
+    return 1;
+  }
+
+  const char *path = argv[optind];
+  size_t length = strlen(path);
+  if (unit_size == 0 && length > 4 && strcmp(path + length - 4, ".bin") == 0)
+    unit_size = 1;
+
+  Capture *capture = unit_size > 0 ? (Capture *)new BinaryCapture(unit_size) : (Capture *)new CsvCapture();
+  capture->setSampleRate(sample_rate);
+  if (strcmp(path, "-") == 0 ? !capture->open(stdin) : !capture->open(path))
+  {
+    perror(path);
+    return 1;
+  }
+
+  PrintOutput printer;
+  BusDecoder decoder(channels, verbose ? &printer : NULL);
+  uint64_t time_ns;
+  uint32_t levels;
+  while (capture->next(time_ns, levels))
+  {
+    decoder.feed(time_ns, levels);
+  }
+  decoder.finish();
+
+  if (capture->getSampleRate() == 0 && unit_size > 0)
+    fprintf(stderr, "Warning: no sample rate, all times are 0\n");
+
+  const BusReport &report = decoder.getReport();
+  printf("frames %llu, instructions %llu, truncated frames %llu\n", (unsigned long long)report.frames,
+         (unsigned long long)report.instructions, (unsigned long long)report.truncated_frames);
+  printTiming("tick period", report.tick_period, 0);
+  printTiming("pulse width", report.pulse_width, report.clock_out_high);
+  printTiming("frame gap", report.frame_gap, report.delay_between_instructions);
+  printTiming("hop latency", report.hop_latency, 0);
+  printf("short pulses %llu, slow ticks %llu, short gaps %llu\n", (unsigned long long)report.short_pulses,
+         (unsigned long long)report.slow_ticks, (unsigned long long)report.short_gaps);
+
+  delete capture;
+  return report.short_pulses > 0 || report.slow_ticks > 0 || report.short_gaps > 0 ? 2 : 0;
+}
@@ -0,0 +1,160 @@
+#include "BusDecoder.h"
+#include <string.h>
+#include "../../../src/Config.h"
+
+void TimingStats::reset()
+{
+  this->count = 0;
+  this->min = 0;
+  this->max = 0;
+  this->sum = 0;
+}
+
+void TimingStats::record(uint64_t ns)
+{
+  if (this->count == 0 || ns < this->min)
+    this->min = ns;
+  if (ns > this->max)
+    this->max = ns;
+  this->sum += ns;
+  this->count++;
+}
+
+uint64_t TimingStats::mean() const
+{
+  return this->count == 0 ? 0 : this->sum / this->count;
+}
+
+BusDecoder::BusDecoder(const BusChannels &channels, FrameOutput *output) : channels(channels), output(output)
+{
+  this->reset();
+}
+
+void BusDecoder::reset()
+{
+  memset(&this->report, 0, sizeof(this->report));
+  this->report.clock_out_high = CLOCK_OUT_HIGH;
+  this->report.delay_between_instructions = DELAY_BETWEEN_INSTRUCTIONS;
+  this->last_levels = 0;
+  this->has_levels = false;
+  this->last_rise_ns = 0;
+  this->has_rise = false;
+  this->in_frame = false;
+  this->latency_pending = false;
+  this->frame = Frame(MAX_CHAIN_LENGTH);
+  this->frame_ticks = 0;
+}
+
+/**
+ * @brief Processes the levels of all channels at a time. Times must not decrease.
+ */
+void BusDecoder::feed(uint64_t time_ns, uint32_t levels)
+{
+  if (!this->has_levels)
+  {
+    this->has_levels = true;
+    this->last_levels = levels;
+    return;
+  }
+
+  uint32_t changed = levels ^ this->last_levels;
+  this->last_levels = levels;
+  uint32_t clock = (uint32_t)1 << this->channels.clock;
+
+  if ((changed & clock) && (levels & clock))
+  {
+    this->tick(time_ns, levels);
+  }
+  else if ((changed & clock) && this->has_rise)
+  {
+    uint64_t width = time_ns - this->last_rise_ns;
+    this->report.pulse_width.record(width);
+    if (width < CLOCK_OUT_HIGH * 1000ULL)
+      this->report.short_pulses++;
+  }
+
+  if (this->channels.next_clock != BUS_NO_CHANNEL)
+  {
+    uint32_t next_clock = (uint32_t)1 << this->channels.next_clock;
+    if ((changed & next_clock) && (levels & next_clock) && this->latency_pending)
+    {
+      this->report.hop_latency.record(time_ns - this->last_rise_ns);
+      this->latency_pending = false;
+    }
+  }
+}
+
+/**
+ * @brief Ends the last frame of the capture.
+ */
+void BusDecoder::finish()
+{
+  this->endFrame();
+}
+
+const BusReport &BusDecoder::getReport() const
+{
+  return this->report;
+}
+
+void BusDecoder::tick(uint64_t time_ns, uint32_t levels)
+{
+  if (this->has_rise)
+  {
+    uint64_t period = time_ns - this->last_rise_ns;
+    if (period > DELAY_BETWEEN_INSTRUCTIONS * 1000ULL)
+    {
+      this->endFrame();
+      this->report.frame_gap.record(period);
+      if (period < (DELAY_BETWEEN_INSTRUCTIONS + CHAIN_HEAD_GAP_MARGIN) * 1000ULL)
+        this->report.short_gaps++;
+    }
+    else
+    {
+      this->report.tick_period.record(period);
+      if (period > DELAY_BETWEEN_INSTRUCTIONS * 1000ULL / 2)
+        this->report.slow_ticks++;
+    }
+  }
+
+  uint8_t instruction = 0;
+  for (size_t i = 0; i < 4; i++)
+  {
+    instruction = instruction << 1 | ((levels >> this->channels.data[i]) & 1);
+  }
+
+  if (this->frame_ticks < MAX_CHAIN_LENGTH)
+    this->frame.setInstruction(this->frame_ticks, instruction);
+  this->report.instructions++;
+
+  // The next clock keeps the first instruction of a frame and forwards all others
+  this->latency_pending = this->frame_ticks > 0;
+  this->frame_ticks++;
+  this->in_frame = true;
+  this->has_rise = true;
+  this->last_rise_ns = time_ns;
+}
+
+void BusDecoder::endFrame()
+{
+  if (!this->in_frame)
+    return;
+
+  size_t clocks = this->frame_ticks < MAX_CHAIN_LENGTH ? this->frame_ticks : MAX_CHAIN_LENGTH;
+  Frame decoded(clocks);
+  for (size_t clock = 0; clock < clocks; clock++)
+  {
+    decoded.setInstruction(clock, this->frame.getInstruction(clock));
+  }
+
+  this->report.frames++;
+  if (this->frame_ticks > MAX_CHAIN_LENGTH)
+    this->report.truncated_frames++;
+  if (this->output != NULL)
+    this->output->send(decoded);
+
+  this->frame.clear();
+  this->frame_ticks = 0;
+  this->in_frame = false;
+  this->latency_pending = false;
+}
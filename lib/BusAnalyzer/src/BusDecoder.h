@@ -0,0 +1,86 @@
+#ifndef _BUS_DECODER_H_
+#define _BUS_DECODER_H_
+
+#include <Frame.h>
+#include <FrameOutput.h>
+
+#define BUS_NO_CHANNEL -1
+
+/**
+ * @brief Channels of the capture that are connected to the bus of a hop.
+ */
+struct BusChannels
+{
+  int clock = 0;                   // COMM_OUT_CLOCK of the hop
+  int data[4] = {1, 2, 3, 4};      // COMM_OUT_DATA1 - COMM_OUT_DATA4
+  int next_clock = BUS_NO_CHANNEL; // COMM_OUT_CLOCK of the next clock, to measure the forwarding latency
+};
+
+/**
+ * @brief Minimum, maximum and mean of a time in ns.
+ */
+struct TimingStats
+{
+  uint64_t count;
+  uint64_t min;
+  uint64_t max;
+  uint64_t sum;
+
+  void reset();
+  void record(uint64_t ns);
+  uint64_t mean() const;
+};
+
+struct BusReport
+{
+  uint32_t clock_out_high;             // us, CLOCK_OUT_HIGH of the firmware the timing is checked against
+  uint32_t delay_between_instructions; // us, DELAY_BETWEEN_INSTRUCTIONS of the firmware
+  uint64_t frames;
+  uint64_t instructions;
+  uint64_t truncated_frames; // frames with more than MAX_CHAIN_LENGTH instructions
+  uint64_t short_pulses;     // clock pulses shorter than CLOCK_OUT_HIGH
+  uint64_t slow_ticks;       // tick periods longer than half of DELAY_BETWEEN_INSTRUCTIONS, close to end the frame
+  uint64_t short_gaps;       // frame gaps shorter than DELAY_BETWEEN_INSTRUCTIONS + CHAIN_HEAD_GAP_MARGIN
+  TimingStats tick_period;   // rising edge to rising edge within a frame
+  TimingStats pulse_width;   // rising to falling edge of the clock
+  TimingStats frame_gap;     // last tick of a frame to the first tick of the next frame
+  TimingStats hop_latency;   // rising edge of the hop to the rising edge of the next clock
+};
+
+/**
+ * @brief Decodes the bus between two clocks from the level changes of a capture.
+ *
+ * The data lines are read at the rising edge of the clock like processDataInput() does it.
+ * A pause longer than DELAY_BETWEEN_INSTRUCTIONS ends a frame, like in the firmware.
+ * Every decoded frame is sent to the output, e.g. a FileOutput or a DigitalTwin.
+ */
+class BusDecoder
+{
+public:
+  explicit BusDecoder(const BusChannels &channels, FrameOutput *output = NULL);
+
+  void reset();
+  void feed(uint64_t time_ns, uint32_t levels);
+  void finish();
+
+  const BusReport &getReport() const;
+
+private:
+  void tick(uint64_t time_ns, uint32_t levels);
+  void endFrame();
+
+  BusChannels channels;
+  FrameOutput *output;
+  BusReport report;
+
+  uint32_t last_levels;
+  bool has_levels;
+  uint64_t last_rise_ns;
+  bool has_rise;
+  bool in_frame;
+  bool latency_pending; // the next clock should forward the last tick
+  Frame frame;
+  size_t frame_ticks; // ticks of the current frame, can exceed the capacity of frame
+};
+
+#endif
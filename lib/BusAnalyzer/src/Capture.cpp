@@ -0,0 +1,216 @@
+#include "Capture.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+Capture::Capture()
+{
+  this->file = NULL;
+  this->owns_file = false;
+  this->sample_rate = 0;
+  this->samples = 0;
+  this->last_levels = 0;
+  this->has_levels = false;
+}
+
+Capture::~Capture()
+{
+  this->close();
+}
+
+bool Capture::open(const char *path)
+{
+  FILE *file = fopen(path, "rb");
+  if (file == NULL)
+    return false;
+
+  this->open(file);
+  this->owns_file = true;
+  return true;
+}
+
+/**
+ * @brief Reads the capture from an open file, e.g. stdin. The file is not closed.
+ */
+bool Capture::open(FILE *file)
+{
+  this->close();
+  this->file = file;
+  this->owns_file = false;
+  this->samples = 0;
+  this->has_levels = false;
+  return file != NULL;
+}
+
+void Capture::close()
+{
+  if (this->file != NULL && this->owns_file)
+    fclose(this->file);
+  this->file = NULL;
+}
+
+void Capture::setSampleRate(uint64_t sample_rate)
+{
+  this->sample_rate = sample_rate;
+}
+
+uint64_t Capture::getSampleRate() const
+{
+  return this->sample_rate;
+}
+
+/**
+ * @brief Time of a sample in ns. Split into seconds and the rest, so it does not overflow for long captures.
+ */
+uint64_t Capture::sampleTime(uint64_t sample) const
+{
+  if (this->sample_rate == 0)
+    return 0;
+  return sample / this->sample_rate * 1000000000ULL + sample % this->sample_rate * 1000000000ULL / this->sample_rate;
+}
+
+CsvCapture::CsvCapture()
+{
+  this->has_time_column = false;
+  this->header_checked = false;
+}
+
+bool CsvCapture::next(uint64_t &time_ns, uint32_t &levels)
+{
+  char line[CAPTURE_LINE_LENGTH];
+  while (this->file != NULL && fgets(line, sizeof(line), this->file) != NULL)
+  {
+    if (line[0] == ';')
+    {
+      this->parseComment(line);
+      continue;
+    }
+
+    if (!this->header_checked)
+    {
+      this->header_checked = true;
+      char *first = line;
+      while (isspace((unsigned char)*first))
+        first++;
+      if (!isdigit((unsigned char)*first) && *first != '.' && *first != '-')
+      {
+        this->has_time_column = strncasecmp(first, "time", 4) == 0;
+        continue; // Header row
+      }
+    }
+
+    if (!this->parseLine(line, time_ns, levels))
+      continue;
+
+    this->samples++;
+    if (this->has_levels && levels == this->last_levels)
+      continue;
+
+    this->has_levels = true;
+    this->last_levels = levels;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Reads the sample rate from a comment, e.g. "; Samplerate: 24 MHz".
+ */
+bool CsvCapture::parseComment(const char *line)
+{
+  const char *rate = strstr(line, "Samplerate:");
+  if (rate == NULL)
+    return false;
+
+  char *unit;
+  double value = strtod(rate + strlen("Samplerate:"), &unit);
+  while (isspace((unsigned char)*unit))
+    unit++;
+  if (*unit == 'k')
+    value *= 1e3;
+  else if (*unit == 'M')
+    value *= 1e6;
+  else if (*unit == 'G')
+    value *= 1e9;
+
+  if (this->sample_rate == 0) // Set by the user: keep it
+    this->sample_rate = (uint64_t)llround(value);
+  return true;
+}
+
+bool CsvCapture::parseLine(char *line, uint64_t &time_ns, uint32_t &levels)
+{
+  char *cursor = line;
+  char *end;
+  if (this->has_time_column)
+  {
+    double seconds = strtod(cursor, &end);
+    if (end == cursor)
+      return false;
+    time_ns = (uint64_t)llround(seconds * 1e9);
+    cursor = end;
+  }
+  else
+  {
+    time_ns = this->sampleTime(this->samples);
+  }
+
+  levels = 0;
+  size_t channel = 0;
+  while (channel < CAPTURE_MAX_CHANNELS)
+  {
+    while (*cursor == ',' || *cursor == ' ' || *cursor == '\t')
+      cursor++;
+    if (*cursor != '0' && *cursor != '1')
+      break;
+    if (*cursor == '1')
+      levels |= (uint32_t)1 << channel;
+    channel++;
+    cursor++;
+  }
+  return channel > 0;
+}
+
+BinaryCapture::BinaryCapture(size_t unit_size)
+{
+  this->unit_size = unit_size < 1 ? 1 : unit_size > 4 ? 4 : unit_size;
+  this->buffer_size = 0;
+  this->buffer_pos = 0;
+}
+
+bool BinaryCapture::next(uint64_t &time_ns, uint32_t &levels)
+{
+  while (this->file != NULL)
+  {
+    if (this->buffer_pos + this->unit_size > this->buffer_size)
+    {
+      // Keep an incomplete unit and refill the buffer
+      size_t rest = this->buffer_size - this->buffer_pos;
+      memmove(this->buffer, this->buffer + this->buffer_pos, rest);
+      this->buffer_size = rest + fread(this->buffer + rest, 1, sizeof(this->buffer) - rest, this->file);
+      this->buffer_pos = 0;
+      if (this->buffer_size < this->unit_size)
+        return false;
+    }
+
+    uint32_t sample = 0;
+    for (size_t i = 0; i < this->unit_size; i++)
+    {
+      sample |= (uint32_t)this->buffer[this->buffer_pos + i] << (8 * i);
+    }
+    this->buffer_pos += this->unit_size;
+
+    uint64_t index = this->samples++;
+    if (this->has_levels && sample == this->last_levels)
+      continue;
+
+    this->has_levels = true;
+    this->last_levels = sample;
+    time_ns = this->sampleTime(index);
+    levels = sample;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,86 @@
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define CAPTURE_MAX_CHANNELS 32
+#define CAPTURE_LINE_LENGTH 512
+#define CAPTURE_CHUNK_SIZE 65536
+
+/**
+ * @brief Logic analyzer capture that is read as a stream of level changes.
+ *
+ * Only changes are returned, so long captures with a slow bus are processed quickly. Nothing depends on the size of the file.
+ */
+class Capture
+{
+public:
+  Capture();
+  virtual ~Capture();
+
+  bool open(const char *path);
+  bool open(FILE *file);
+  void close();
+
+  /**
+   * @brief Reads the next change of any channel.
+   *
+   * @param time_ns Time of the sample since the start of the capture.
+   * @param levels Bit n is the level of channel n.
+   * @return false End of the capture.
+   */
+  virtual bool next(uint64_t &time_ns, uint32_t &levels) = 0;
+
+  void setSampleRate(uint64_t sample_rate);
+  uint64_t getSampleRate() const;
+
+protected:
+  uint64_t sampleTime(uint64_t sample) const;
+
+  FILE *file;
+  bool owns_file;
+  uint64_t sample_rate; // Hz
+  uint64_t samples;     // samples read so far
+  uint32_t last_levels;
+  bool has_levels;
+};
+
+/**
+ * @brief sigrok / PulseView CSV export.
+ *
+ * Comment lines start with ';', "; Samplerate: 1 MHz" sets the sample rate. An optional header row names the columns,
+ * a first column "Time [s]" contains the sample time, all other columns are the channels in order (0 or 1).
+ * Without time column the sample rate is required.
+ */
+class CsvCapture : public Capture
+{
+public:
+  CsvCapture();
+  bool next(uint64_t &time_ns, uint32_t &levels) override;
+
+private:
+  bool parseComment(const char *line);
+  bool parseLine(char *line, uint64_t &time_ns, uint32_t &levels);
+
+  bool has_time_column;
+  bool header_checked;
+};
+
+/**
+ * @brief sigrok binary output (sigrok-cli -O binary): one unit of unit_size bytes per sample, channel 0 in the lowest bit.
+ */
+class BinaryCapture : public Capture
+{
+public:
+  explicit BinaryCapture(size_t unit_size = 1);
+  bool next(uint64_t &time_ns, uint32_t &levels) override;
+
+private:
+  size_t unit_size;
+  uint8_t buffer[CAPTURE_CHUNK_SIZE];
+  size_t buffer_size;
+  size_t buffer_pos;
+};
+
+#endif
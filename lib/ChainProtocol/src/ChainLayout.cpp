@@ -0,0 +1,102 @@
+#include "ChainLayout.h"
+
+/**
+ * @brief A single chain with all clocks.
+ */
+ChainLayout::ChainLayout() : ChainLayout(MAX_CHAIN_LENGTH, 1)
+{
+}
+
+/**
+ * @brief Splits the clocks evenly into chains. The first chains get one clock more, if the clocks can not be split evenly.
+ */
+ChainLayout::ChainLayout(size_t clocks, size_t chains)
+{
+  if (clocks > MAX_CHAIN_LENGTH)
+    clocks = MAX_CHAIN_LENGTH;
+  if (chains > MAX_CHAINS)
+    chains = MAX_CHAINS;
+  if (chains == 0)
+    chains = 1;
+
+  this->chains = chains;
+  for (size_t chain = 0; chain < MAX_CHAINS; chain++)
+  {
+    this->lengths[chain] = chain < chains ? clocks / chains + (chain < clocks % chains ? 1 : 0) : 0;
+  }
+}
+
+/**
+ * @brief Changes the number of clocks of a chain. The following chains move, the wall must not exceed MAX_CHAIN_LENGTH.
+ */
+void ChainLayout::setLength(size_t chain, size_t length)
+{
+  if (chain < this->chains && this->getClocks() - this->lengths[chain] + length <= MAX_CHAIN_LENGTH)
+    this->lengths[chain] = length;
+}
+
+size_t ChainLayout::getChains() const
+{
+  return this->chains;
+}
+
+size_t ChainLayout::getClocks() const
+{
+  return this->getOffset(this->chains);
+}
+
+size_t ChainLayout::getLength(size_t chain) const
+{
+  return chain < this->chains ? this->lengths[chain] : 0;
+}
+
+/**
+ * @brief Position of the first clock of the chain in the wall.
+ */
+size_t ChainLayout::getOffset(size_t chain) const
+{
+  size_t offset = 0;
+  for (size_t i = 0; i < chain && i < this->chains; i++)
+    offset += this->lengths[i];
+  return offset;
+}
+
+/**
+ * @brief Splits a frame of the wall into one frame per chain.
+ *
+ * @param chain_frames Receives getChains() frames. Clocks that are missing in the wall frame keep still.
+ *                     The frames of a complete frame (see Frame::setComplete()) are complete.
+ */
+void ChainLayout::split(const Frame &frame, Frame *chain_frames) const
+{
+  size_t offset = 0;
+  for (size_t chain = 0; chain < this->chains; chain++)
+  {
+    chain_frames[chain] = Frame(this->lengths[chain]);
+    chain_frames[chain].setComplete(frame.isComplete());
+    for (size_t clock = 0; clock < this->lengths[chain] && offset + clock < frame.getClocks(); clock++)
+    {
+      chain_frames[chain].setInstruction(clock, frame.getInstruction(offset + clock));
+    }
+    offset += this->lengths[chain];
+  }
+}
+
+/**
+ * @brief Joins the frames of all chains into a frame of the wall. Reverse of split().
+ */
+void ChainLayout::merge(const Frame *chain_frames, Frame &frame) const
+{
+  frame = Frame(this->getClocks());
+  size_t offset = 0;
+  for (size_t chain = 0; chain < this->chains; chain++)
+  {
+    for (size_t clock = 0; clock < this->lengths[chain] && clock < chain_frames[chain].getClocks(); clock++)
+    {
+      frame.setInstruction(offset + clock, chain_frames[chain].getInstruction(clock));
+    }
+    if (chain_frames[chain].isComplete())
+      frame.setComplete(true);
+    offset += this->lengths[chain];
+  }
+}
@@ -0,0 +1,34 @@
+#ifndef _CHAIN_LAYOUT_H_
+#define _CHAIN_LAYOUT_H_
+
+#include "Frame.h"
+
+#define MAX_CHAINS 8
+
+/**
+ * @brief Splits the wall into independent chains that are driven in parallel.
+ *
+ * Every chain is a consecutive range of the clocks of the wall: chain 0 starts with clock 0, chain 1 follows its last clock and so on.
+ * A frame of the wall is split into one frame per chain. The firmware is the same, every chain has its own first clock.
+ */
+class ChainLayout
+{
+public:
+  ChainLayout();
+  ChainLayout(size_t clocks, size_t chains);
+
+  void setLength(size_t chain, size_t length);
+  size_t getChains() const;
+  size_t getClocks() const;
+  size_t getLength(size_t chain) const;
+  size_t getOffset(size_t chain) const;
+
+  void split(const Frame &frame, Frame *chain_frames) const;
+  void merge(const Frame *chain_frames, Frame &frame) const;
+
+private:
+  size_t chains;
+  uint8_t lengths[MAX_CHAINS];
+};
+
+#endif
@@ -0,0 +1,173 @@
+#include "CommandEncoder.h"
+
+CommandEncoder::CommandEncoder(size_t clocks)
+{
+  this->clocks = clocks > MAX_CHAIN_LENGTH ? MAX_CHAIN_LENGTH : clocks;
+  this->clear();
+}
+
+/**
+ * @brief Removes the commands of all clocks.
+ */
+void CommandEncoder::clear()
+{
+  for (size_t clock = 0; clock < MAX_CHAIN_LENGTH; clock++)
+  {
+    this->lengths[clock] = 0;
+  }
+  this->sent = 0;
+}
+
+/**
+ * @brief Lets both hands of a clock rotate continuously until their next step instruction.
+ *
+ * The clock generates the steps itself, a single command keeps the hands rotating without further frames.
+ *
+ * @param hour_speed Speed of the hour hand in VELOCITY_UNIT steps per second of the clock firmware, negative = backward, 0 = stop.
+ * @param minute_speed Speed of the minute hand.
+ */
+void CommandEncoder::setVelocity(size_t clock, int8_t hour_speed, int8_t minute_speed)
+{
+  uint8_t arguments[4];
+  arguments[0] = (uint8_t)hour_speed >> 4;
+  arguments[1] = (uint8_t)hour_speed & 0x0F;
+  arguments[2] = (uint8_t)minute_speed >> 4;
+  arguments[3] = (uint8_t)minute_speed & 0x0F;
+  this->setCommand(clock, FRAME_COMMAND_VELOCITY, arguments, 4);
+}
+
+/**
+ * @brief Uploads a move of a macro to a clock, the clock stores it in EEPROM.
+ *
+ * The moves of a macro are uploaded in order, index 0 starts a new macro. After the frames of this command the host must pause
+ * for MACRO_STORE_PAUSE, the clocks do not process instructions while they write the EEPROM.
+ *
+ * @param slot Macro slot between [0, MACRO_SLOTS of the clock firmware).
+ * @param index Index of the move in the macro.
+ * @param hour_steps Steps of the hour hand, negative = backward.
+ * @param minute_steps Steps of the minute hand.
+ * @param frames Duration of the move in MACRO_FRAME_PERIOD of the clock firmware, the steps are spread evenly.
+ */
+void CommandEncoder::storeMacroMove(size_t clock, uint8_t slot, uint8_t index, int16_t hour_steps, int16_t minute_steps, uint16_t frames)
+{
+  uint16_t values[3] = {(uint16_t)hour_steps, (uint16_t)minute_steps, frames};
+  uint8_t arguments[14];
+  arguments[0] = slot & 0x0F;
+  arguments[1] = index & 0x0F;
+  for (size_t i = 0; i < 3; i++)
+  {
+    for (size_t nibble = 0; nibble < 4; nibble++)
+    {
+      arguments[2 + i * 4 + nibble] = (values[i] >> (12 - nibble * 4)) & 0x0F;
+    }
+  }
+  this->setCommand(clock, FRAME_COMMAND_MACRO_STORE, arguments, 14);
+}
+
+/**
+ * @brief Lets a clock play a stored macro. The macro ends with its last move or the next instruction (other than keeping still).
+ *
+ * The command takes three frames, for one or all clocks of the chain.
+ */
+void CommandEncoder::playMacro(size_t clock, uint8_t slot)
+{
+  uint8_t argument = slot & 0x0F;
+  this->setCommand(clock, FRAME_COMMAND_MACRO_PLAY, &argument, 1);
+}
+
+/**
+ * @brief Lets a clock try a faster timing of the chain, see ChainTuner.
+ *
+ * The clock uses the timing from the next frame on and reverts it after TIMING_TRIAL_PERIOD of the clock firmware,
+ * unless keepTiming() follows. A timing the clock can not use is ignored. The clock keeps the timing until it is reset.
+ *
+ * @param clock_out_high us the clock wire to the next clock is high (CLOCK_OUT_HIGH).
+ * @param frame_gap us without tick that end a frame (DELAY_BETWEEN_INSTRUCTIONS), the host must wait a bit longer between frames.
+ */
+void CommandEncoder::setTiming(size_t clock, uint8_t clock_out_high, uint16_t frame_gap)
+{
+  uint8_t arguments[6];
+  arguments[0] = clock_out_high >> 4;
+  arguments[1] = clock_out_high & 0x0F;
+  for (size_t nibble = 0; nibble < 4; nibble++)
+  {
+    arguments[2 + nibble] = (frame_gap >> (12 - nibble * 4)) & 0x0F;
+  }
+  this->setCommand(clock, FRAME_COMMAND_TIMING, arguments, 6);
+}
+
+/**
+ * @brief Confirms the timing on trial, sent with the new timing once the host received the test frames.
+ */
+void CommandEncoder::keepTiming(size_t clock)
+{
+  this->setCommand(clock, FRAME_COMMAND_TIMING_KEEP, NULL, 0);
+}
+
+/**
+ * @brief Number of frames until every command was sent: the longest command.
+ */
+size_t CommandEncoder::getRemainingFrames() const
+{
+  size_t frames = 0;
+  for (size_t clock = 0; clock < this->clocks; clock++)
+  {
+    if (this->lengths[clock] > frames)
+      frames = this->lengths[clock];
+  }
+  return frames > this->sent ? frames - this->sent : 0;
+}
+
+bool CommandEncoder::hasNextFrame() const
+{
+  return this->getRemainingFrames() > 0;
+}
+
+/**
+ * @brief Writes the next frame: the next instruction of every command.
+ *
+ * The frame is complete (see Frame::setComplete()), an argument 0 is sent like any other argument.
+ */
+void CommandEncoder::nextFrame(Frame &frame)
+{
+  frame = Frame(this->clocks);
+  frame.setComplete(true);
+
+  for (size_t clock = 0; clock < this->clocks; clock++)
+  {
+    if (this->sent < this->lengths[clock])
+      frame.setInstruction(clock, this->instructions[clock][this->sent]);
+  }
+  this->sent++;
+}
+
+/**
+ * @brief Writes the frames of all commands.
+ *
+ * @param frames Receives the frames. The caller owns the memory, nothing is allocated.
+ * @param max_frames Capacity of frames, MAX_COMMAND_FRAMES is always enough.
+ * @return size_t Number of written frames.
+ */
+size_t CommandEncoder::encode(Frame *frames, size_t max_frames)
+{
+  size_t count = 0;
+  while (count < max_frames && this->hasNextFrame())
+  {
+    this->nextFrame(frames[count++]);
+  }
+  return count;
+}
+
+void CommandEncoder::setCommand(size_t clock, uint8_t code, const uint8_t *arguments, size_t length)
+{
+  if (clock >= this->clocks || length + 2 > MAX_COMMAND_FRAMES)
+    return;
+
+  this->instructions[clock][0] = FRAME_COMMAND_ESCAPE;
+  this->instructions[clock][1] = code;
+  for (size_t i = 0; i < length; i++)
+  {
+    this->instructions[clock][2 + i] = arguments[i];
+  }
+  this->lengths[clock] = length + 2;
+}
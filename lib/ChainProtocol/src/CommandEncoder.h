@@ -0,0 +1,52 @@
+#ifndef _COMMAND_ENCODER_H_
+#define _COMMAND_ENCODER_H_
+
+#include "Frame.h"
+
+#define FRAME_COMMAND_ESCAPE 0xD // must match COMMAND_ESCAPE of the clock firmware
+#define MAX_COMMAND_FRAMES 16    // escape, code and COMMAND_MAX_ARGUMENTS of the clock firmware
+#define MACRO_STORE_PAUSE 30000  // us the clocks need to write a macro move to EEPROM, no frames must be sent meanwhile
+
+enum FrameCommand
+{
+  FRAME_COMMAND_VELOCITY = 0x1,    // must match COMMAND_VELOCITY of the clock firmware
+  FRAME_COMMAND_MACRO_STORE = 0x2, // must match COMMAND_MACRO_STORE
+  FRAME_COMMAND_MACRO_PLAY = 0x3,  // must match COMMAND_MACRO_PLAY
+  FRAME_COMMAND_TIMING = 0x4,      // must match COMMAND_TIMING
+  FRAME_COMMAND_TIMING_KEEP = 0x5, // must match COMMAND_TIMING_KEEP
+};
+
+/**
+ * @brief Turns commands for the clocks into frames.
+ *
+ * A command does not fit into the four bits of a frame: every clock receives the escape instruction, the command code and its arguments
+ * in consecutive frames. Every clock can get its own command, all commands are sent in parallel.
+ * Clocks without a command keep their hands still, their rotation is not changed.
+ */
+class CommandEncoder
+{
+public:
+  explicit CommandEncoder(size_t clocks);
+
+  void clear();
+  void setVelocity(size_t clock, int8_t hour_speed, int8_t minute_speed);
+  void storeMacroMove(size_t clock, uint8_t slot, uint8_t index, int16_t hour_steps, int16_t minute_steps, uint16_t frames);
+  void playMacro(size_t clock, uint8_t slot);
+  void setTiming(size_t clock, uint8_t clock_out_high, uint16_t frame_gap);
+  void keepTiming(size_t clock);
+
+  size_t getRemainingFrames() const;
+  bool hasNextFrame() const;
+  void nextFrame(Frame &frame);
+  size_t encode(Frame *frames, size_t max_frames);
+
+private:
+  void setCommand(size_t clock, uint8_t code, const uint8_t *arguments, size_t length);
+
+  uint8_t instructions[MAX_CHAIN_LENGTH][MAX_COMMAND_FRAMES];
+  uint8_t lengths[MAX_CHAIN_LENGTH]; // instructions of the command of a clock, 0 = no command
+  size_t clocks;
+  size_t sent; // frames already written by nextFrame()
+};
+
+#endif
@@ -0,0 +1,176 @@
+#include "Frame.h"
+#include "FrameAddressing.h"
+#include <string.h>
+
+Frame::Frame() : Frame(0)
+{
+}
+
+Frame::Frame(size_t clocks)
+{
+  this->clocks = clocks > MAX_CHAIN_LENGTH ? MAX_CHAIN_LENGTH : clocks;
+  this->complete = false;
+  this->clear();
+}
+
+/**
+ * @brief Sets all instructions to keep the hands still.
+ */
+void Frame::clear()
+{
+  memset(this->data, 0, sizeof(this->data));
+}
+
+size_t Frame::getClocks() const
+{
+  return this->clocks;
+}
+
+/**
+ * @brief Sets the four bit instruction of a clock.
+ *
+ * @param clock Position of the clock in the chain. 0 is the first clock.
+ * @param instruction Hour hand in the upper two bits, minute hand in the lower two bits.
+ */
+void Frame::setInstruction(size_t clock, uint8_t instruction)
+{
+  uint8_t &byte = this->data[clock / 2];
+  if (clock % 2 == 0)
+    byte = (byte & 0x0F) | ((instruction & 0x0F) << 4);
+  else
+    byte = (byte & 0xF0) | (instruction & 0x0F);
+}
+
+uint8_t Frame::getInstruction(size_t clock) const
+{
+  uint8_t byte = this->data[clock / 2];
+  return clock % 2 == 0 ? byte >> 4 : byte & 0x0F;
+}
+
+void Frame::setHand(size_t clock, Hand hand, HandInstruction instruction)
+{
+  uint8_t current = this->getInstruction(clock);
+  if (hand == HOUR_HAND)
+    this->setInstruction(clock, (current & 0x3) | (instruction << 2));
+  else
+    this->setInstruction(clock, (current & 0xC) | instruction);
+}
+
+HandInstruction Frame::getHand(size_t clock, Hand hand) const
+{
+  uint8_t current = this->getInstruction(clock);
+  return (HandInstruction)(hand == HOUR_HAND ? current >> 2 : current & 0x3);
+}
+
+/**
+ * @brief Sets every hand of the chain to calibrate (11).
+ */
+void Frame::calibrateAll()
+{
+  memset(this->data, 0xFF, this->getSize());
+  if (this->clocks % 2 == 1)
+    this->data[this->clocks / 2] = 0xF0;
+}
+
+/**
+ * @brief Checks if all hands keep still. A complete frame is still sent, its zeros are data.
+ */
+bool Frame::isIdle() const
+{
+  for (size_t i = 0; i < this->getSize(); i++)
+  {
+    if (this->data[i] != 0)
+      return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Number of clocks up to the last clock that has to move.
+ *
+ * The clocks after it do not need an instruction: A clock without an instruction in a frame keeps its hands still.
+ * Complete frames (see setComplete()) and marked frames (see isMarkedFrame()) are not truncated, their zeros are data.
+ */
+size_t Frame::getActiveClocks() const
+{
+  if (this->complete || isMarkedFrame(*this))
+    return this->clocks;
+  for (size_t clock = this->clocks; clock > 0; clock--)
+  {
+    if (this->getInstruction(clock - 1) != 0)
+      return clock;
+  }
+  return 0;
+}
+
+/**
+ * @brief Sends every instruction of the frame, also trailing zeros and a frame of zeros.
+ *
+ * Used for frames whose instructions are data, e.g. the arguments of commands (see CommandEncoder).
+ */
+void Frame::setComplete(bool complete)
+{
+  this->complete = complete;
+}
+
+bool Frame::isComplete() const
+{
+  return this->complete;
+}
+
+const uint8_t *Frame::getData() const
+{
+  return this->data;
+}
+
+/**
+ * @brief Number of bytes used by the packed instructions.
+ */
+size_t Frame::getSize() const
+{
+  return (this->clocks + 1) / 2;
+}
+
+/**
+ * @brief Writes the frame as it is sent to the chain head: FRAME_SYNC, the number of instructions and the packed instructions.
+ *
+ * Only the instructions up to the last active clock are written (see getActiveClocks()).
+ * An idle frame is not written at all, there is nothing to send, unless it is complete.
+ *
+ * @param buffer Must have space for MAX_SERIALIZED_FRAME_BYTES bytes.
+ * @return size_t Number of written bytes. 0 for an idle frame.
+ */
+size_t Frame::serialize(uint8_t *buffer) const
+{
+  size_t active = this->getActiveClocks();
+  if (active == 0)
+    return 0;
+
+  size_t size = (active + 1) / 2;
+  buffer[0] = FRAME_SYNC;
+  buffer[1] = active;
+  memcpy(buffer + 2, this->data, size);
+  if (active % 2 == 1)
+    buffer[1 + size] &= 0xF0; // The unused half of the last byte is always 0
+  return size + 2;
+}
+
+/**
+ * @brief Reads a frame written by serialize(), as the chain head receives it.
+ *
+ * The frame has the transmitted instructions only and is complete: the chain head clocks out every received instruction.
+ *
+ * @return false if the buffer does not contain a whole frame.
+ */
+bool Frame::deserialize(const uint8_t *buffer, size_t size)
+{
+  if (size < 2 || buffer[0] != FRAME_SYNC || buffer[1] == 0 || buffer[1] > MAX_CHAIN_LENGTH || size < 2 + (buffer[1] + 1) / 2U)
+    return false;
+
+  *this = Frame(buffer[1]);
+  memcpy(this->data, buffer + 2, this->getSize());
+  if (this->clocks % 2 == 1)
+    this->data[this->clocks / 2] &= 0xF0;
+  this->complete = true;
+  return true;
+}
@@ -0,0 +1,68 @@
+#ifndef _FRAME_H_
+#define _FRAME_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MAX_CHAIN_LENGTH 64
+#define MAX_FRAME_BYTES ((MAX_CHAIN_LENGTH + 1) / 2)
+#define FRAME_SYNC 0xA5 // must match CHAIN_HEAD_SYNC of the chain head firmware
+#define MAX_SERIALIZED_FRAME_BYTES (MAX_FRAME_BYTES + 2)
+
+enum Hand
+{
+  HOUR_HAND = 0,
+  MINUTE_HAND = 1
+};
+
+enum HandInstruction
+{
+  HAND_STILL = 0x0,     // 00
+  HAND_FORWARD = 0x1,   // 01
+  HAND_BACKWARD = 0x2,  // 10
+  HAND_CALIBRATE = 0x3, // 11, hour hand calibrate with minute hand forward starts a command, see CommandEncoder
+};
+
+/**
+ * @brief A single tick for every clock of the chain.
+ *
+ * The instructions are bit packed as they are sent to the chain head: two clocks per byte, the first clock in the upper four bits.
+ * Within the four bits the upper two bits are for the hour hand, the lower two bits for the minute hand.
+ * A frame has a fixed capacity of MAX_CHAIN_LENGTH clocks and never allocates.
+ *
+ * The instruction 0 (keep still) means "nothing to do": the instructions after the last non-zero one are not sent (getActiveClocks())
+ * and a frame of zeros is not sent at all (serialize()). Frames that carry data in their instructions, where 0 is a value
+ * (command arguments, indexes, counters), must be sent complete: setComplete() turns off the truncation and idle skipping.
+ * Marked frames (see isMarkedFrame()) are always complete.
+ */
+class Frame
+{
+public:
+  Frame();
+  explicit Frame(size_t clocks);
+
+  void clear();
+  size_t getClocks() const;
+
+  void setInstruction(size_t clock, uint8_t instruction);
+  uint8_t getInstruction(size_t clock) const;
+  void setHand(size_t clock, Hand hand, HandInstruction instruction);
+  HandInstruction getHand(size_t clock, Hand hand) const;
+  void calibrateAll();
+  bool isIdle() const;
+  size_t getActiveClocks() const;
+  void setComplete(bool complete);
+  bool isComplete() const;
+
+  const uint8_t *getData() const;
+  size_t getSize() const;
+  size_t serialize(uint8_t *buffer) const;
+  bool deserialize(const uint8_t *buffer, size_t size);
+
+private:
+  uint8_t data[MAX_FRAME_BYTES];
+  uint8_t clocks;
+  bool complete; // every instruction is sent, also zeros
+};
+
+#endif
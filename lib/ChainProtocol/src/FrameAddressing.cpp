@@ -0,0 +1,94 @@
+#include "FrameAddressing.h"
+
+/**
+ * @brief Checks if the first instruction marks an addressed, enumeration or telemetry frame, which every clock passes on completely.
+ *
+ * Only the first clock decides: the host must not send marked frames while a command is received (see CommandEncoder),
+ * the clocks take the marker as argument of the command then.
+ */
+bool isMarkedFrame(const Frame &frame)
+{
+  if (frame.getClocks() == 0)
+    return false;
+  uint8_t marker = frame.getInstruction(0);
+  return marker == FRAME_MARKER_ADDRESSED || marker == FRAME_MARKER_ENUMERATION || marker == FRAME_MARKER_TELEMETRY;
+}
+
+/**
+ * @brief Writes the enumeration frame: the marker and the counter 0.
+ *
+ * Every clock takes the counter as its index and passes it on incremented. The indexes are kept until the clocks restart,
+ * the enumeration has to be repeated after a power cycle of the wall.
+ */
+void encodeEnumeration(Frame &frame)
+{
+  frame = Frame(3);
+  frame.setInstruction(0, FRAME_MARKER_ENUMERATION);
+}
+
+/**
+ * @brief Reads the counter of an enumeration frame read back behind the last clock: the number of clocks in the chain.
+ *
+ * @return false if the frame is no enumeration frame.
+ */
+bool decodeEnumeration(const Frame &frame, size_t &clocks)
+{
+  if (frame.getClocks() < 3 || frame.getInstruction(0) != FRAME_MARKER_ENUMERATION)
+    return false;
+  clocks = frame.getInstruction(2) << 4 | frame.getInstruction(1);
+  return true;
+}
+
+/**
+ * @brief Converts a frame into an addressed frame, that only carries the instructions of the clocks that do something.
+ *
+ * The addressed frame is the marker and an (index upper nibble, index lower nibble, instruction) triple per clock.
+ * The clocks must be enumerated (see encodeEnumeration()), the frame index of a clock is its index.
+ *
+ * @return false if the addressed frame is not shorter than the active clocks of the frame, the frame should be sent as it is.
+ */
+bool encodeAddressed(const Frame &frame, Frame &addressed)
+{
+  if (isMarkedFrame(frame))
+    return false;
+
+  size_t moving = 0;
+  for (size_t clock = 0; clock < frame.getClocks(); clock++)
+  {
+    if (frame.getInstruction(clock) != 0)
+      moving++;
+  }
+  if (moving == 0 || moving > MAX_ADDRESSED_CLOCKS || 1 + 3 * moving >= frame.getActiveClocks())
+    return false;
+
+  addressed = Frame(1);
+  addressed.setInstruction(0, FRAME_MARKER_ADDRESSED);
+  for (size_t clock = 0; clock < frame.getClocks(); clock++)
+  {
+    if (frame.getInstruction(clock) != 0)
+      addAddressedInstruction(addressed, clock, frame.getInstruction(clock));
+  }
+  return true;
+}
+
+/**
+ * @brief Appends an instruction for the clock with the given index (or FRAME_ADDRESS_BROADCAST) to an addressed frame.
+ *
+ * @param addressed Frame that starts with FRAME_MARKER_ADDRESSED.
+ * @return false if the frame is full.
+ */
+bool addAddressedInstruction(Frame &addressed, uint8_t index, uint8_t instruction)
+{
+  size_t length = addressed.getClocks();
+  if (length + 3 > MAX_CHAIN_LENGTH)
+    return false;
+
+  Frame extended(length + 3);
+  for (size_t i = 0; i < length; i++)
+    extended.setInstruction(i, addressed.getInstruction(i));
+  extended.setInstruction(length, index >> 4);
+  extended.setInstruction(length + 1, index & 0x0F);
+  extended.setInstruction(length + 2, instruction);
+  addressed = extended;
+  return true;
+}
@@ -0,0 +1,20 @@
+#ifndef _FRAME_ADDRESSING_H_
+#define _FRAME_ADDRESSING_H_
+
+#include "Frame.h"
+
+#define FRAME_MARKER_ADDRESSED 0x7                 // must match FRAME_ADDRESSED of the clock firmware
+#define FRAME_MARKER_ENUMERATION 0xB               // must match FRAME_ENUMERATION
+#define FRAME_ADDRESS_BROADCAST 0xFF               // must match ADDRESS_BROADCAST
+#define FRAME_MARKER_TELEMETRY 0xE                 // must match FRAME_TELEMETRY, see FrameTelemetry.h
+#define MAX_ADDRESSED_CLOCKS ((MAX_CHAIN_LENGTH - 1) / 3) // (index, instruction) triples that fit behind the marker
+
+bool isMarkedFrame(const Frame &frame);
+
+void encodeEnumeration(Frame &frame);
+bool decodeEnumeration(const Frame &frame, size_t &clocks);
+
+bool encodeAddressed(const Frame &frame, Frame &addressed);
+bool addAddressedInstruction(Frame &addressed, uint8_t index, uint8_t instruction);
+
+#endif
@@ -0,0 +1,110 @@
+#include "FrameEncoder.h"
+
+FrameEncoder::FrameEncoder(size_t clocks)
+{
+  this->clocks = clocks > MAX_CHAIN_LENGTH ? MAX_CHAIN_LENGTH : clocks;
+  for (size_t i = 0; i < MAX_CHAIN_LENGTH * 2; i++)
+  {
+    this->remaining[i] = 0;
+  }
+}
+
+/**
+ * @brief Sets the steps a hand still has to move.
+ *
+ * @param steps Negative = backward, positive = forward.
+ */
+void FrameEncoder::setSteps(size_t clock, Hand hand, long steps)
+{
+  this->remaining[clock * 2 + hand] = steps;
+}
+
+/**
+ * @brief Sets the steps of all hands at once.
+ *
+ * @param steps Array with two entries per clock: steps[clock * 2 + hand].
+ */
+void FrameEncoder::setSteps(const long *steps)
+{
+  for (size_t i = 0; i < this->clocks * 2; i++)
+  {
+    this->remaining[i] = steps[i];
+  }
+}
+
+long FrameEncoder::getSteps(size_t clock, Hand hand) const
+{
+  return this->remaining[clock * 2 + hand];
+}
+
+/**
+ * @brief Number of frames until every hand reached its target.
+ */
+size_t FrameEncoder::getRemainingFrames() const
+{
+  size_t frames = 0;
+  for (size_t i = 0; i < this->clocks * 2; i++)
+  {
+    size_t steps = this->remaining[i] < 0 ? -this->remaining[i] : this->remaining[i];
+    if (steps > frames)
+      frames = steps;
+  }
+  return frames;
+}
+
+bool FrameEncoder::hasNextFrame() const
+{
+  for (size_t i = 0; i < this->clocks * 2; i++)
+  {
+    if (this->remaining[i] != 0)
+      return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Writes the next frame and removes its steps from the remaining steps.
+ */
+void FrameEncoder::nextFrame(Frame &frame)
+{
+  frame = Frame(this->clocks);
+
+  for (size_t clock = 0; clock < this->clocks; clock++)
+  {
+    uint8_t instruction = 0;
+    for (size_t hand = 0; hand < 2; hand++)
+    {
+      long &steps = this->remaining[clock * 2 + hand];
+      uint8_t bits = HAND_STILL;
+      if (steps > 0)
+      {
+        bits = HAND_FORWARD;
+        steps--;
+      }
+      else if (steps < 0)
+      {
+        bits = HAND_BACKWARD;
+        steps++;
+      }
+      instruction = (instruction << 2) | bits;
+    }
+    frame.setInstruction(clock, instruction);
+  }
+}
+
+/**
+ * @brief Writes the frames for all remaining steps.
+ *
+ * @param frames Receives the frames. The caller owns the memory, nothing is allocated.
+ * @param max_frames Capacity of frames.
+ * @return size_t Number of written frames. Less than getRemainingFrames() if max_frames was too small.
+ */
+size_t FrameEncoder::encode(Frame *frames, size_t max_frames)
+{
+  size_t count = 0;
+  while (count < max_frames && this->hasNextFrame())
+  {
+    this->nextFrame(frames[count++]);
+  }
+  return count;
+}
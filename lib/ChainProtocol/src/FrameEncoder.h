@@ -0,0 +1,31 @@
+#ifndef _FRAME_ENCODER_H_
+#define _FRAME_ENCODER_H_
+
+#include "Frame.h"
+
+/**
+ * @brief Turns step deltas of every hand into the tick stream for the chain.
+ *
+ * Every frame moves each hand with remaining steps by one step in its direction.
+ * The number of frames is the largest delta of all hands.
+ */
+class FrameEncoder
+{
+public:
+  explicit FrameEncoder(size_t clocks);
+
+  void setSteps(size_t clock, Hand hand, long steps);
+  void setSteps(const long *steps);
+  long getSteps(size_t clock, Hand hand) const;
+
+  size_t getRemainingFrames() const;
+  bool hasNextFrame() const;
+  void nextFrame(Frame &frame);
+  size_t encode(Frame *frames, size_t max_frames);
+
+private:
+  long remaining[MAX_CHAIN_LENGTH * 2]; // [clock * 2 + hand], negative = backward, positive = forward
+  size_t clocks;
+};
+
+#endif
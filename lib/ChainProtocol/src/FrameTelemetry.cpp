@@ -0,0 +1,40 @@
+#include "FrameTelemetry.h"
+
+/**
+ * @brief Writes a telemetry frame that polls the clocks with the indexes first to first + records - 1.
+ *
+ * Every polled clock overwrites its record while passing the frame on, the host reads the frame back behind the last clock.
+ * The clocks must be enumerated (see encodeEnumeration()). The records of missing clocks return as zeros.
+ * With the chain head a frame has CHAIN_LENGTH instructions at most, one record for a chain of 24 clocks.
+ */
+void encodeTelemetryRequest(Frame &frame, uint8_t first, size_t records)
+{
+  if (records > MAX_TELEMETRY_RECORDS)
+    records = MAX_TELEMETRY_RECORDS;
+  frame = Frame(3 + records * FRAME_TELEMETRY_NIBBLES);
+  frame.setInstruction(0, FRAME_MARKER_TELEMETRY);
+  frame.setInstruction(1, first >> 4);
+  frame.setInstruction(2, first & 0x0F);
+}
+
+/**
+ * @brief Reads a record of a returned telemetry frame, the record of the clock with the index first + record.
+ *
+ * @return false if the frame is no telemetry frame or too short.
+ */
+bool decodeTelemetry(const Frame &frame, size_t record, ClockTelemetry &telemetry)
+{
+  size_t start = 3 + record * FRAME_TELEMETRY_NIBBLES;
+  if (frame.getClocks() < start + FRAME_TELEMETRY_NIBBLES || frame.getInstruction(0) != FRAME_MARKER_TELEMETRY)
+    return false;
+
+  for (size_t hand = 0; hand < 2; hand++)
+  {
+    telemetry.positions[hand] = 0;
+    for (size_t i = 0; i < 4; i++)
+      telemetry.positions[hand] = telemetry.positions[hand] << 4 | frame.getInstruction(start + hand * 4 + i);
+    telemetry.recalibrations[hand] = frame.getInstruction(start + 8 + hand);
+  }
+  telemetry.dropped_instructions = frame.getInstruction(start + 10) << 4 | frame.getInstruction(start + 11);
+  return true;
+}
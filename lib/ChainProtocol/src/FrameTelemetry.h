@@ -0,0 +1,22 @@
+#ifndef _FRAME_TELEMETRY_H_
+#define _FRAME_TELEMETRY_H_
+
+#include "FrameAddressing.h"
+
+#define FRAME_TELEMETRY_NIBBLES 12 // must match TELEMETRY_NIBBLES of the clock firmware
+#define MAX_TELEMETRY_RECORDS ((MAX_CHAIN_LENGTH - 3) / FRAME_TELEMETRY_NIBBLES)
+
+/**
+ * @brief Status of a clock read back from a telemetry frame, see Telemetry.h of the clock firmware.
+ */
+struct ClockTelemetry
+{
+  uint16_t positions[2];        // [Hand]
+  uint8_t recalibrations[2];    // [Hand], modulo 16: wraps from 15 to 0, compare with the previous record to count them
+  uint8_t dropped_instructions; // modulo 256
+};
+
+void encodeTelemetryRequest(Frame &frame, uint8_t first, size_t records);
+bool decodeTelemetry(const Frame &frame, size_t record, ClockTelemetry &telemetry);
+
+#endif
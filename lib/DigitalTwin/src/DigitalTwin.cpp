@@ -0,0 +1,673 @@
+#include "DigitalTwin.h"
+#include <stdlib.h>
+#include <FrameTelemetry.h>
+#include "../../../src/Config.h"
+#include "../../../src/Utils.h"
+
+DigitalTwin::DigitalTwin(size_t clocks, unsigned long frame_period)
+{
+  this->clocks = clocks > MAX_CHAIN_LENGTH ? MAX_CHAIN_LENGTH : clocks;
+  this->frame_period = frame_period;
+
+  for (size_t i = 0; i < MAX_CHAIN_LENGTH * 2; i++)
+  {
+    this->hands[i].field_width = TWIN_DEFAULT_FIELD_WIDTH;
+    this->hands[i].min_step_delay = MIN_STEP_DELAY;
+    this->hands[i].acceleration = 0;
+  }
+  for (size_t clock = 0; clock < MAX_CHAIN_LENGTH; clock++)
+  {
+    for (size_t slot = 0; slot < MACRO_SLOTS; slot++)
+    {
+      this->macros[clock][slot].length = 0;
+    }
+  }
+
+  this->reset();
+}
+
+/**
+ * @brief Starts the simulation again with all hands calibrated at position 0, like after the startup of the chain.
+ *
+ * The field widths, tunings and lost steps set before are kept.
+ */
+void DigitalTwin::reset()
+{
+  this->now = 0;
+  for (size_t clock = 0; clock < MAX_CHAIN_LENGTH; clock++)
+  {
+    this->calibrating_until[clock] = 0;
+    this->instruction_pending[clock] = false;
+    this->pending_instruction[clock] = 0;
+    this->command_pending[clock] = false;
+    this->commands[clock].reset();
+    this->players[clock].stop();
+    this->indexes[clock] = ADDRESS_BROADCAST;
+    this->dropped_instructions[clock] = 0;
+    this->timings[clock].clock_out_high = CLOCK_OUT_HIGH;
+    this->timings[clock].frame_gap = DELAY_BETWEEN_INSTRUCTIONS;
+    this->timings[clock].trial = false;
+  }
+  Frame returned;
+  while (this->returned.pop(returned))
+    ;
+  for (size_t i = 0; i < MAX_CHAIN_LENGTH * 2; i++)
+  {
+    this->hands[i].recalibrations = 0;
+    this->hands[i].governor.reset();
+    this->finishCalibration(this->hands[i], 0);
+  }
+}
+
+/**
+ * @brief Applies the frame as a real output transmits it and lets the motors run for one frame period.
+ *
+ * Like SerialOutput and GpioOutput, the instructions after the last active clock are not sent and idle frames are skipped
+ * (Frame::serialize()), frames that lose data this way are not received completely by the clocks either.
+ */
+bool DigitalTwin::send(const Frame &frame)
+{
+  uint8_t buffer[MAX_SERIALIZED_FRAME_BYTES];
+  Frame transmitted;
+  if (transmitted.deserialize(buffer, frame.serialize(buffer)))
+    this->apply(transmitted);
+  this->advance(this->frame_period);
+  return true;
+}
+
+/**
+ * @brief Every clock receives its own instruction of the frame at the current time.
+ *
+ * Clocks behind the end of the frame do not receive anything, like in the chain.
+ * An enumeration frame gives every clock its index, an addressed frame reaches all clocks and every clock takes the instructions
+ * with its index. The frame type is decided by the first clock, while it receives a command the frame is a plain frame.
+ * The instructions the last clock passes on can be read with receive().
+ */
+void DigitalTwin::apply(const Frame &frame)
+{
+  if (isMarkedFrame(frame) && !this->commands[0].isReceiving())
+  {
+    this->applyMarked(frame);
+    return;
+  }
+
+  size_t clocks = frame.getClocks() < this->clocks ? frame.getClocks() : this->clocks;
+  for (size_t clock = 0; clock < clocks; clock++)
+  {
+    this->receive(clock, frame.getInstruction(clock), this->now);
+  }
+
+  if (frame.getClocks() > this->clocks)
+  {
+    Frame returned(frame.getClocks() - this->clocks);
+    for (size_t i = 0; i < returned.getClocks(); i++)
+      returned.setInstruction(i, frame.getInstruction(this->clocks + i));
+    this->returned.push(returned);
+  }
+}
+
+/**
+ * @brief Returns the next frame passed on by the last clock, like the chain head does with CHAIN_HEAD_RETURN.
+ *
+ * The frames are returned while they are applied, the timeout is not used.
+ */
+bool DigitalTwin::receive(Frame &frame, unsigned int timeout_ms)
+{
+  return this->returned.pop(frame);
+}
+
+/**
+ * @brief Status of a clock as it reports it in a telemetry frame.
+ */
+void DigitalTwin::getTelemetry(size_t clock, Telemetry &telemetry) const
+{
+  for (size_t hand = 0; hand < 2; hand++)
+  {
+    telemetry.positions[hand] = this->hands[clock * 2 + hand].position;
+    telemetry.recalibrations[hand] = toTelemetryRecalibrations(this->hands[clock * 2 + hand].recalibrations);
+  }
+  telemetry.dropped_instructions = this->dropped_instructions[clock];
+}
+
+/**
+ * @brief Processes a marked frame like ClockCommunication::processFrameInstruction() of every clock.
+ */
+void DigitalTwin::applyMarked(const Frame &frame)
+{
+  Frame returned = frame;
+  if (frame.getInstruction(0) == FRAME_ENUMERATION)
+  {
+    // The counter is incremented by every clock, an incomplete counter gives no index
+    if (frame.getClocks() >= 3)
+    {
+      uint8_t counter = frame.getInstruction(2) << 4 | frame.getInstruction(1);
+      for (size_t clock = 0; clock < this->clocks; clock++)
+      {
+        this->indexes[clock] = counter + clock;
+      }
+      counter += this->clocks;
+      returned.setInstruction(1, counter & 0x0F);
+      returned.setInstruction(2, counter >> 4);
+    }
+    this->returned.push(returned);
+    return;
+  }
+
+  if (frame.getInstruction(0) == FRAME_TELEMETRY)
+  {
+    uint8_t first = frame.getClocks() >= 3 ? frame.getInstruction(1) << 4 | frame.getInstruction(2) : 0;
+    for (size_t i = 3; i < frame.getClocks(); i++)
+    {
+      uint8_t index = first + (i - 3) / TELEMETRY_NIBBLES;
+      for (size_t clock = 0; clock < this->clocks; clock++)
+      {
+        if (index != ADDRESS_BROADCAST && index == this->indexes[clock])
+        {
+          Telemetry telemetry;
+          this->getTelemetry(clock, telemetry);
+          returned.setInstruction(i, getTelemetryNibble(telemetry, (i - 3) % TELEMETRY_NIBBLES));
+        }
+      }
+    }
+    this->returned.push(returned);
+    return;
+  }
+
+  for (size_t i = 1; i + 2 < frame.getClocks(); i += 3)
+  {
+    uint8_t address = frame.getInstruction(i) << 4 | frame.getInstruction(i + 1);
+    for (size_t clock = 0; clock < this->clocks; clock++)
+    {
+      if (address == this->indexes[clock] || address == ADDRESS_BROADCAST)
+      {
+        this->receive(clock, frame.getInstruction(i + 2), this->now);
+      }
+    }
+  }
+  this->returned.push(returned);
+}
+
+/**
+ * @brief Lets the motors of all clocks run for the given time.
+ */
+void DigitalTwin::advance(uint64_t micros)
+{
+  uint64_t until = this->now + micros;
+
+  for (size_t clock = 0; clock < this->clocks; clock++)
+  {
+    // The main loop processes the last own instruction and command after calibrateMotors() returned
+    while ((this->instruction_pending[clock] || this->command_pending[clock]) && this->calibrating_until[clock] <= until)
+      this->process(clock, this->calibrating_until[clock]);
+
+    // playMacro() executes the next instruction every MACRO_FRAME_PERIOD
+    while (this->players[clock].isPlaying() && this->macro_micros[clock] <= until)
+    {
+      uint64_t micros = this->macro_micros[clock];
+      this->macro_micros[clock] += MACRO_FRAME_PERIOD;
+      this->executeInstruction(clock, this->players[clock].next(), micros);
+    }
+
+    this->runMotor(this->hands[clock * 2 + HOUR_HAND], until);
+    this->runMotor(this->hands[clock * 2 + MINUTE_HAND], until);
+
+    // ClockCommunication::checkTimingTrial()
+    TwinTiming &timing = this->timings[clock];
+    if (timing.trial && timing.trial_until <= until)
+    {
+      timing.clock_out_high = timing.kept_clock_out_high;
+      timing.frame_gap = timing.kept_frame_gap;
+      timing.trial = false;
+    }
+  }
+
+  this->now = until;
+}
+
+/**
+ * @brief Advances until every planned step and calibration is done.
+ */
+void DigitalTwin::settle()
+{
+  while (!this->isSettled())
+  {
+    this->advance(this->frame_period > 0 ? this->frame_period : MIN_STEP_DELAY);
+  }
+}
+
+size_t DigitalTwin::getClocks() const
+{
+  return this->clocks;
+}
+
+/**
+ * @brief Index of the clock learned from the last enumeration frame, ADDRESS_BROADCAST before.
+ */
+uint8_t DigitalTwin::getIndex(size_t clock) const
+{
+  return this->indexes[clock];
+}
+
+uint64_t DigitalTwin::getMicros() const
+{
+  return this->now;
+}
+
+bool DigitalTwin::isSettled() const
+{
+  for (size_t clock = 0; clock < this->clocks; clock++)
+  {
+    if (this->isCalibrating(clock) || this->instruction_pending[clock] || this->command_pending[clock] || this->players[clock].isPlaying() ||
+        this->hands[clock * 2 + HOUR_HAND].planned_steps != 0 || this->hands[clock * 2 + MINUTE_HAND].planned_steps != 0)
+      return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Checks if the clock is blocked by calibrateMotors(). The positions are already those after the calibration.
+ */
+bool DigitalTwin::isCalibrating(size_t clock) const
+{
+  return this->now < this->calibrating_until[clock];
+}
+
+/**
+ * @brief Position the firmware believes the hand is at (Motor::current_pos).
+ */
+uint16_t DigitalTwin::getPosition(size_t clock, Hand hand) const
+{
+  return this->hands[clock * 2 + hand].position;
+}
+
+/**
+ * @brief Position the hand really is at. Only differs from getPosition() after loseSteps().
+ */
+uint16_t DigitalTwin::getPhysicalPosition(size_t clock, Hand hand) const
+{
+  return this->hands[clock * 2 + hand].physical;
+}
+
+long DigitalTwin::getPlannedSteps(size_t clock, Hand hand) const
+{
+  return this->hands[clock * 2 + hand].planned_steps;
+}
+
+unsigned long DigitalTwin::getRecalibrations(size_t clock, Hand hand) const
+{
+  return this->hands[clock * 2 + hand].recalibrations;
+}
+
+/**
+ * @brief Shortest step delay of the motor: the tuning, derated by the speed governor (Motor::getMinStepDelay()).
+ */
+unsigned int DigitalTwin::getMinStepDelay(size_t clock, Hand hand) const
+{
+  const TwinHand &twin_hand = this->hands[clock * 2 + hand];
+  return twin_hand.governor.getStepDelay(twin_hand.min_step_delay);
+}
+
+/**
+ * @brief Bus timing the clock uses, changed by COMMAND_TIMING.
+ */
+const TwinTiming &DigitalTwin::getTiming(size_t clock) const
+{
+  return this->timings[clock];
+}
+
+/**
+ * @brief Copies the positions every hand will reach after its planned steps, as input for MotionPlanner::plan().
+ *
+ * @param positions Array with two entries per clock [clock * 2 + hand].
+ */
+void DigitalTwin::getPositions(uint16_t *positions) const
+{
+  for (size_t i = 0; i < this->clocks * 2; i++)
+  {
+    const TwinHand &hand = this->hands[i];
+    long steps = hand.planned_steps % MAX_STEPS;
+    positions[i] = (hand.position + MAX_STEPS + steps) % MAX_STEPS;
+  }
+}
+
+/**
+ * @brief Sets the width of the magnet field of a hand. Takes effect with the next calibration or reset().
+ */
+void DigitalTwin::setFieldWidth(size_t clock, Hand hand, uint16_t field_width)
+{
+  this->hands[clock * 2 + hand].field_width = field_width;
+}
+
+/**
+ * @brief Sets the tuning of a motor, as found by the self-test of the clock (Motor::setTuning()).
+ *
+ * @param min_step_delay Fastest step delay of the motor in us.
+ * @param acceleration Delay reduction per step in us when accelerating from MIN_STEP_DELAY.
+ */
+void DigitalTwin::setTuning(size_t clock, Hand hand, unsigned int min_step_delay, unsigned int acceleration)
+{
+  this->hands[clock * 2 + hand].min_step_delay = min_step_delay;
+  this->hands[clock * 2 + hand].acceleration = acceleration;
+}
+
+/**
+ * @brief Simulates lost steps: The hand stays behind, but the firmware does not notice until the next field crossing.
+ *
+ * @param steps Positive steps are lost while rotating forwards, negative while rotating backwards.
+ */
+void DigitalTwin::loseSteps(size_t clock, Hand hand, long steps)
+{
+  TwinHand &twin_hand = this->hands[clock * 2 + hand];
+  twin_hand.physical = (twin_hand.physical + MAX_STEPS - steps % MAX_STEPS) % MAX_STEPS;
+  this->sense(twin_hand);
+}
+
+/**
+ * @brief Receives an own instruction like ClockCommunication::updateOwnInstruction(): commands are parsed at once.
+ *
+ * While the clock calibrates, only the last step instruction and the last command are kept (OwnInstruction is overwritten by the ISR).
+ */
+void DigitalTwin::receive(size_t clock, uint8_t instruction, uint64_t micros)
+{
+  if (this->commands[clock].receive(instruction))
+  {
+    if (!this->commands[clock].isComplete())
+      return;
+    if (this->command_pending[clock])
+      this->dropped_instructions[clock]++;
+    this->pending_command[clock] = this->commands[clock].getCommand();
+    this->command_pending[clock] = true;
+  }
+  else
+  {
+    if (this->instruction_pending[clock])
+      this->dropped_instructions[clock]++;
+    this->pending_instruction[clock] = instruction;
+    this->instruction_pending[clock] = true;
+  }
+
+  if (micros >= this->calibrating_until[clock])
+    this->process(clock, micros);
+}
+
+/**
+ * @brief Executes the pending command and own instruction like processInstruction() in main.cpp.
+ */
+void DigitalTwin::process(size_t clock, uint64_t micros)
+{
+  if (this->command_pending[clock])
+  {
+    this->command_pending[clock] = false;
+    this->players[clock].stop();
+    this->execute(clock, this->pending_command[clock], micros);
+  }
+
+  if (this->instruction_pending[clock])
+  {
+    this->instruction_pending[clock] = false;
+    if (this->pending_instruction[clock] != 0)
+      this->players[clock].stop();
+    this->executeInstruction(clock, this->pending_instruction[clock], micros);
+  }
+}
+
+/**
+ * @brief Plans the steps or calibrates like executeInstruction() in main.cpp.
+ */
+void DigitalTwin::executeInstruction(size_t clock, uint8_t instruction, uint64_t micros)
+{
+  uint8_t hour = (instruction >> 2) & 0x3;
+  uint8_t minute = instruction & 0x3;
+  if (hour == HAND_CALIBRATE || minute == HAND_CALIBRATE)
+  {
+    this->calibrate(clock, micros);
+    return;
+  }
+
+  this->planStep(this->hands[clock * 2 + HOUR_HAND], hour, micros);
+  this->planStep(this->hands[clock * 2 + MINUTE_HAND], minute, micros);
+}
+
+void DigitalTwin::planStep(TwinHand &hand, uint8_t instruction, uint64_t micros)
+{
+  if (instruction != HAND_FORWARD && instruction != HAND_BACKWARD)
+    return;
+
+  this->runMotor(hand, micros);
+  hand.velocity_interval = 0; // Motor::planStepForward() ends a continuous rotation
+  // Motor::tryStep() disabled the coils, the next step is executed without waiting
+  if (hand.planned_steps == 0 && hand.coils_active && micros - hand.last_step_micros > MIN_STANDSTILL_DELAY)
+    hand.coils_active = false;
+
+  // Motor::updatePacing()
+  uint64_t interval = micros - hand.last_plan_micros;
+  hand.plan_interval = updatePlanInterval(hand.plan_interval, interval > PACING_MAX_INTERVAL ? PACING_MAX_INTERVAL + 1 : interval);
+  hand.last_plan_micros = micros;
+
+  hand.planned_micros = micros; // Every step before was executed by runMotor()
+  hand.planned_steps += instruction == HAND_FORWARD ? 1 : -1;
+}
+
+/**
+ * @brief Executes a command like executeCommand() in main.cpp.
+ */
+void DigitalTwin::execute(size_t clock, const Command &command, uint64_t micros)
+{
+  switch (command.code)
+  {
+  case COMMAND_VELOCITY:
+    this->setVelocity(this->hands[clock * 2 + HOUR_HAND], getCommandByte(command, 0) * VELOCITY_UNIT, micros);
+    this->setVelocity(this->hands[clock * 2 + MINUTE_HAND], getCommandByte(command, 1) * VELOCITY_UNIT, micros);
+    break;
+  case COMMAND_MACRO_STORE:
+    if (command.arguments[0] < MACRO_SLOTS)
+    {
+      MacroMove move;
+      move.hour_steps = getCommandWord(command, 1);
+      move.minute_steps = getCommandWord(command, 3);
+      move.frames = getCommandWord(command, 5);
+      storeMacroMove(this->macros[clock][command.arguments[0]], command.arguments[1], move);
+    }
+    break;
+  case COMMAND_MACRO_PLAY:
+    if (command.arguments[0] < MACRO_SLOTS && this->macros[clock][command.arguments[0]].length > 0)
+    {
+      this->players[clock].start(this->macros[clock][command.arguments[0]]);
+      this->macro_micros[clock] = micros;
+    }
+    break;
+  case COMMAND_TIMING:
+  {
+    TwinTiming &timing = this->timings[clock];
+    uint8_t clock_out_high = getCommandByte(command, 0);
+    uint16_t frame_gap = getCommandWord(command, 1);
+    if (isValidTiming(clock_out_high, frame_gap))
+    {
+      if (!timing.trial)
+      {
+        timing.kept_clock_out_high = timing.clock_out_high;
+        timing.kept_frame_gap = timing.frame_gap;
+      }
+      timing.clock_out_high = clock_out_high;
+      timing.frame_gap = frame_gap;
+      timing.trial = true;
+      timing.trial_until = micros + TIMING_TRIAL_PERIOD * 1000ULL;
+    }
+    break;
+  }
+  case COMMAND_TIMING_KEEP:
+    this->timings[clock].trial = false;
+    break;
+  }
+}
+
+/**
+ * @brief Mirrors Motor::setVelocity(). The steps before are executed with the previous velocity.
+ */
+void DigitalTwin::setVelocity(TwinHand &hand, int velocity, uint64_t micros)
+{
+  this->runMotor(hand, micros);
+  // Motor::tryStep() disabled the coils, the rotation starts without waiting
+  if (hand.planned_steps == 0 && hand.velocity_interval == 0 && hand.coils_active && micros - hand.last_step_micros > MIN_STANDSTILL_DELAY)
+    hand.coils_active = false;
+  if (hand.planned_steps == 0)
+    hand.planned_micros = micros;
+
+  hand.velocity_interval = calculateVelocityInterval(velocity);
+  hand.velocity_forward = velocity > 0;
+}
+
+/**
+ * @brief Executes the planned steps and the continuous rotation until the given time like Motor::tryStep(), paced like the firmware.
+ */
+void DigitalTwin::runMotor(TwinHand &hand, uint64_t until)
+{
+  while (hand.planned_steps != 0 || hand.velocity_interval != 0)
+  {
+    uint64_t due = hand.planned_micros;
+    bool forward = hand.planned_steps != 0 ? hand.planned_steps > 0 : hand.velocity_forward;
+
+    // Acceleration of a tuned motor, restarts after a standstill or a reversal
+    uint64_t since_last_step = hand.coils_active ? due - hand.last_step_micros : PACING_MAX_INTERVAL;
+    unsigned long last_step_delay = since_last_step > hand.last_step_delay ? (unsigned long)since_last_step : hand.last_step_delay;
+    if (forward != hand.forward)
+      last_step_delay = MIN_STEP_DELAY;
+    unsigned long ramp_delay = calculateRampDelay(last_step_delay, hand.governor.getStepDelay(hand.min_step_delay), hand.acceleration);
+
+    unsigned long step_delay = calculateStepDelay(hand.plan_interval, hand.planned_steps, ramp_delay);
+    if (hand.planned_steps == 0)
+      step_delay = hand.velocity_interval > ramp_delay ? hand.velocity_interval : ramp_delay;
+    if (hand.coils_active && hand.last_step_micros + step_delay > due)
+      due = hand.last_step_micros + step_delay;
+    if (due > until)
+      return;
+
+    hand.last_step_delay = hand.coils_active ? due - hand.last_step_micros : PACING_MAX_INTERVAL;
+    hand.last_step_micros = due;
+    hand.planned_micros = due;
+    this->step(hand);
+  }
+}
+
+void DigitalTwin::step(TwinHand &hand)
+{
+  bool forward = hand.planned_steps != 0 ? hand.planned_steps > 0 : hand.velocity_forward;
+  if (hand.planned_steps != 0)
+    hand.planned_steps += forward ? -1 : 1;
+  hand.position = forward ? (hand.position + 1) % MAX_STEPS : (hand.position + MAX_STEPS - 1) % MAX_STEPS;
+  hand.physical = forward ? (hand.physical + 1) % MAX_STEPS : (hand.physical + MAX_STEPS - 1) % MAX_STEPS;
+  hand.forward = forward;
+  hand.coils_active = true;
+
+  this->sense(hand);
+}
+
+/**
+ * @brief Reads the simulated hall sensor and processes a field edge like Calibration::captureEdge().
+ */
+void DigitalTwin::sense(TwinHand &hand)
+{
+  bool in_field = this->isInField(hand);
+  if (in_field == hand.sensor_in_field)
+    return;
+
+  hand.sensor_in_field = in_field;
+  this->processEdge(hand, in_field);
+}
+
+/**
+ * @brief Processes a field edge like Calibration::processEdge(), the FieldTracker of the firmware measures the crossing.
+ */
+void DigitalTwin::processEdge(TwinHand &hand, bool in_field)
+{
+  FieldEdge edge;
+  edge.position = hand.position;
+  edge.forward = hand.forward;
+  edge.in_field = in_field;
+  FieldCrossing crossing;
+  if (!hand.field.processEdge(edge, crossing))
+    return;
+
+  hand.governor.recordCrossing(crossing.steps_off, hand.last_step_delay, hand.min_step_delay);
+  if (!crossing.lost_steps)
+    return;
+
+  // Motor::recalibrate()
+  if (hand.planned_steps == 0)
+    hand.planned_micros = hand.last_step_micros;
+  hand.planned_steps += crossing.correction_direction ? -(long)crossing.steps_off : (long)crossing.steps_off;
+  hand.position = crossing.correction_direction ? (hand.position + crossing.steps_off) % MAX_STEPS
+                                                : (hand.position + MAX_STEPS - crossing.steps_off) % MAX_STEPS;
+  hand.recalibrations++;
+}
+
+/**
+ * @brief Calibrates both hands of the clock like calibrateMotors() in main.cpp.
+ *
+ * The clock is blocked for the estimated duration of the calibration, planned steps are dropped by Motor::reset().
+ */
+void DigitalTwin::calibrate(size_t clock, uint64_t micros)
+{
+  TwinHand &hour = this->hands[clock * 2 + HOUR_HAND];
+  TwinHand &minute = this->hands[clock * 2 + MINUTE_HAND];
+  this->runMotor(hour, micros);
+  this->runMotor(minute, micros);
+
+  uint64_t hour_micros = this->getCalibrationMicros(hour);
+  uint64_t minute_micros = this->getCalibrationMicros(minute);
+
+  this->calibrating_until[clock] = micros + (hour_micros > minute_micros ? hour_micros : minute_micros);
+  this->finishCalibration(hour, micros + hour_micros);
+  this->finishCalibration(minute, micros + minute_micros);
+}
+
+/**
+ * @brief State of a hand after Calibration::calibrate() centered it in the field.
+ */
+void DigitalTwin::finishCalibration(TwinHand &hand, uint64_t micros)
+{
+  hand.position = 0;
+  hand.physical = 0;
+  hand.planned_steps = 0;
+  hand.planned_micros = micros;
+  hand.last_step_micros = micros;
+  hand.last_step_delay = PACING_MAX_INTERVAL;
+  hand.last_plan_micros = micros - PACING_MAX_INTERVAL - 1; // Motor::reset(), wraps around like micros()
+  hand.plan_interval = MIN_STEP_DELAY;
+  hand.velocity_interval = 0;
+  hand.coils_active = false; // Motor::reset()
+  hand.forward = false;      // CENTERING rotates backwards
+
+  hand.sensor_in_field = this->isInField(hand);
+  hand.field.reset(hand.field_width, hand.sensor_in_field, hand.position, hand.forward); // Calibration::finishCalibration()
+}
+
+/**
+ * @brief Estimates the duration of Calibration::calibrate() from the physical position of the hand.
+ *
+ * The field is searched coarsely, found again precisely, measured and the hand is centered.
+ * The acceleration of the coarse search is neglected.
+ */
+uint64_t DigitalTwin::getCalibrationMicros(const TwinHand &hand) const
+{
+  int half_width = hand.field_width / 2;
+  uint64_t search_steps;
+  if (this->isInField(hand))
+    search_steps = 2 * (toSignedPosition(hand.physical) + half_width + MIN_STEPS_OUTSIDE_FIELD); // LEAVE_MAGNET and back
+  else
+    search_steps = diff(hand.physical, MAX_STEPS - half_width, true);
+
+  uint64_t precise_steps = 4 * MIN_STEPS_OUTSIDE_FIELD + hand.field_width + half_width;
+  uint64_t fast_step_delay = hand.governor.getStepDelay(hand.min_step_delay); // Motor::getMinStepDelay()
+  return search_steps * fast_step_delay + precise_steps * CALIBRATION_PRECISE_STEP_DELAY;
+}
+
+/**
+ * @brief The simulated hall sensor: The field of the hand is centered at physical position 0.
+ */
+bool DigitalTwin::isInField(const TwinHand &hand) const
+{
+  int half_width = hand.field_width / 2;
+  int position = toSignedPosition(hand.physical);
+  return position >= -half_width && position < hand.field_width - half_width;
+}
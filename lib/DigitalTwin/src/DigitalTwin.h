@@ -0,0 +1,141 @@
+#ifndef _DIGITAL_TWIN_H_
+#define _DIGITAL_TWIN_H_
+
+#include <Frame.h>
+#include <FrameOutput.h>
+#include <FrameRing.h>
+#include "../../../src/SpeedGovernor.h"
+#include "../../../src/FieldTracker.h"
+#include "../../../src/CommandParser.h"
+#include "../../../src/MacroPlayer.h"
+#include "../../../src/Telemetry.h"
+
+#define TWIN_DEFAULT_FIELD_WIDTH (15 * MAX_COIL_STATE) // steps, typical width of the magnet field, 120 with double coil mode
+#define TWIN_RETURN_FRAMES 16                          // frames passed on by the last clock kept until receive(), power of two
+
+/**
+ * @brief State of a single hand, as the firmware sees it and as it physically is.
+ */
+struct TwinHand
+{
+  uint16_t position;               // Motor::current_pos
+  uint16_t physical;               // Real position of the hand, differs from position after lost steps
+  long planned_steps;              // Motor::planned_steps, negative = backward, positive = forward
+  uint64_t planned_micros;         // time when the next planned step was planned
+  uint64_t last_step_micros;       // Motor::last_step_micros
+  unsigned long last_step_delay;   // Motor::last_step_delay
+  uint64_t last_plan_micros;       // Motor::last_plan_micros
+  unsigned long plan_interval;     // Motor::plan_interval
+  unsigned long velocity_interval; // Motor::velocity_interval, 0 = no continuous rotation
+  bool velocity_forward;
+  bool coils_active;               // Motor::coils_active
+  bool forward;                    // Motor::current_direction
+  unsigned int min_step_delay;     // Motor::tuning, MIN_STEP_DELAY without a tuning
+  unsigned int acceleration;
+  SpeedGovernor governor;          // Motor::governor
+
+  // Calibration
+  uint16_t field_width; // Physical width of the magnet field, also the calibrated width
+  bool sensor_in_field; // Calibration::edge_last_in_field
+  FieldTracker field;   // Calibration::field
+  unsigned long recalibrations;
+};
+
+/**
+ * @brief Bus timing of a clock, ClockCommunication::setTiming().
+ */
+struct TwinTiming
+{
+  uint8_t clock_out_high; // us, CLOCK_OUT_HIGH until COMMAND_TIMING
+  unsigned int frame_gap; // us, DELAY_BETWEEN_INSTRUCTIONS until COMMAND_TIMING
+  uint8_t kept_clock_out_high;
+  unsigned int kept_frame_gap;
+  bool trial;
+  uint64_t trial_until; // the timing is reverted at this time unless COMMAND_TIMING_KEEP is received before
+};
+
+/**
+ * @brief Host side model of the whole chain that follows the frames sent to it.
+ *
+ * Every clock is simulated like the firmware does it: own instructions plan steps, the motor executes them paced like Motor::tryStep(),
+ * a calibration instruction (11) calibrates both hands and the field crossings recalibrate the position like Calibration does.
+ * Motors tuned by the self-test of the clocks (MotorTuner) are simulated with the same tuning, see setTuning(),
+ * and lost steps derate the motor like its SpeedGovernor does.
+ * Commands (see CommandEncoder) are collected by a CommandParser per clock, a velocity command rotates the hands until their next step instruction.
+ * Rotating hands have no planned steps, settle() does not wait for them. Uploaded macros are kept by reset() like in the EEPROM of the clocks.
+ * The bus timing of COMMAND_TIMING is kept per clock and reverted like by the clocks, the bus itself is not simulated.
+ * Enumeration, addressed and telemetry frames (see FrameAddressing.h) are applied like the clocks pass them on, the indexes are lost by reset().
+ * The frames passed on by the last clock are read back with receive(), like with the chain head and CHAIN_HEAD_RETURN.
+ * The constants and Utils.cpp of the firmware are compiled in, so the positions match the clocks step by step.
+ *
+ * The simulation is event based and runs much faster than real time. It can be used as FrameOutput of a PlaybackEngine,
+ * or frames are applied directly with apply(). getPositions() returns the positions to plan the next motion from.
+ */
+class DigitalTwin : public FrameOutput
+{
+public:
+  DigitalTwin(size_t clocks, unsigned long frame_period);
+
+  void reset();
+  bool send(const Frame &frame) override;
+  bool receive(Frame &frame, unsigned int timeout_ms) override;
+  void apply(const Frame &frame);
+  void advance(uint64_t micros);
+  void settle();
+
+  size_t getClocks() const;
+  uint64_t getMicros() const;
+  uint8_t getIndex(size_t clock) const;
+  void getTelemetry(size_t clock, Telemetry &telemetry) const;
+  bool isSettled() const;
+  bool isCalibrating(size_t clock) const;
+  uint16_t getPosition(size_t clock, Hand hand) const;
+  uint16_t getPhysicalPosition(size_t clock, Hand hand) const;
+  long getPlannedSteps(size_t clock, Hand hand) const;
+  unsigned long getRecalibrations(size_t clock, Hand hand) const;
+  unsigned int getMinStepDelay(size_t clock, Hand hand) const;
+  const TwinTiming &getTiming(size_t clock) const;
+  void getPositions(uint16_t *positions) const;
+
+  void setFieldWidth(size_t clock, Hand hand, uint16_t field_width);
+  void setTuning(size_t clock, Hand hand, unsigned int min_step_delay, unsigned int acceleration);
+  void loseSteps(size_t clock, Hand hand, long steps);
+
+private:
+  void applyMarked(const Frame &frame);
+  void receive(size_t clock, uint8_t instruction, uint64_t micros);
+  void process(size_t clock, uint64_t micros);
+  void executeInstruction(size_t clock, uint8_t instruction, uint64_t micros);
+  void planStep(TwinHand &hand, uint8_t instruction, uint64_t micros);
+  void execute(size_t clock, const Command &command, uint64_t micros);
+  void setVelocity(TwinHand &hand, int velocity, uint64_t micros);
+  void runMotor(TwinHand &hand, uint64_t until);
+  void step(TwinHand &hand);
+  void sense(TwinHand &hand);
+  void processEdge(TwinHand &hand, bool in_field);
+  void calibrate(size_t clock, uint64_t micros);
+  void finishCalibration(TwinHand &hand, uint64_t micros);
+  uint64_t getCalibrationMicros(const TwinHand &hand) const;
+  bool isInField(const TwinHand &hand) const;
+
+  size_t clocks;
+  unsigned long frame_period; // us
+  uint64_t now;               // us since reset()
+
+  TwinHand hands[MAX_CHAIN_LENGTH * 2];         // [clock * 2 + hand]
+  uint64_t calibrating_until[MAX_CHAIN_LENGTH]; // the clock is busy with calibrateMotors() until this time
+  uint8_t pending_instruction[MAX_CHAIN_LENGTH]; // OwnInstruction, the last step instruction received while calibrating
+  bool instruction_pending[MAX_CHAIN_LENGTH];
+  Command pending_command[MAX_CHAIN_LENGTH]; // OwnInstruction, the last command completed while calibrating
+  bool command_pending[MAX_CHAIN_LENGTH];
+  CommandParser commands[MAX_CHAIN_LENGTH]; // ClockCommunication::commands, the only parser of the own instructions
+  Macro macros[MAX_CHAIN_LENGTH][MACRO_SLOTS]; // MacroStorage
+  MacroPlayer players[MAX_CHAIN_LENGTH];
+  uint64_t macro_micros[MAX_CHAIN_LENGTH]; // time of the next instruction of the playing macro
+  uint8_t indexes[MAX_CHAIN_LENGTH];       // ClockCommunication::index
+  uint8_t dropped_instructions[MAX_CHAIN_LENGTH]; // Telemetry::dropped_instructions
+  TwinTiming timings[MAX_CHAIN_LENGTH];
+  FrameRing<TWIN_RETURN_FRAMES> returned;
+};
+
+#endif
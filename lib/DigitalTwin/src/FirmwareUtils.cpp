@@ -0,0 +1,7 @@
+// The digital twin must calculate exactly like the clocks, so the firmware source is compiled natively instead of copied.
+#include "../../../src/Utils.cpp"
+#include "../../../src/SpeedGovernor.cpp"
+#include "../../../src/FieldTracker.cpp"
+#include "../../../src/CommandParser.cpp"
+#include "../../../src/MacroPlayer.cpp"
+#include "../../../src/Scheduler.cpp" // not used by the twin, linked for the native scheduler test
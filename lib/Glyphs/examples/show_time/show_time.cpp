@@ -0,0 +1,128 @@
+/**
+ * Shows the time (HHMM) on a wall of 8 x 3 clocks.
+ *
+ * Usage: show_time serial <port> [baud rate]
+ *        show_time gpio <chip> <clock> <data 1> <data 2> <data 3> <data 4>
+ *        show_time file <path>
+ *
+ * All transitions between the digits are planned on startup. The frames are scheduled by their play time,
+ * so the digits start to move with the first frame after the minute changed, no matter how far the planner thread is ahead.
+ * A file only receives the frames of the current time.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <FileOutput.h>
+#include <GpioOutput.h>
+#include <PlaybackEngine.h>
+#include <SerialOutput.h>
+#include <TextDisplay.h>
+
+#define STEPS_PER_REVOLUTION 3414 // MAX_STEPS of the firmware
+#define COLUMNS 8
+#define ROWS 3
+#define FRAME_PERIOD 2500 // us, more than MIN_STEP_DELAY of the firmware
+
+class TimeSource : public FrameSource
+{
+public:
+  TimeSource(TextDisplay &display, bool once) : display(display), once(once), frames(0)
+  {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    this->start_micros = (uint64_t)now.tv_sec * 1000000 + now.tv_usec;
+    this->shown[0] = '\0';
+  }
+
+  bool next(Frame &frame) override
+  {
+    // Wall clock time when this frame is played
+    time_t seconds = (this->start_micros + this->frames * FRAME_PERIOD) / 1000000;
+    this->frames++;
+
+    char text[8];
+    struct tm local;
+    localtime_r(&seconds, &local);
+    snprintf(text, sizeof(text), "%02d%02d", local.tm_hour, local.tm_min);
+    if (strcmp(text, this->shown) != 0)
+    {
+      if (this->once && this->shown[0] != '\0')
+        return false;
+      this->display.show(text);
+      strcpy(this->shown, text);
+    }
+
+    if (this->display.hasNextFrame())
+      this->display.nextFrame(frame);
+    else if (this->once)
+      return false;
+    else
+      frame = Frame(this->display.getClocks());
+    return true;
+  }
+
+private:
+  TextDisplay &display;
+  bool once;
+  uint64_t start_micros;
+  uint64_t frames;
+  char shown[8];
+};
+
+int main(int argc, char **argv)
+{
+  if (argc < 3)
+  {
+    fprintf(stderr, "Usage: %s serial <port> [baud rate]\n", argv[0]);
+    fprintf(stderr, "       %s gpio <chip> <clock> <data 1> <data 2> <data 3> <data 4>\n", argv[0]);
+    fprintf(stderr, "       %s file <path>\n", argv[0]);
+    return 1;
+  }
+
+  FrameOutput *output = NULL;
+  FILE *recording = NULL;
+  if (strcmp(argv[1], "serial") == 0)
+  {
+    output = new SerialOutput(argv[2], argc > 3 ? strtoul(argv[3], NULL, 10) : 500000);
+  }
+  else if (strcmp(argv[1], "gpio") == 0 && argc >= 8)
+  {
+    uint32_t lines[5];
+    for (size_t i = 0; i < 5; i++)
+    {
+      lines[i] = strtoul(argv[3 + i], NULL, 10);
+    }
+    output = new GpioOutput(argv[2], lines);
+  }
+  else if (strcmp(argv[1], "file") == 0 && (recording = fopen(argv[2], "wb")) != NULL)
+  {
+    output = new FileOutput(recording);
+  }
+  else
+  {
+    fprintf(stderr, "Invalid output %s\n", argv[1]);
+    return 1;
+  }
+
+  TransitionCache cache(STEPS_PER_REVOLUTION);
+  cache.setGoal(FINISH_TOGETHER);
+  printf("%zu transitions planned\n", cache.precompute("0123456789"));
+
+  TextDisplay display(cache, COLUMNS, ROWS);
+  TimeSource source(display, recording != NULL);
+  PlaybackEngine engine(source, *output, FRAME_PERIOD);
+  engine.setRealtime(80, 3);
+  if (!engine.start())
+  {
+    fprintf(stderr, "Failed to open the output\n");
+    return 1;
+  }
+  engine.wait();
+
+  delete output;
+  if (recording != NULL)
+    fclose(recording);
+  return 0;
+}
@@ -0,0 +1,51 @@
+#include "Glyph.h"
+
+// Directions of a hand
+#define U 0
+#define R 90
+#define D 180
+#define L 270
+#define B 225 // blank: both hands point to the lower left and hide each other
+
+// Every row is the left and right clock: {hour, minute}
+static const Glyph glyphs[] = {
+    {'0', {{R, D}, {L, D}, /**/ {U, D}, {U, D}, /**/ {U, R}, {U, L}}},
+    {'1', {{B, B}, {D, D}, /**/ {B, B}, {U, D}, /**/ {B, B}, {U, U}}},
+    {'2', {{R, R}, {L, D}, /**/ {R, D}, {U, L}, /**/ {U, R}, {L, L}}},
+    {'3', {{R, R}, {L, D}, /**/ {R, R}, {U, D}, /**/ {R, R}, {U, L}}},
+    {'4', {{D, D}, {D, D}, /**/ {U, R}, {U, D}, /**/ {B, B}, {U, U}}},
+    {'5', {{R, D}, {L, L}, /**/ {U, R}, {L, D}, /**/ {R, R}, {U, L}}},
+    {'6', {{R, D}, {L, L}, /**/ {U, D}, {L, D}, /**/ {U, R}, {U, L}}},
+    {'7', {{R, R}, {L, D}, /**/ {B, B}, {U, D}, /**/ {B, B}, {U, U}}},
+    {'8', {{R, D}, {L, D}, /**/ {45, 135}, {315, 225}, /**/ {U, R}, {U, L}}},
+    {'9', {{R, D}, {L, D}, /**/ {U, R}, {U, D}, /**/ {R, R}, {U, L}}},
+    {'-', {{B, B}, {B, B}, /**/ {R, R}, {L, L}, /**/ {B, B}, {B, B}}},
+    {' ', {{B, B}, {B, B}, /**/ {B, B}, {B, B}, /**/ {B, B}, {B, B}}},
+};
+
+#define GLYPH_COUNT (sizeof(glyphs) / sizeof(glyphs[0]))
+
+/**
+ * @brief Finds the glyph of a character.
+ *
+ * @return const Glyph* NULL if there is no glyph for the character.
+ */
+const Glyph *findGlyph(char character)
+{
+  for (size_t i = 0; i < GLYPH_COUNT; i++)
+  {
+    if (glyphs[i].character == character)
+      return &glyphs[i];
+  }
+  return NULL;
+}
+
+size_t getGlyphCount()
+{
+  return GLYPH_COUNT;
+}
+
+const Glyph *getGlyph(size_t index)
+{
+  return index < GLYPH_COUNT ? &glyphs[index] : NULL;
+}
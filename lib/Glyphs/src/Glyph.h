@@ -0,0 +1,26 @@
+#ifndef _GLYPH_H_
+#define _GLYPH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define GLYPH_COLUMNS 2
+#define GLYPH_ROWS 3
+#define GLYPH_CLOCKS (GLYPH_COLUMNS * GLYPH_ROWS)
+
+/**
+ * @brief Pose of a block of 2 x 3 clocks that shows a character.
+ *
+ * The angles are in degrees clockwise from 12 o'clock, for every clock [row * GLYPH_COLUMNS + column][hand].
+ */
+struct Glyph
+{
+  char character;
+  int16_t angles[GLYPH_CLOCKS][2];
+};
+
+const Glyph *findGlyph(char character);
+size_t getGlyphCount();
+const Glyph *getGlyph(size_t index);
+
+#endif
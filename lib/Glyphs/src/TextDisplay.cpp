@@ -0,0 +1,160 @@
+#include "TextDisplay.h"
+
+TextDisplay::TextDisplay(TransitionCache &cache, size_t columns, size_t rows) : cache(cache)
+{
+  this->columns = columns;
+  this->rows = rows;
+  if (this->columns * this->rows > MAX_CHAIN_LENGTH)
+    this->rows = MAX_CHAIN_LENGTH / this->columns;
+
+  uint16_t positions[MAX_CHAIN_LENGTH * 2] = {0};
+  this->reset(positions);
+}
+
+/**
+ * @brief Sets the positions of all hands, e.g. from a DigitalTwin. No block shows a glyph afterwards.
+ *
+ * @param positions Two positions per clock [clock * 2 + hand].
+ */
+void TextDisplay::reset(const uint16_t *positions)
+{
+  for (size_t i = 0; i < this->getClocks() * 2; i++)
+    this->positions[i] = positions[i];
+
+  for (size_t block = 0; block < MAX_GLYPH_BLOCKS; block++)
+  {
+    this->blocks[block].glyph = NULL;
+    this->blocks[block].transition = NULL;
+    this->blocks[block].frame = 0;
+  }
+}
+
+/**
+ * @brief Starts the transitions to the text. The frames are returned by nextFrame().
+ *
+ * Missing characters are shown as space, characters without a glyph as well.
+ *
+ * @return size_t Number of blocks that move.
+ */
+size_t TextDisplay::show(const char *text)
+{
+  size_t moving = 0;
+  bool text_end = false;
+
+  for (size_t index = 0; index < this->getBlocks(); index++)
+  {
+    text_end = text_end || text[index] == '\0';
+    const Glyph *glyph = text_end ? NULL : findGlyph(text[index]);
+    if (glyph == NULL)
+      glyph = findGlyph(' ');
+
+    Block &block = this->blocks[index];
+    if (block.glyph == glyph && block.transition == NULL)
+      continue;
+
+    if (block.glyph != NULL && block.transition == NULL)
+    {
+      block.transition = &this->cache.get(*block.glyph, *glyph);
+    }
+    else
+    {
+      uint16_t current[GLYPH_CLOCKS * 2];
+      for (size_t clock = 0; clock < GLYPH_CLOCKS; clock++)
+      {
+        size_t wall_clock = this->getBlockClock(index, clock);
+        current[clock * 2 + HOUR_HAND] = this->positions[wall_clock * 2 + HOUR_HAND];
+        current[clock * 2 + MINUTE_HAND] = this->positions[wall_clock * 2 + MINUTE_HAND];
+      }
+      this->cache.plan(current, *glyph, block.planned);
+      block.transition = &block.planned;
+    }
+
+    block.glyph = glyph;
+    block.frame = 0;
+    if (block.transition->frames == 0)
+      block.transition = NULL;
+    else
+      moving++;
+  }
+
+  return moving;
+}
+
+bool TextDisplay::hasNextFrame() const
+{
+  for (size_t block = 0; block < this->getBlocks(); block++)
+  {
+    if (this->blocks[block].transition != NULL)
+      return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Merges the next frame of every moving block into a frame of the wall.
+ */
+void TextDisplay::nextFrame(Frame &frame)
+{
+  frame = Frame(this->getClocks());
+
+  for (size_t index = 0; index < this->getBlocks(); index++)
+  {
+    Block &block = this->blocks[index];
+    if (block.transition == NULL)
+      continue;
+
+    for (size_t clock = 0; clock < GLYPH_CLOCKS; clock++)
+    {
+      frame.setInstruction(this->getBlockClock(index, clock), block.transition->getInstruction(block.frame, clock));
+    }
+
+    if (++block.frame == block.transition->frames)
+      block.transition = NULL;
+  }
+
+  size_t steps = this->cache.getStepsPerRevolution();
+  for (size_t clock = 0; clock < this->getClocks(); clock++)
+  {
+    for (size_t hand = 0; hand < 2; hand++)
+    {
+      uint16_t &position = this->positions[clock * 2 + hand];
+      HandInstruction instruction = frame.getHand(clock, (Hand)hand);
+      if (instruction == HAND_FORWARD)
+        position = (position + 1) % steps;
+      else if (instruction == HAND_BACKWARD)
+        position = (position + steps - 1) % steps;
+    }
+  }
+}
+
+size_t TextDisplay::getClocks() const
+{
+  return this->columns * this->rows;
+}
+
+size_t TextDisplay::getBlocks() const
+{
+  return (this->columns / GLYPH_COLUMNS) * (this->rows / GLYPH_ROWS);
+}
+
+size_t TextDisplay::getClock(size_t column, size_t row) const
+{
+  return row * this->columns + column;
+}
+
+/**
+ * @brief Copies the positions of all hands after the frames returned by nextFrame().
+ */
+void TextDisplay::getPositions(uint16_t *positions) const
+{
+  for (size_t i = 0; i < this->getClocks() * 2; i++)
+    positions[i] = this->positions[i];
+}
+
+size_t TextDisplay::getBlockClock(size_t block, size_t clock) const
+{
+  size_t block_columns = this->columns / GLYPH_COLUMNS;
+  size_t column = (block % block_columns) * GLYPH_COLUMNS + clock % GLYPH_COLUMNS;
+  size_t row = (block / block_columns) * GLYPH_ROWS + clock / GLYPH_COLUMNS;
+  return this->getClock(column, row);
+}
@@ -0,0 +1,48 @@
+#ifndef _TEXT_DISPLAY_H_
+#define _TEXT_DISPLAY_H_
+
+#include "TransitionCache.h"
+
+#define MAX_GLYPH_BLOCKS (MAX_CHAIN_LENGTH / GLYPH_CLOCKS)
+
+/**
+ * @brief Shows text on a wall of clocks, every character on a block of 2 x 3 clocks.
+ *
+ * The clocks are numbered row by row: clock = row * columns + column. 24 clocks in 3 rows show 4 characters.
+ * A block that shows a glyph moves to the next glyph with the cached transition, so show() does not plan anything in the common case.
+ * Blocks that are still moving or do not show a glyph (e.g. after the startup) are planned from their positions instead.
+ */
+class TextDisplay
+{
+public:
+  TextDisplay(TransitionCache &cache, size_t columns, size_t rows);
+
+  void reset(const uint16_t *positions);
+  size_t show(const char *text);
+  bool hasNextFrame() const;
+  void nextFrame(Frame &frame);
+
+  size_t getClocks() const;
+  size_t getBlocks() const;
+  size_t getClock(size_t column, size_t row) const;
+  void getPositions(uint16_t *positions) const;
+
+private:
+  struct Block
+  {
+    const Glyph *glyph;           // shown glyph, or the target while moving. NULL if unknown
+    const Transition *transition; // running transition, NULL if idle
+    size_t frame;                 // next frame of the transition
+    Transition planned;           // transition that is not from the cache
+  };
+
+  size_t getBlockClock(size_t block, size_t clock) const;
+
+  TransitionCache &cache;
+  size_t columns;
+  size_t rows;
+  Block blocks[MAX_GLYPH_BLOCKS];
+  uint16_t positions[MAX_CHAIN_LENGTH * 2]; // [clock * 2 + hand] after the frames returned by nextFrame()
+};
+
+#endif
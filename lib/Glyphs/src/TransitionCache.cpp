@@ -0,0 +1,134 @@
+#include "TransitionCache.h"
+
+uint8_t Transition::getInstruction(size_t frame, size_t clock) const
+{
+  uint8_t byte = this->data[frame * GLYPH_FRAME_BYTES + clock / 2];
+  return clock % 2 == 0 ? byte >> 4 : byte & 0x0F;
+}
+
+TransitionCache::TransitionCache(size_t steps_per_revolution) : planner(GLYPH_CLOCKS, steps_per_revolution)
+{
+  this->steps_per_revolution = steps_per_revolution;
+  this->hits = 0;
+  this->misses = 0;
+}
+
+/**
+ * @brief Changes the goal of the planner. Transitions planned before are dropped.
+ */
+void TransitionCache::setGoal(PlanGoal goal)
+{
+  this->planner.setGoal(goal);
+  this->transitions.clear();
+}
+
+/**
+ * @brief Changes the direction policy of the planner. Transitions planned before are dropped.
+ */
+void TransitionCache::setDirectionPolicy(DirectionPolicy policy)
+{
+  this->planner.setDirectionPolicy(policy);
+  this->transitions.clear();
+}
+
+/**
+ * @brief Converts the angles of the glyph into motor positions.
+ *
+ * @param positions Receives GLYPH_CLOCKS * 2 positions [clock * 2 + hand].
+ */
+void TransitionCache::getPose(const Glyph &glyph, uint16_t *positions)
+{
+  for (size_t clock = 0; clock < GLYPH_CLOCKS; clock++)
+  {
+    positions[clock * 2 + HOUR_HAND] = this->planner.angleToSteps(glyph.angles[clock][HOUR_HAND]);
+    positions[clock * 2 + MINUTE_HAND] = this->planner.angleToSteps(glyph.angles[clock][MINUTE_HAND]);
+  }
+}
+
+/**
+ * @brief Plans the frames from any positions of a block to a glyph. Not cached.
+ *
+ * @param current GLYPH_CLOCKS * 2 positions [clock * 2 + hand].
+ */
+void TransitionCache::plan(const uint16_t *current, const Glyph &to, Transition &transition)
+{
+  uint16_t target[GLYPH_CLOCKS * 2];
+  this->getPose(to, target);
+
+  transition.frames = this->planner.plan(current, target);
+  transition.data.resize(transition.frames * GLYPH_FRAME_BYTES);
+
+  Frame frame;
+  for (size_t i = 0; i < transition.frames; i++)
+  {
+    this->planner.nextFrame(frame);
+    for (size_t byte = 0; byte < GLYPH_FRAME_BYTES; byte++)
+    {
+      transition.data[i * GLYPH_FRAME_BYTES + byte] = frame.getData()[byte];
+    }
+  }
+}
+
+/**
+ * @brief Plans the transitions between all glyphs of the characters.
+ *
+ * @param characters Characters without a glyph are skipped.
+ * @return size_t Number of transitions in the cache.
+ */
+size_t TransitionCache::precompute(const char *characters)
+{
+  for (const char *from = characters; *from != '\0'; from++)
+  {
+    const Glyph *from_glyph = findGlyph(*from);
+    for (const char *to = characters; *to != '\0' && from_glyph != NULL; to++)
+    {
+      const Glyph *to_glyph = findGlyph(*to);
+      if (to_glyph != NULL)
+        this->get(*from_glyph, *to_glyph);
+    }
+  }
+  return this->transitions.size();
+}
+
+/**
+ * @brief Returns the transition between two glyphs. It is planned, if it is not in the cache yet.
+ *
+ * The reference stays valid until the goal or direction policy are changed.
+ */
+const Transition &TransitionCache::get(const Glyph &from, const Glyph &to)
+{
+  uint16_t key = (uint8_t)from.character << 8 | (uint8_t)to.character;
+  std::map<uint16_t, Transition>::iterator it = this->transitions.find(key);
+  if (it != this->transitions.end())
+  {
+    this->hits++;
+    return it->second;
+  }
+
+  this->misses++;
+  uint16_t current[GLYPH_CLOCKS * 2];
+  this->getPose(from, current);
+  Transition &transition = this->transitions[key];
+  this->plan(current, to, transition);
+  return transition;
+}
+
+size_t TransitionCache::getStepsPerRevolution() const
+{
+  return this->steps_per_revolution;
+}
+
+size_t TransitionCache::getSize() const
+{
+  return this->transitions.size();
+}
+
+unsigned long TransitionCache::getHits() const
+{
+  return this->hits;
+}
+
+unsigned long TransitionCache::getMisses() const
+{
+  return this->misses;
+}
@@ -0,0 +1,54 @@
+#ifndef _TRANSITION_CACHE_H_
+#define _TRANSITION_CACHE_H_
+
+#include <map>
+#include <vector>
+#include <MotionPlanner.h>
+#include "Glyph.h"
+
+#define GLYPH_FRAME_BYTES ((GLYPH_CLOCKS + 1) / 2)
+
+/**
+ * @brief Frames that move the hands of a glyph block, bit packed like Frame::getData().
+ */
+struct Transition
+{
+  size_t frames;
+  std::vector<uint8_t> data; // GLYPH_FRAME_BYTES per frame
+
+  uint8_t getInstruction(size_t frame, size_t clock) const;
+};
+
+/**
+ * @brief Plans the transitions between glyphs once and keeps them.
+ *
+ * A transition only depends on the poses of both glyphs, so every pair is planned a single time.
+ * precompute() plans all pairs of a character set in advance, e.g. every digit to every digit.
+ */
+class TransitionCache
+{
+public:
+  explicit TransitionCache(size_t steps_per_revolution);
+
+  void setGoal(PlanGoal goal);
+  void setDirectionPolicy(DirectionPolicy policy);
+
+  void getPose(const Glyph &glyph, uint16_t *positions);
+  void plan(const uint16_t *current, const Glyph &to, Transition &transition);
+  size_t precompute(const char *characters);
+  const Transition &get(const Glyph &from, const Glyph &to);
+
+  size_t getStepsPerRevolution() const;
+  size_t getSize() const;
+  unsigned long getHits() const;
+  unsigned long getMisses() const;
+
+private:
+  MotionPlanner planner;
+  size_t steps_per_revolution;
+  std::map<uint16_t, Transition> transitions; // key: from character << 8 | to character
+  unsigned long hits;
+  unsigned long misses;
+};
+
+#endif
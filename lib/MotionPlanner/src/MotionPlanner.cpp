@@ -0,0 +1,174 @@
+#include "MotionPlanner.h"
+#include <math.h>
+
+MotionPlanner::MotionPlanner(size_t clocks, size_t steps_per_revolution)
+{
+  this->clocks = clocks > MAX_CHAIN_LENGTH ? MAX_CHAIN_LENGTH : clocks;
+  this->steps_per_revolution = steps_per_revolution;
+  this->goal = MINIMIZE_FRAMES;
+  this->policy = SHORTEST_DIRECTION;
+  this->frames = 0;
+  this->frame_index = 0;
+  for (size_t i = 0; i < MAX_CHAIN_LENGTH * 2; i++)
+  {
+    this->steps[i] = 0;
+  }
+}
+
+void MotionPlanner::setGoal(PlanGoal goal)
+{
+  this->goal = goal;
+}
+
+void MotionPlanner::setDirectionPolicy(DirectionPolicy policy)
+{
+  this->policy = policy;
+}
+
+/**
+ * @brief Plans the movement of all hands. Replaces the previous plan.
+ *
+ * @param current Current positions in steps: current[clock * 2 + hand].
+ * @param target Target positions in steps: target[clock * 2 + hand].
+ * @return size_t Number of frames of the plan.
+ */
+size_t MotionPlanner::plan(const uint16_t *current, const uint16_t *target)
+{
+  this->frames = 0;
+  this->frame_index = 0;
+
+  for (size_t i = 0; i < this->clocks * 2; i++)
+  {
+    size_t from = current[i] % this->steps_per_revolution;
+    size_t to = target[i] % this->steps_per_revolution;
+
+    bool direction;
+    switch (this->policy)
+    {
+    case ALWAYS_FORWARD:
+      direction = true;
+      break;
+    case ALWAYS_BACKWARD:
+      direction = false;
+      break;
+    default:
+      direction = this->getShortestDirection(from, to);
+      break;
+    }
+
+    size_t distance = this->diff(from, to, direction);
+    this->steps[i] = direction ? (long)distance : -(long)distance;
+
+    if (distance > this->frames)
+      this->frames = distance;
+  }
+
+  return this->frames;
+}
+
+/**
+ * @brief Planned steps of a hand. Negative = backward, positive = forward.
+ */
+long MotionPlanner::getSteps(size_t clock, Hand hand) const
+{
+  return this->steps[clock * 2 + hand];
+}
+
+size_t MotionPlanner::getFrames() const
+{
+  return this->frames;
+}
+
+size_t MotionPlanner::getRemainingFrames() const
+{
+  return this->frames - this->frame_index;
+}
+
+bool MotionPlanner::hasNextFrame() const
+{
+  return this->frame_index < this->frames;
+}
+
+/**
+ * @brief Writes the next frame of the plan.
+ */
+void MotionPlanner::nextFrame(Frame &frame)
+{
+  frame = Frame(this->clocks);
+
+  for (size_t clock = 0; clock < this->clocks; clock++)
+  {
+    for (size_t hand = 0; hand < 2; hand++)
+    {
+      long hand_steps = this->steps[clock * 2 + hand];
+      if (this->stepsInFrame(hand_steps, this->frame_index))
+      {
+        frame.setHand(clock, (Hand)hand, hand_steps > 0 ? HAND_FORWARD : HAND_BACKWARD);
+      }
+    }
+  }
+
+  this->frame_index++;
+}
+
+/**
+ * @brief Writes the remaining frames of the plan.
+ *
+ * @param frames Receives the frames. The caller owns the memory, nothing is allocated.
+ * @param max_frames Capacity of frames.
+ * @return size_t Number of written frames.
+ */
+size_t MotionPlanner::encode(Frame *frames, size_t max_frames)
+{
+  size_t count = 0;
+  while (count < max_frames && this->hasNextFrame())
+  {
+    this->nextFrame(frames[count++]);
+  }
+  return count;
+}
+
+/**
+ * @brief Checks if a hand with the given steps has to step in a frame of the plan.
+ *
+ * MINIMIZE_FRAMES steps in the first frames, FINISH_TOGETHER spreads the steps evenly (Bresenham).
+ */
+bool MotionPlanner::stepsInFrame(long steps, size_t frame) const
+{
+  size_t distance = steps < 0 ? -steps : steps;
+  if (distance == 0)
+    return false;
+
+  if (this->goal == MINIMIZE_FRAMES)
+    return frame < distance;
+
+  return (frame + 1) * distance / this->frames > frame * distance / this->frames;
+}
+
+/**
+ * @brief Calculates the step difference between two points using the direction. Same as diff() of the firmware.
+ */
+size_t MotionPlanner::diff(size_t from, size_t to, bool direction) const
+{
+  if (direction)
+    return to >= from ? to - from : this->steps_per_revolution - from + to;
+  else
+    return from >= to ? from - to : this->steps_per_revolution - to + from;
+}
+
+/**
+ * @brief Get the shortest direction between to positions. Same as getShortestDirection() of the firmware.
+ */
+bool MotionPlanner::getShortestDirection(size_t from, size_t to) const
+{
+  return this->diff(from, to, true) < this->diff(from, to, false);
+}
+
+/**
+ * @brief Converts an angle (0 = 12 o'clock, clockwise) into a position in steps.
+ */
+size_t MotionPlanner::angleToSteps(float degrees) const
+{
+  long steps = lroundf(degrees / 360.0f * this->steps_per_revolution) % (long)this->steps_per_revolution;
+  return steps < 0 ? steps + this->steps_per_revolution : steps;
+}
@@ -0,0 +1,59 @@
+#ifndef _MOTION_PLANNER_H_
+#define _MOTION_PLANNER_H_
+
+#include <Frame.h>
+
+enum PlanGoal
+{
+  MINIMIZE_FRAMES, // Every hand moves with every frame until it reached its target
+  FINISH_TOGETHER  // The steps of every hand are spread evenly, so all hands arrive in the last frame
+};
+
+enum DirectionPolicy
+{
+  SHORTEST_DIRECTION,
+  ALWAYS_FORWARD,
+  ALWAYS_BACKWARD
+};
+
+/**
+ * @brief Plans the frames that move all hands of the wall from their current to their target positions.
+ *
+ * Every frame is one step per hand at most, so the number of frames is the longest path of all hands.
+ * Planning is O(hands) and does not allocate, so it can be repeated for every frame.
+ */
+class MotionPlanner
+{
+public:
+  MotionPlanner(size_t clocks, size_t steps_per_revolution);
+
+  void setGoal(PlanGoal goal);
+  void setDirectionPolicy(DirectionPolicy policy);
+
+  size_t plan(const uint16_t *current, const uint16_t *target);
+  long getSteps(size_t clock, Hand hand) const;
+
+  size_t getFrames() const;
+  size_t getRemainingFrames() const;
+  bool hasNextFrame() const;
+  void nextFrame(Frame &frame);
+  size_t encode(Frame *frames, size_t max_frames);
+
+  size_t diff(size_t from, size_t to, bool direction) const;
+  bool getShortestDirection(size_t from, size_t to) const;
+  size_t angleToSteps(float degrees) const;
+
+private:
+  bool stepsInFrame(long steps, size_t frame) const;
+
+  size_t clocks;
+  size_t steps_per_revolution;
+  PlanGoal goal;
+  DirectionPolicy policy;
+
+  long steps[MAX_CHAIN_LENGTH * 2]; // [clock * 2 + hand], negative = backward, positive = forward
+  size_t frames;                    // frames of the current plan
+  size_t frame_index;               // next frame to encode
+};
+
+#endif
@@ -0,0 +1,103 @@
+/**
+ * Plays a binary animation on the wall.
+ *
+ * Usage: play_animation <animation> serial <port> [baud rate]
+ *        play_animation <animation> gpio <chip> <clock> <data 1> <data 2> <data 3> <data 4> [<clock> <data 1> ... of the next chain]
+ *        play_animation <animation> file <path>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <AnimationFile.h>
+#include <FileOutput.h>
+#include <GpioOutput.h>
+#include <PlaybackEngine.h>
+#include <SerialOutput.h>
+
+class AnimationSource : public FrameSource
+{
+public:
+  explicit AnimationSource(AnimationReader &reader) : reader(reader)
+  {
+  }
+
+  bool next(Frame &frame) override
+  {
+    return this->reader.next(frame);
+  }
+
+private:
+  AnimationReader &reader;
+};
+
+int main(int argc, char **argv)
+{
+  if (argc < 4)
+  {
+    fprintf(stderr, "Usage: %s <animation> serial <port> [baud rate]\n", argv[0]);
+    fprintf(stderr, "       %s <animation> gpio <chip> <clock> <data 1> <data 2> <data 3> <data 4> [<clock> <data 1> ...]\n", argv[0]);
+    fprintf(stderr, "       %s <animation> file <path>\n", argv[0]);
+    return 1;
+  }
+
+  AnimationFile file;
+  if (!file.open(argv[1]))
+  {
+    perror(argv[1]);
+    return 1;
+  }
+
+  AnimationReader reader(file.getData(), file.getSize());
+  if (!reader.isValid())
+  {
+    fprintf(stderr, "%s is not an animation\n", argv[1]);
+    return 1;
+  }
+
+  FrameOutput *output = NULL;
+  FILE *recording = NULL;
+  if (strcmp(argv[2], "serial") == 0)
+  {
+    output = new SerialOutput(argv[3], argc > 4 ? strtoul(argv[4], NULL, 10) : 500000);
+  }
+  else if (strcmp(argv[2], "gpio") == 0 && argc >= 9 && (argc - 4) % GPIO_LINES_PER_CHAIN == 0)
+  {
+    // Every group of five lines drives its own chain, the clocks are split evenly
+    size_t chains = (argc - 4) / GPIO_LINES_PER_CHAIN;
+    uint32_t lines[MAX_CHAINS][GPIO_LINES_PER_CHAIN];
+    for (size_t i = 0; i < chains * GPIO_LINES_PER_CHAIN && i < MAX_CHAINS * GPIO_LINES_PER_CHAIN; i++)
+    {
+      lines[i / GPIO_LINES_PER_CHAIN][i % GPIO_LINES_PER_CHAIN] = strtoul(argv[4 + i], NULL, 10);
+    }
+    output = new GpioOutput(argv[3], lines, ChainLayout(reader.getClocks(), chains));
+  }
+  else if (strcmp(argv[2], "file") == 0 && (recording = fopen(argv[3], "wb")) != NULL)
+  {
+    output = new FileOutput(recording);
+  }
+  else
+  {
+    fprintf(stderr, "Invalid output %s\n", argv[2]);
+    return 1;
+  }
+
+  AnimationSource source(reader);
+  PlaybackEngine engine(source, *output, reader.getFramePeriod());
+  engine.setRealtime(80, 3);
+  if (!engine.start())
+  {
+    fprintf(stderr, "Failed to open the output\n");
+    return 1;
+  }
+  engine.wait();
+
+  PlaybackStats stats = engine.getStats();
+  printf("frames: %llu underruns: %llu errors: %llu jitter: mean %u us, max %u us%s\n",
+         (unsigned long long)stats.frames, (unsigned long long)stats.underruns, (unsigned long long)stats.errors,
+         stats.mean_jitter, stats.max_jitter, engine.isRealtime() ? "" : " (no realtime scheduling)");
+
+  delete output;
+  if (recording != NULL)
+    fclose(recording);
+  return 0;
+}
@@ -0,0 +1,50 @@
+/**
+ * Finds the fastest reliable bus timing of the wall. The chain head must be built with CHAIN_HEAD_RETURN
+ * and the last clock looped back to it.
+ *
+ * Usage: tune_chain <port> [baud rate]
+ *
+ * The clocks keep the tuned timing until they restart, the chain head until it is reset.
+ * Pass the printed timing to the output of the animation player (e.g. GpioOutput) to use it without the chain head.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <ChainTuner.h>
+#include <SerialOutput.h>
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <port> [baud rate]\n", argv[0]);
+    return 1;
+  }
+
+  SerialOutput output(argv[1], argc > 2 ? strtoul(argv[2], NULL, 10) : 500000);
+  if (!output.begin())
+  {
+    perror(argv[1]);
+    return 1;
+  }
+
+  ChainTuner tuner(output);
+  bool tuned = tuner.tune();
+  const ChainTunerReport &report = tuner.getReport();
+  output.end();
+  if (!tuned)
+  {
+    fprintf(stderr, "No reliable timing found, is the last clock looped back to the chain head?\n");
+    return 1;
+  }
+
+  printf("Clocks:             %zu\n", report.clocks);
+  printf("Clock out high:     %u us\n", report.timing.clock_out_high);
+  printf("Tick period:        %u us\n", report.timing.tick_period);
+  printf("Frame gap:          %u us (clocks %u us)\n", report.timing.frame_gap, report.clock_frame_gap);
+  printf("Chain latency:      %u us\n", (unsigned int)report.max_latency);
+  printf("Test frames:        %llu, %llu corrupted, %llu lost\n", (unsigned long long)report.test_frames,
+         (unsigned long long)report.corrupted_frames, (unsigned long long)report.lost_frames);
+  if (report.disturbed)
+    printf("Corrupted frames may have moved hands, calibrate the wall before playing.\n");
+  return 0;
+}
@@ -0,0 +1,59 @@
+#include "ChainSimulator.h"
+#include <string.h>
+
+ChainSimulator::ChainSimulator(const ChainLayout &layout, const ChainTiming &timing, FrameOutput *target)
+{
+  this->layout = layout;
+  this->timing = timing;
+  this->target = target;
+  memset(&this->stats, 0, sizeof(this->stats));
+}
+
+bool ChainSimulator::begin()
+{
+  memset(&this->stats, 0, sizeof(this->stats));
+  return this->target == NULL || this->target->begin();
+}
+
+bool ChainSimulator::send(const Frame &frame)
+{
+  Frame chain_frames[MAX_CHAINS];
+  size_t ticks = 0;
+  this->layout.split(frame, chain_frames);
+  for (size_t chain = 0; chain < this->layout.getChains(); chain++)
+  {
+    size_t active = chain_frames[chain].getActiveClocks();
+    if (active > ticks)
+      ticks = active;
+  }
+
+  if (ticks > 0)
+  {
+    uint32_t frame_micros = this->timing.getFrameMicros(ticks);
+    uint32_t latency = this->timing.getLatencyMicros(ticks - 1);
+    this->stats.frames++;
+    this->stats.bus_micros += frame_micros;
+    if (frame_micros > this->stats.max_frame_micros)
+      this->stats.max_frame_micros = frame_micros;
+    if (latency > this->stats.max_latency)
+      this->stats.max_latency = latency;
+  }
+
+  if (this->target == NULL)
+    return true;
+
+  Frame wall_frame;
+  this->layout.merge(chain_frames, wall_frame);
+  return this->target->send(wall_frame);
+}
+
+void ChainSimulator::end()
+{
+  if (this->target != NULL)
+    this->target->end();
+}
+
+ChainSimulatorStats ChainSimulator::getStats() const
+{
+  return this->stats;
+}
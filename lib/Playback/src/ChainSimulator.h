@@ -0,0 +1,39 @@
+#ifndef _CHAIN_SIMULATOR_H_
+#define _CHAIN_SIMULATOR_H_
+
+#include <ChainLayout.h>
+#include "FrameOutput.h"
+
+struct ChainSimulatorStats
+{
+  uint64_t frames;           // frames that were not idle
+  uint64_t bus_micros;       // total time the bus was busy
+  uint32_t max_frame_micros; // longest frame including the gap, the shortest possible frame period
+  uint32_t max_latency;      // us from the start of a frame until the last clock received its instruction
+};
+
+/**
+ * @brief Simulates the bus timing of a wall driven like GpioOutput, without hardware.
+ *
+ * The frames are split like GpioOutput splits them, timed with ChainTiming and joined again for the target output
+ * (e.g. a DigitalTwin), so a split layout can be checked against the positions of a single chain.
+ */
+class ChainSimulator : public FrameOutput
+{
+public:
+  ChainSimulator(const ChainLayout &layout, const ChainTiming &timing = ChainTiming(), FrameOutput *target = NULL);
+
+  bool begin() override;
+  bool send(const Frame &frame) override;
+  void end() override;
+
+  ChainSimulatorStats getStats() const;
+
+private:
+  ChainLayout layout;
+  ChainTiming timing;
+  FrameOutput *target;
+  ChainSimulatorStats stats;
+};
+
+#endif
@@ -0,0 +1,283 @@
+#include "ChainTuner.h"
+#include <chrono>
+#include <thread>
+#include <FrameAddressing.h>
+
+ChainTuner::ChainTuner(FrameOutput &output) : output(output)
+{
+  this->clock_frame_gap = 0;
+  this->latency = 0;
+  this->report = ChainTunerReport();
+}
+
+/**
+ * @brief Searches the fastest timing every test frame returns intact with, and sets it on the output and the clocks.
+ *
+ * The tick period is lowered first, then the clock pulse and then the frame gap, each until a test fails.
+ * The clocks keep every tested timing, the result is one step slower than the fastest one as margin.
+ * Takes a few seconds for every failed test, the clocks have to revert the timing by themselves.
+ *
+ * @param start Timing the chain works with, the host and the clocks use it at the start (the frame gap of the clocks is TUNER_GAP_MARGIN less).
+ * @return false The output has a fixed timing, does not read back the frames, or the chain is not reliable even with the start timing.
+ */
+bool ChainTuner::tune(const ChainTiming &start)
+{
+  this->report = ChainTunerReport();
+  this->timing = start;
+  this->clock_frame_gap = start.frame_gap - TUNER_GAP_MARGIN;
+  if (start.frame_gap < CHAIN_MIN_FRAME_GAP + TUNER_GAP_MARGIN || !this->output.setTiming(start) || !this->enumerate() || !this->test(start))
+    return false;
+
+  // The tick period is only used by the host, the clocks pass on every tick as it comes
+  ChainTiming candidate = this->timing;
+  while (candidate.tick_period >= candidate.clock_out_high + 1 + TUNER_TICK_STEP)
+  {
+    candidate.tick_period -= TUNER_TICK_STEP;
+    if (!this->test(candidate))
+    {
+      this->output.setTiming(this->timing);
+      this->recover();
+      break;
+    }
+    this->timing = candidate;
+  }
+
+  candidate = this->timing;
+  while (candidate.clock_out_high > 1)
+  {
+    candidate.clock_out_high--;
+    if (!this->trial(candidate, this->clock_frame_gap))
+      break;
+  }
+
+  candidate = this->timing;
+  unsigned int gap = this->clock_frame_gap;
+  while (gap >= CHAIN_MIN_FRAME_GAP + TUNER_GAP_STEP && gap - TUNER_GAP_STEP > 2 * candidate.clock_out_high)
+  {
+    gap -= TUNER_GAP_STEP;
+    candidate.frame_gap = gap + TUNER_GAP_MARGIN;
+    if (!this->trial(candidate, gap))
+      break;
+  }
+
+  // One step slower than the fastest reliable timing
+  candidate = this->timing;
+  gap = this->clock_frame_gap;
+  if (candidate.tick_period < start.tick_period)
+    candidate.tick_period += TUNER_TICK_STEP;
+  if (candidate.clock_out_high < start.clock_out_high)
+    candidate.clock_out_high++;
+  if (gap < start.frame_gap - TUNER_GAP_MARGIN)
+    gap += TUNER_GAP_STEP;
+  candidate.frame_gap = gap + TUNER_GAP_MARGIN;
+  if (candidate.clock_out_high != this->timing.clock_out_high || gap != this->clock_frame_gap)
+  {
+    this->trial(candidate, gap);
+  }
+  else if (candidate.tick_period != this->timing.tick_period && this->output.setTiming(candidate))
+  {
+    this->timing = candidate;
+  }
+
+  this->report.timing = this->timing;
+  this->report.clock_frame_gap = this->clock_frame_gap;
+  this->report.max_latency = this->latency;
+  return true;
+}
+
+const ChainTunerReport &ChainTuner::getReport() const
+{
+  return this->report;
+}
+
+/**
+ * @brief Waits while the clocks work, overridden to advance a simulated chain.
+ */
+void ChainTuner::wait(unsigned int ms)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+/**
+ * @brief Counts the clocks with an enumeration frame, which also shows that the last clock is looped back.
+ */
+bool ChainTuner::enumerate()
+{
+  this->drain();
+  Frame frame;
+  encodeEnumeration(frame);
+  if (!this->output.send(frame))
+    return false;
+
+  Frame returned;
+  size_t clocks;
+  if (!this->output.receive(returned, TUNER_RETURN_TIMEOUT) || !decodeEnumeration(returned, clocks) || clocks == 0)
+    return false;
+  this->report.clocks = clocks;
+  return true;
+}
+
+/**
+ * @brief Sends TUNER_TEST_FRAMES back to back with the timing of the host and compares the returned frames.
+ *
+ * The output keeps the timing, also if the test fails.
+ */
+bool ChainTuner::test(const ChainTiming &timing)
+{
+  if (!this->output.setTiming(timing))
+    return false;
+  this->drain();
+  this->output.getReturnLatency();
+
+  Frame frames[TUNER_TEST_FRAMES];
+  for (size_t number = 0; number < TUNER_TEST_FRAMES; number++)
+  {
+    this->encodeTestFrame(frames[number], number);
+    this->report.test_frames++;
+    if (!this->output.send(frames[number]))
+    {
+      this->report.lost_frames++;
+      return false;
+    }
+  }
+
+  bool reliable = true;
+  for (size_t number = 0; number < TUNER_TEST_FRAMES; number++)
+  {
+    Frame returned;
+    if (!this->output.receive(returned, TUNER_RETURN_TIMEOUT))
+    {
+      this->report.lost_frames += TUNER_TEST_FRAMES - number;
+      return false;
+    }
+
+    bool intact = returned.getClocks() == frames[number].getClocks();
+    for (size_t i = 0; intact && i < returned.getClocks(); i++)
+    {
+      intact = returned.getInstruction(i) == frames[number].getInstruction(i);
+    }
+    if (!intact)
+    {
+      this->report.corrupted_frames++;
+      reliable = false;
+    }
+  }
+
+  if (reliable)
+    this->latency = this->output.getReturnLatency();
+  return reliable;
+}
+
+/**
+ * @brief Sets the timing on trial on all clocks and tests it. A reliable timing is kept by the clocks, otherwise they revert it.
+ *
+ * @param clock_frame_gap us, DELAY_BETWEEN_INSTRUCTIONS of the clocks, timing.frame_gap of the host is TUNER_GAP_MARGIN longer.
+ */
+bool ChainTuner::trial(const ChainTiming &timing, unsigned int clock_frame_gap)
+{
+  CommandEncoder commands(this->report.clocks);
+  for (size_t clock = 0; clock < this->report.clocks; clock++)
+  {
+    commands.setTiming(clock, timing.clock_out_high, clock_frame_gap);
+  }
+  if (this->send(commands))
+  {
+    // The clocks switch with the first test frame, the gap before it must be long enough for the previous timing
+    this->wait(TUNER_SETTLE_WAIT);
+    if (this->test(timing))
+    {
+      commands.clear();
+      for (size_t clock = 0; clock < this->report.clocks; clock++)
+      {
+        commands.keepTiming(clock);
+      }
+      if (this->send(commands))
+      {
+        this->timing = timing;
+        this->clock_frame_gap = clock_frame_gap;
+        return true;
+      }
+    }
+  }
+
+  // A command would not pass the chain with the failed timing, the clocks revert it by themselves
+  this->wait(TUNER_TRIAL_WAIT);
+  this->output.setTiming(this->timing);
+  this->recover();
+  return false;
+}
+
+bool ChainTuner::send(CommandEncoder &commands)
+{
+  Frame frame;
+  while (commands.hasNextFrame())
+  {
+    commands.nextFrame(frame);
+    if (!this->output.send(frame))
+      return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Brings the clocks back into a known state after corrupted frames.
+ *
+ * Clocks that took a corrupted frame as the start of a command receive TUNER_FLUSH_INSTRUCTION until the command is complete,
+ * its arguments are invalid or a timing trial that is reverted. Hands that were started by a corrupted command are stopped.
+ */
+void ChainTuner::recover()
+{
+  this->report.disturbed = true;
+
+  Frame flush(this->report.clocks);
+  for (size_t clock = 0; clock < this->report.clocks; clock++)
+  {
+    flush.setInstruction(clock, TUNER_FLUSH_INSTRUCTION);
+  }
+  for (size_t i = 0; i < MAX_COMMAND_FRAMES; i++)
+  {
+    this->output.send(flush);
+  }
+  this->wait(TUNER_TRIAL_WAIT);
+
+  CommandEncoder commands(this->report.clocks);
+  for (size_t clock = 0; clock < this->report.clocks; clock++)
+  {
+    commands.setVelocity(clock, 0, 0);
+  }
+  this->send(commands);
+  this->drain();
+}
+
+/**
+ * @brief Writes a test frame: addressed instructions for indexes no clock has, changing with every frame to toggle all data lines.
+ *
+ * The frame is about as long as the chain, a longer frame would be cut off by the chain head.
+ */
+void ChainTuner::encodeTestFrame(Frame &frame, size_t number) const
+{
+  size_t triples = (this->report.clocks - 1) / 3;
+  if (triples == 0)
+    triples = 1;
+  if (triples > MAX_ADDRESSED_CLOCKS)
+    triples = MAX_ADDRESSED_CLOCKS;
+
+  frame = Frame(1);
+  frame.setInstruction(0, FRAME_MARKER_ADDRESSED);
+  for (size_t i = 0; i < triples; i++)
+  {
+    size_t pattern = number * triples + i;
+    uint8_t index = TUNER_TEST_ADDRESS + pattern % (FRAME_ADDRESS_BROADCAST - TUNER_TEST_ADDRESS);
+    addAddressedInstruction(frame, index, (pattern * 5 + number) & 0x0F);
+  }
+}
+
+/**
+ * @brief Drops the frames returned before, e.g. the late frames of a failed test.
+ */
+void ChainTuner::drain()
+{
+  Frame returned;
+  while (this->output.receive(returned, TUNER_SETTLE_WAIT))
+    ;
+}
@@ -0,0 +1,68 @@
+#ifndef _CHAIN_TUNER_H_
+#define _CHAIN_TUNER_H_
+
+#include <CommandEncoder.h>
+#include "FrameOutput.h"
+
+#define TUNER_TEST_FRAMES 12        // loopback frames sent back to back per tested timing, fewer than SERIAL_RETURN_FRAMES
+#define TUNER_RETURN_TIMEOUT 100    // ms to wait for a returned frame
+#define TUNER_SETTLE_WAIT 10        // ms until the chain head sent its buffered frames with the previous timing
+#define TUNER_TRIAL_WAIT 2500       // ms until the clocks reverted a failed timing, longer than TIMING_TRIAL_PERIOD of the clock firmware
+#define TUNER_TICK_STEP 1           // us
+#define TUNER_GAP_STEP 10           // us
+#define TUNER_GAP_MARGIN 50         // us the host waits longer than the frame gap of the clocks, like CHAIN_HEAD_GAP_MARGIN
+#define TUNER_TEST_ADDRESS 0x80     // first index of the test instructions, no clock has it
+#define TUNER_FLUSH_INSTRUCTION 0xE // completes unfinished commands with invalid arguments, a telemetry marker for all other clocks
+
+struct ChainTunerReport
+{
+  ChainTiming timing;           // timing of the host, one step slower than the fastest reliable timing
+  unsigned int clock_frame_gap; // us, DELAY_BETWEEN_INSTRUCTIONS of the clocks
+  size_t clocks;                // clocks found by the enumeration
+  uint32_t max_latency;         // us from the first tick of a test frame until it passed the last clock, with the tuned timing
+  uint64_t test_frames;
+  uint64_t corrupted_frames;    // returned with other instructions
+  uint64_t lost_frames;         // not returned within TUNER_RETURN_TIMEOUT
+  bool disturbed;               // corrupted frames may have moved hands, the wall should be calibrated
+};
+
+/**
+ * @brief Finds the fastest reliable bus timing of a wall, using the frames the last clock passes back to the host.
+ *
+ * The last clock of the chain must be looped back to the output (chain head with CHAIN_HEAD_RETURN). Test frames are addressed frames
+ * with indexes no clock has, every clock passes them on unchanged. A timing is reliable if every test frame returns intact.
+ * The tick period is tested on the host only, the clock pulse and the frame gap are also sent to the clocks (COMMAND_TIMING).
+ * The clocks revert a timing on trial by themselves, so the tuner reaches them again after a timing that cut off the chain.
+ * The tuned timing of the clocks is lost when they restart, tune() has to be repeated after a power cycle of the wall.
+ */
+class ChainTuner
+{
+public:
+  explicit ChainTuner(FrameOutput &output);
+  virtual ~ChainTuner()
+  {
+  }
+
+  bool tune(const ChainTiming &start = ChainTiming());
+  const ChainTunerReport &getReport() const;
+
+protected:
+  virtual void wait(unsigned int ms);
+
+private:
+  bool enumerate();
+  bool test(const ChainTiming &timing);
+  bool trial(const ChainTiming &timing, unsigned int clock_frame_gap);
+  bool send(CommandEncoder &commands);
+  void recover();
+  void encodeTestFrame(Frame &frame, size_t number) const;
+  void drain();
+
+  FrameOutput &output;
+  ChainTiming timing;           // timing of the host that works, the clocks use clock_frame_gap
+  unsigned int clock_frame_gap; // us
+  uint32_t latency;             // us, of the last test
+  ChainTunerReport report;
+};
+
+#endif
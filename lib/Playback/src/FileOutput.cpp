@@ -0,0 +1,18 @@
+#include "FileOutput.h"
+
+FileOutput::FileOutput(FILE *file)
+{
+  this->file = file;
+}
+
+bool FileOutput::send(const Frame &frame)
+{
+  uint8_t buffer[MAX_SERIALIZED_FRAME_BYTES];
+  size_t size = frame.serialize(buffer);
+  return fwrite(buffer, 1, size, this->file) == size;
+}
+
+void FileOutput::end()
+{
+  fflush(this->file);
+}
@@ -0,0 +1,22 @@
+#ifndef _FILE_OUTPUT_H_
+#define _FILE_OUTPUT_H_
+
+#include <stdio.h>
+#include "FrameOutput.h"
+
+/**
+ * @brief Writes frames in the serial format of the chain head into a file. Used for tests and recordings.
+ */
+class FileOutput : public FrameOutput
+{
+public:
+  explicit FileOutput(FILE *file);
+
+  bool send(const Frame &frame) override;
+  void end() override;
+
+private:
+  FILE *file;
+};
+
+#endif
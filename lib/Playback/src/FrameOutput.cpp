@@ -0,0 +1,50 @@
+#include "FrameOutput.h"
+#include <time.h>
+
+/**
+ * @brief Microseconds of the monotonic clock.
+ */
+uint64_t monotonicMicros()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * @brief Busy waits until the monotonic clock reached the given time.
+ *
+ * Used for the bus timing, which is too short for the scheduler.
+ */
+void waitUntilMicros(uint64_t micros)
+{
+  while (monotonicMicros() < micros)
+    ;
+}
+
+/**
+ * @brief Whether the chain head and the clocks can use the timing: every tick ends before the next one, frames are told apart.
+ */
+bool ChainTiming::isValid() const
+{
+  return this->clock_out_high > 0 && this->tick_period > this->clock_out_high && this->tick_period <= CHAIN_MAX_TICK_PERIOD &&
+         this->frame_gap >= CHAIN_MIN_FRAME_GAP;
+}
+
+/**
+ * @brief Time the bus is busy with a frame of the given instructions, including the gap to the next frame.
+ */
+uint32_t ChainTiming::getFrameMicros(size_t ticks) const
+{
+  return ticks == 0 ? 0 : ticks * this->tick_period + this->frame_gap;
+}
+
+/**
+ * @brief Time from the start of a frame until a clock of the chain receives its instruction.
+ *
+ * The tick of the clock is sent after all ticks of the clocks before it and passes all of them.
+ */
+uint32_t ChainTiming::getLatencyMicros(size_t clock) const
+{
+  return clock * (this->tick_period + this->hop_delay);
+}
@@ -0,0 +1,83 @@
+#ifndef _FRAME_OUTPUT_H_
+#define _FRAME_OUTPUT_H_
+
+#include <Frame.h>
+
+#define CHAIN_MIN_FRAME_GAP 50    // us, must match TIMING_MIN_FRAME_GAP of the clock firmware
+#define CHAIN_MAX_TICK_PERIOD 255 // us, the chain head keeps the tick period in a byte
+
+uint64_t monotonicMicros();
+void waitUntilMicros(uint64_t micros);
+
+/**
+ * @brief Bus timing of the chain. The defaults match Config.h of the clock firmware.
+ */
+struct ChainTiming
+{
+  unsigned int clock_out_high = 4; // us the clock wire is high (CLOCK_OUT_HIGH)
+  unsigned int tick_period = 50;   // us between two instructions of a frame (CHAIN_HEAD_TICK_PERIOD), safe without tuning
+  unsigned int frame_gap = 350;    // us without tick between two frames, more than DELAY_BETWEEN_INSTRUCTIONS
+  unsigned int hop_delay = 9;      // us a clock needs to pass an instruction on (processDataInput())
+
+  bool isValid() const;
+  uint32_t getFrameMicros(size_t ticks) const;
+  uint32_t getLatencyMicros(size_t clock) const;
+};
+
+/**
+ * @brief Destination of the frames of a PlaybackEngine.
+ *
+ * send() is called from the output thread, it must not allocate or block longer than a frame period.
+ * Outputs that read back the frames passed on by the last clock (telemetry) implement receive().
+ * Outputs with an adjustable bus timing implement setTiming(), ChainTuner uses both to find the fastest timing of a chain.
+ */
+class FrameOutput
+{
+public:
+  virtual ~FrameOutput()
+  {
+  }
+
+  virtual bool begin()
+  {
+    return true;
+  }
+
+  virtual bool send(const Frame &frame) = 0;
+
+  /**
+   * @brief Returns the next frame passed on by the last clock of the chain, in the order they were returned.
+   *
+   * @return false if no frame was returned within the timeout or the output can not read back.
+   */
+  virtual bool receive(Frame &frame, unsigned int timeout_ms)
+  {
+    return false;
+  }
+
+  /**
+   * @brief Sends the following frames with the timing.
+   *
+   * @return false if the output has a fixed timing or the timing is invalid.
+   */
+  virtual bool setTiming(const ChainTiming &timing)
+  {
+    return false;
+  }
+
+  /**
+   * @brief Highest propagation delay through the chain of the frames returned since the last call, 0 = unknown.
+   *
+   * The delay is the time in us from the first tick of a frame until its first instruction passed the last clock.
+   */
+  virtual uint32_t getReturnLatency()
+  {
+    return 0;
+  }
+
+  virtual void end()
+  {
+  }
+};
+
+#endif
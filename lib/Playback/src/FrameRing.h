@@ -0,0 +1,73 @@
+#ifndef _FRAME_RING_H_
+#define _FRAME_RING_H_
+
+#include <atomic>
+#include <Frame.h>
+
+/**
+ * @brief Lock free single producer single consumer ring buffer of frames.
+ *
+ * One thread may push, another one may pop at the same time. The frames are stored inside the ring, nothing is allocated.
+ *
+ * @tparam CAPACITY Number of slots, must be a power of two. One slot always stays free.
+ */
+template <size_t CAPACITY>
+class FrameRing
+{
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+public:
+  FrameRing() : head(0), tail(0)
+  {
+  }
+
+  /**
+   * @brief Adds a frame. Only called by the producer.
+   *
+   * @return false The ring is full.
+   */
+  bool push(const Frame &frame)
+  {
+    size_t current_head = this->head.load(std::memory_order_relaxed);
+    size_t next = (current_head + 1) & (CAPACITY - 1);
+    if (next == this->tail.load(std::memory_order_acquire))
+      return false;
+
+    this->frames[current_head] = frame;
+    this->head.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Removes the oldest frame. Only called by the consumer.
+   *
+   * @return false The ring is empty.
+   */
+  bool pop(Frame &frame)
+  {
+    size_t current_tail = this->tail.load(std::memory_order_relaxed);
+    if (current_tail == this->head.load(std::memory_order_acquire))
+      return false;
+
+    frame = this->frames[current_tail];
+    this->tail.store((current_tail + 1) & (CAPACITY - 1), std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const
+  {
+    return (this->head.load(std::memory_order_acquire) - this->tail.load(std::memory_order_acquire)) & (CAPACITY - 1);
+  }
+
+  bool isFull() const
+  {
+    return this->size() == CAPACITY - 1;
+  }
+
+private:
+  Frame frames[CAPACITY];
+  std::atomic<size_t> head; // next slot to write
+  std::atomic<size_t> tail; // next slot to read
+};
+
+#endif
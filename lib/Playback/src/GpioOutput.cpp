@@ -0,0 +1,143 @@
+#include "GpioOutput.h"
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+GpioOutput::GpioOutput(const char *chip, const uint32_t lines[GPIO_LINES_PER_CHAIN], const ChainTiming &timing)
+    : GpioOutput(chip, (const uint32_t(*)[GPIO_LINES_PER_CHAIN])lines, ChainLayout(), timing)
+{
+}
+
+GpioOutput::GpioOutput(const char *chip, const uint32_t lines[][GPIO_LINES_PER_CHAIN], const ChainLayout &layout, const ChainTiming &timing)
+{
+  this->chip = chip;
+  this->layout = layout;
+  memcpy(this->lines, lines, layout.getChains() * sizeof(this->lines[0]));
+  this->timing = timing;
+  this->fd = -1;
+  this->last_tick_micros = 0;
+}
+
+GpioOutput::~GpioOutput()
+{
+  this->end();
+}
+
+/**
+ * @brief Requests the lines of all chains as outputs. All lines start low.
+ */
+bool GpioOutput::begin()
+{
+  int chip_fd = open(this->chip, O_RDONLY);
+  if (chip_fd < 0)
+    return false;
+
+  struct gpiohandle_request request;
+  memset(&request, 0, sizeof(request));
+  for (size_t chain = 0; chain < this->layout.getChains(); chain++)
+  {
+    for (size_t i = 0; i < GPIO_LINES_PER_CHAIN; i++)
+    {
+      request.lineoffsets[chain * GPIO_LINES_PER_CHAIN + i] = this->lines[chain][i];
+    }
+  }
+  request.lines = this->layout.getChains() * GPIO_LINES_PER_CHAIN;
+  request.flags = GPIOHANDLE_REQUEST_OUTPUT;
+  strncpy(request.consumer_label, "adclock", sizeof(request.consumer_label) - 1);
+
+  int result = ioctl(chip_fd, GPIO_GET_LINEHANDLE_IOCTL, &request);
+  close(chip_fd);
+  if (result < 0)
+    return false;
+
+  this->fd = request.fd;
+  return true;
+}
+
+/**
+ * @brief Clocks out the instructions of every chain up to its last active clock. Idle frames are not sent.
+ *
+ * The data lines are set before the rising edge of the clock, so the clock reads stable data in its ISR.
+ * The chains are clocked together, so a frame takes as long as the longest active chain.
+ */
+bool GpioOutput::send(const Frame &frame)
+{
+  Frame chain_frames[MAX_CHAINS];
+  size_t active[MAX_CHAINS];
+  size_t ticks = 0;
+  this->layout.split(frame, chain_frames);
+  for (size_t chain = 0; chain < this->layout.getChains(); chain++)
+  {
+    active[chain] = chain_frames[chain].getActiveClocks();
+    if (active[chain] > ticks)
+      ticks = active[chain];
+  }
+  if (ticks == 0)
+    return true;
+
+  // Every clock must detect the end of the previous frame
+  waitUntilMicros(this->last_tick_micros + this->timing.frame_gap);
+
+  uint8_t instructions[MAX_CHAINS];
+  bool clocks[MAX_CHAINS];
+  bool no_clocks[MAX_CHAINS] = {false};
+  for (size_t tick = 0; tick < ticks; tick++)
+  {
+    uint64_t tick_micros = monotonicMicros();
+    for (size_t chain = 0; chain < this->layout.getChains(); chain++)
+    {
+      clocks[chain] = tick < active[chain];
+      instructions[chain] = clocks[chain] ? chain_frames[chain].getInstruction(tick) : 0;
+    }
+
+    if (!this->setLines(instructions, no_clocks) || !this->setLines(instructions, clocks))
+      return false;
+    waitUntilMicros(tick_micros + this->timing.clock_out_high);
+    if (!this->setLines(instructions, no_clocks))
+      return false;
+    this->last_tick_micros = monotonicMicros();
+    waitUntilMicros(tick_micros + this->timing.tick_period);
+  }
+  return true;
+}
+
+/**
+ * @brief Uses the timing from the next frame on. The frames are not read back, a ChainTuner needs a chain head instead.
+ */
+bool GpioOutput::setTiming(const ChainTiming &timing)
+{
+  if (!timing.isValid())
+    return false;
+  this->timing = timing;
+  return true;
+}
+
+void GpioOutput::end()
+{
+  if (this->fd >= 0)
+  {
+    uint8_t instructions[MAX_CHAINS] = {0};
+    bool clocks[MAX_CHAINS] = {false};
+    this->setLines(instructions, clocks);
+    close(this->fd);
+    this->fd = -1;
+  }
+}
+
+bool GpioOutput::setLines(const uint8_t *instructions, const bool *clocks)
+{
+  struct gpiohandle_data data;
+  memset(&data, 0, sizeof(data));
+  for (size_t chain = 0; chain < this->layout.getChains(); chain++)
+  {
+    uint8_t *values = &data.values[chain * GPIO_LINES_PER_CHAIN];
+    values[0] = clocks[chain];
+    values[1] = (instructions[chain] >> 3) & 1;
+    values[2] = (instructions[chain] >> 2) & 1;
+    values[3] = (instructions[chain] >> 1) & 1;
+    values[4] = instructions[chain] & 1;
+  }
+  return ioctl(this->fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data) >= 0;
+}
@@ -0,0 +1,47 @@
+#ifndef _GPIO_OUTPUT_H_
+#define _GPIO_OUTPUT_H_
+
+#include <stdint.h>
+#include <ChainLayout.h>
+#include "FrameOutput.h"
+
+#define GPIO_LINES_PER_CHAIN 5
+
+/**
+ * @brief Sends frames directly to the first clock using a Linux gpiochip character device (e.g. on a Raspberry Pi).
+ *
+ * A wall split into several chains (ChainLayout) is driven in parallel: every chain has its own five lines,
+ * all lines are set with a single ioctl, so the ticks of all chains are sent at the same time.
+ */
+class GpioOutput : public FrameOutput
+{
+public:
+  /**
+   * @param chip Path of the gpiochip, e.g. /dev/gpiochip0.
+   * @param lines Line offsets: clock, data 1, data 2, data 3, data 4.
+   */
+  GpioOutput(const char *chip, const uint32_t lines[GPIO_LINES_PER_CHAIN], const ChainTiming &timing = ChainTiming());
+
+  /**
+   * @param lines Line offsets of every chain of the layout.
+   */
+  GpioOutput(const char *chip, const uint32_t lines[][GPIO_LINES_PER_CHAIN], const ChainLayout &layout, const ChainTiming &timing = ChainTiming());
+  ~GpioOutput();
+
+  bool begin() override;
+  bool send(const Frame &frame) override;
+  bool setTiming(const ChainTiming &timing) override;
+  void end() override;
+
+private:
+  bool setLines(const uint8_t *instructions, const bool *clocks);
+
+  const char *chip;
+  uint32_t lines[MAX_CHAINS][GPIO_LINES_PER_CHAIN];
+  ChainLayout layout;
+  ChainTiming timing;
+  int fd;
+  uint64_t last_tick_micros;
+};
+
+#endif
@@ -0,0 +1,199 @@
+#include "PlaybackEngine.h"
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+
+PlaybackEngine::PlaybackEngine(FrameSource &source, FrameOutput &output, uint32_t frame_period)
+    : source(source), frame_output(output), frame_period(frame_period), priority(0), cpu(-1), realtime(false),
+      running(false), source_done(false), frames(0), underruns(0), errors(0), max_jitter(0), total_jitter(0)
+{
+}
+
+PlaybackEngine::~PlaybackEngine()
+{
+  this->stop();
+}
+
+/**
+ * @brief Runs the output thread with SCHED_FIFO. Must be called before start().
+ *
+ * Requires CAP_SYS_NICE (or root). Without it the engine still runs with normal scheduling, see isRealtime().
+ *
+ * @param priority SCHED_FIFO priority (1 - 99).
+ * @param cpu CPU the output thread is pinned to, -1 = any CPU.
+ */
+void PlaybackEngine::setRealtime(int priority, int cpu)
+{
+  this->priority = priority;
+  this->cpu = cpu;
+}
+
+/**
+ * @brief Checks if the output thread actually got the realtime scheduling.
+ */
+bool PlaybackEngine::isRealtime() const
+{
+  return this->realtime;
+}
+
+/**
+ * @brief Starts the planner and output thread.
+ */
+bool PlaybackEngine::start()
+{
+  if (this->running || !this->frame_output.begin())
+    return false;
+
+  this->running = true;
+  this->source_done = false;
+  this->planner_thread = std::thread(&PlaybackEngine::plan, this);
+  this->output_thread = std::thread(&PlaybackEngine::output, this);
+  return true;
+}
+
+/**
+ * @brief Waits until all frames of the source are sent.
+ */
+void PlaybackEngine::wait()
+{
+  if (!this->output_thread.joinable())
+    return; // Not started or already finished
+
+  this->output_thread.join();
+  this->running = false; // The planner might wait for space in the ring
+  this->planner_thread.join();
+  this->frame_output.end();
+}
+
+/**
+ * @brief Stops the playback immediately. Frames in the ring are dropped.
+ */
+void PlaybackEngine::stop()
+{
+  this->running = false;
+  this->wait();
+}
+
+bool PlaybackEngine::isRunning() const
+{
+  return this->running;
+}
+
+PlaybackStats PlaybackEngine::getStats() const
+{
+  PlaybackStats stats;
+  stats.frames = this->frames;
+  stats.underruns = this->underruns;
+  stats.errors = this->errors;
+  stats.max_jitter = this->max_jitter;
+  stats.mean_jitter = stats.frames > 0 ? this->total_jitter / stats.frames : 0;
+  return stats;
+}
+
+/**
+ * @brief Planner thread: Keeps the ring filled with frames from the source.
+ */
+void PlaybackEngine::plan()
+{
+  Frame frame;
+  bool pending = false;
+
+  while (this->running)
+  {
+    if (!pending)
+    {
+      if (!this->source.next(frame))
+        break;
+      pending = true;
+    }
+
+    if (this->ring.push(frame))
+    {
+      pending = false;
+    }
+    else
+    {
+      // Ring is full, the output thread needs some periods to make space
+      uint64_t pause_micros = (uint64_t)this->frame_period * PLAYBACK_RING_SIZE / 4;
+      if (pause_micros > PLAYBACK_MAX_PAUSE)
+        pause_micros = PLAYBACK_MAX_PAUSE;
+      struct timespec pause = {(time_t)(pause_micros / 1000000), (long)(pause_micros % 1000000) * 1000};
+      nanosleep(&pause, NULL);
+    }
+  }
+
+  this->source_done = true;
+}
+
+/**
+ * @brief Output thread: Sends one frame per frame period at absolute deadlines.
+ *
+ * The deadlines do not drift, a late frame does not delay the following ones.
+ */
+void PlaybackEngine::output()
+{
+  this->enterRealtime();
+
+  struct timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  Frame frame;
+
+  while (this->running)
+  {
+    deadline.tv_nsec += (long)this->frame_period * 1000;
+    while (deadline.tv_nsec >= 1000000000)
+    {
+      deadline.tv_nsec -= 1000000000;
+      deadline.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+
+    uint64_t deadline_micros = (uint64_t)deadline.tv_sec * 1000000 + deadline.tv_nsec / 1000;
+    uint64_t now = monotonicMicros();
+    uint32_t jitter = now > deadline_micros ? now - deadline_micros : 0;
+
+    bool done = this->source_done; // read before the ring, the last frame is pushed before source_done is set
+    if (!this->ring.pop(frame))
+    {
+      if (done)
+        break; // All frames sent
+      this->underruns++;
+      continue;
+    }
+
+    if (!this->frame_output.send(frame))
+    {
+      this->errors++;
+      continue;
+    }
+
+    this->frames++;
+    this->total_jitter += jitter;
+    if (jitter > this->max_jitter)
+      this->max_jitter = jitter;
+  }
+
+  this->running = false;
+}
+
+void PlaybackEngine::enterRealtime()
+{
+  if (this->priority <= 0)
+    return;
+
+  // Page faults would break the timing
+  mlockall(MCL_CURRENT | MCL_FUTURE);
+
+  if (this->cpu >= 0)
+  {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(this->cpu, &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  }
+
+  struct sched_param parameter;
+  parameter.sched_priority = this->priority;
+  this->realtime = pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameter) == 0;
+}
@@ -0,0 +1,88 @@
+#ifndef _PLAYBACK_ENGINE_H_
+#define _PLAYBACK_ENGINE_H_
+
+#include <atomic>
+#include <thread>
+#include "FrameOutput.h"
+#include "FrameRing.h"
+
+#define PLAYBACK_RING_SIZE 256
+#define PLAYBACK_MAX_PAUSE 100000 // us the planner waits at most for space in the ring, delays stop()
+
+/**
+ * @brief Source of the frames of a PlaybackEngine, e.g. a planner or an AnimationReader.
+ *
+ * next() is called from the planner thread.
+ */
+class FrameSource
+{
+public:
+  virtual ~FrameSource()
+  {
+  }
+
+  /**
+   * @return false There are no more frames.
+   */
+  virtual bool next(Frame &frame) = 0;
+};
+
+struct PlaybackStats
+{
+  uint64_t frames;       // frames sent to the output, the jitter is measured for them
+  uint64_t underruns;    // frame periods without a frame in the ring
+  uint64_t errors;       // frames the output failed to send
+  uint32_t max_jitter;   // us the output thread woke up after the deadline
+  uint32_t mean_jitter;  // us
+};
+
+/**
+ * @brief Plays frames with a fixed frame period.
+ *
+ * A planner thread fills a lock free ring with frames from the source.
+ * The output thread (optionally SCHED_FIFO and pinned to a CPU) takes one frame per period and sends it to the output.
+ * A slow source never stalls the bus timing, it only causes underruns.
+ */
+class PlaybackEngine
+{
+public:
+  PlaybackEngine(FrameSource &source, FrameOutput &output, uint32_t frame_period);
+  ~PlaybackEngine();
+
+  void setRealtime(int priority, int cpu);
+  bool isRealtime() const;
+
+  bool start();
+  void wait();
+  void stop();
+  bool isRunning() const;
+
+  PlaybackStats getStats() const;
+
+private:
+  void plan();
+  void output();
+  void enterRealtime();
+
+  FrameSource &source;
+  FrameOutput &frame_output;
+  uint32_t frame_period; // us
+
+  int priority; // SCHED_FIFO priority of the output thread, 0 = normal scheduling
+  int cpu;      // CPU of the output thread, -1 = any
+  std::atomic<bool> realtime;
+
+  FrameRing<PLAYBACK_RING_SIZE> ring;
+  std::thread planner_thread;
+  std::thread output_thread;
+  std::atomic<bool> running;
+  std::atomic<bool> source_done;
+
+  std::atomic<uint64_t> frames;
+  std::atomic<uint64_t> underruns;
+  std::atomic<uint64_t> errors;
+  std::atomic<uint32_t> max_jitter;
+  std::atomic<uint64_t> total_jitter;
+};
+
+#endif
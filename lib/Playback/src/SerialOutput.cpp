@@ -0,0 +1,241 @@
+#include "SerialOutput.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+static speed_t toSpeed(unsigned long baud_rate)
+{
+  switch (baud_rate)
+  {
+  case 115200:
+    return B115200;
+  case 230400:
+    return B230400;
+  case 460800:
+    return B460800;
+  case 500000:
+    return B500000;
+  case 921600:
+    return B921600;
+  case 1000000:
+    return B1000000;
+  default:
+    return B0;
+  }
+}
+
+SerialOutput::SerialOutput(const char *port, unsigned long baud_rate)
+{
+  this->port = port;
+  this->baud_rate = baud_rate;
+  this->fd = -1;
+  this->credits = 0;
+  this->returning_size = 0;
+  this->returning_bytes = 0;
+  this->synced = false;
+  this->length_received = false;
+  this->latency_bytes = 0;
+  this->latency = 0;
+  this->max_latency = 0;
+}
+
+SerialOutput::~SerialOutput()
+{
+  this->end();
+}
+
+/**
+ * @brief Opens the serial port in raw mode.
+ */
+bool SerialOutput::begin()
+{
+  speed_t speed = toSpeed(this->baud_rate);
+  if (speed == B0)
+    return false;
+
+  this->fd = open(this->port, O_RDWR | O_NOCTTY);
+  if (this->fd < 0)
+    return false;
+
+  struct termios options;
+  if (tcgetattr(this->fd, &options) != 0)
+  {
+    this->end();
+    return false;
+  }
+  cfmakeraw(&options);
+  cfsetispeed(&options, speed);
+  cfsetospeed(&options, speed);
+  options.c_cflag |= CLOCAL | CREAD;
+  if (tcsetattr(this->fd, TCSANOW, &options) != 0)
+  {
+    this->end();
+    return false;
+  }
+
+  this->credits = 0;
+  this->synced = false;
+  this->length_received = false;
+  this->latency_bytes = 0;
+  this->max_latency = 0;
+  return true;
+}
+
+/**
+ * @brief Sends the frame as soon as the chain head has a free frame buffer. Idle frames are not sent.
+ *
+ * @return false The chain head did not acknowledge within SERIAL_ACK_TIMEOUT or writing failed.
+ */
+bool SerialOutput::send(const Frame &frame)
+{
+  uint8_t buffer[MAX_SERIALIZED_FRAME_BYTES];
+  size_t size = frame.serialize(buffer);
+  if (size == 0)
+    return true;
+
+  if (!this->waitForCredit())
+    return false;
+
+  if (write(this->fd, buffer, size) != (ssize_t)size)
+    return false;
+
+  this->credits--;
+  return true;
+}
+
+void SerialOutput::end()
+{
+  if (this->fd >= 0)
+  {
+    close(this->fd);
+    this->fd = -1;
+  }
+}
+
+/**
+ * @brief Returns the next frame returned by the chain head, see FrameOutput::receive().
+ */
+bool SerialOutput::receive(Frame &frame, unsigned int timeout_ms)
+{
+  uint64_t until = monotonicMicros() + timeout_ms * 1000ULL;
+  while (!this->returned.pop(frame))
+  {
+    uint64_t now = monotonicMicros();
+    if (now >= until || !this->read((until - now + 999) / 1000))
+      return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Sends a timing message, the chain head uses it from the next frame on. Frames already sent may still use the old timing.
+ */
+bool SerialOutput::setTiming(const ChainTiming &timing)
+{
+  if (!timing.isValid() || timing.frame_gap > 0xFFFF)
+    return false;
+
+  uint8_t message[5] = {SERIAL_TIMING, (uint8_t)timing.clock_out_high, (uint8_t)timing.tick_period, (uint8_t)(timing.frame_gap >> 8),
+                        (uint8_t)(timing.frame_gap & 0xFF)};
+  return write(this->fd, message, sizeof(message)) == (ssize_t)sizeof(message);
+}
+
+uint32_t SerialOutput::getReturnLatency()
+{
+  uint32_t latency = this->max_latency;
+  this->max_latency = 0;
+  return latency;
+}
+
+bool SerialOutput::waitForCredit()
+{
+  while (this->credits == 0)
+  {
+    if (!this->read(SERIAL_ACK_TIMEOUT))
+      return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Waits for data from the chain head and parses it.
+ *
+ * @return false if nothing was received within the timeout.
+ */
+bool SerialOutput::read(unsigned int timeout_ms)
+{
+  struct pollfd request = {this->fd, POLLIN, 0};
+  if (poll(&request, 1, timeout_ms) <= 0)
+    return false;
+
+  uint8_t received[16];
+  ssize_t count = ::read(this->fd, received, sizeof(received));
+  if (count <= 0)
+    return false;
+
+  for (ssize_t i = 0; i < count; i++)
+  {
+    this->parse(received[i]);
+  }
+  return true;
+}
+
+/**
+ * @brief Counts the acknowledges and collects the returned frames, like ChainHead::receive() collects the sent frames.
+ *
+ * Returned frames are dropped if the ring is full.
+ */
+void SerialOutput::parse(uint8_t data)
+{
+  if (this->latency_bytes > 0)
+  {
+    this->latency = this->latency << 8 | data;
+    if (++this->latency_bytes == 3)
+    {
+      if (this->latency > this->max_latency)
+        this->max_latency = this->latency;
+      this->latency_bytes = 0;
+    }
+    return;
+  }
+
+  if (!this->synced)
+  {
+    if (data == SERIAL_LATENCY)
+    {
+      this->latency = 0;
+      this->latency_bytes = 1;
+      return;
+    }
+    if (data == SERIAL_ACK)
+      this->credits++;
+    this->synced = data == FRAME_SYNC;
+    return;
+  }
+
+  if (!this->length_received)
+  {
+    if (data == 0 || data > MAX_CHAIN_LENGTH)
+    {
+      this->synced = false;
+      return;
+    }
+    this->returning = Frame(data);
+    this->returning_size = (data + 1) / 2;
+    this->returning_bytes = 0;
+    this->length_received = true;
+    return;
+  }
+
+  size_t clock = this->returning_bytes * 2;
+  this->returning.setInstruction(clock, data >> 4);
+  if (clock + 1 < this->returning.getClocks())
+    this->returning.setInstruction(clock + 1, data & 0x0F);
+  if (++this->returning_bytes == this->returning_size)
+  {
+    this->returned.push(this->returning);
+    this->synced = false;
+    this->length_received = false;
+  }
+}
@@ -0,0 +1,56 @@
+#ifndef _SERIAL_OUTPUT_H_
+#define _SERIAL_OUTPUT_H_
+
+#include "FrameOutput.h"
+#include "FrameRing.h"
+
+#define SERIAL_ACK 0x06          // must match CHAIN_HEAD_ACK of the chain head firmware
+#define SERIAL_TIMING 0x54       // must match CHAIN_HEAD_TIMING
+#define SERIAL_LATENCY 0x4C      // must match CHAIN_HEAD_LATENCY
+#define SERIAL_ACK_TIMEOUT 100   // ms to wait for a free frame buffer of the chain head
+#define SERIAL_RETURN_FRAMES 16  // returned frames kept until receive() is called, power of two
+
+/**
+ * @brief Sends frames to the chain head firmware over a serial port (USB).
+ *
+ * The chain head acknowledges every free frame buffer, frames are only sent when a buffer is free.
+ * With CHAIN_HEAD_RETURN the chain head also sends the frames returned by the last clock, starting with FRAME_SYNC like sent frames,
+ * each after a latency message with its propagation delay through the chain.
+ * setTiming() changes the timing of the chain head, it is reset with the chain head.
+ * receive() must be called from the thread that sends.
+ */
+class SerialOutput : public FrameOutput
+{
+public:
+  SerialOutput(const char *port, unsigned long baud_rate = 500000);
+  ~SerialOutput();
+
+  bool begin() override;
+  bool send(const Frame &frame) override;
+  bool receive(Frame &frame, unsigned int timeout_ms) override;
+  bool setTiming(const ChainTiming &timing) override;
+  uint32_t getReturnLatency() override;
+  void end() override;
+
+private:
+  bool waitForCredit();
+  bool read(unsigned int timeout_ms);
+  void parse(uint8_t data);
+
+  const char *port;
+  unsigned long baud_rate;
+  int fd;
+  unsigned int credits; // free frame buffers of the chain head
+
+  FrameRing<SERIAL_RETURN_FRAMES> returned;
+  Frame returning;       // frame returned by the chain head that is being read
+  size_t returning_size; // bytes of the returning frame, without the sync and length byte
+  size_t returning_bytes;
+  bool synced;          // FRAME_SYNC read, the next byte is the length
+  bool length_received;
+  size_t latency_bytes; // bytes of the latency message read, 0 = no latency message
+  uint32_t latency;
+  uint32_t max_latency; // since the last getReturnLatency()
+};
+
+#endif
@@ -3,9 +3,32 @@
 #include <FastGPIO.h>
 #include "Config.h"
 
+/**
+ * @brief Reads a hall sensor pin.
+ *
+ * Uses FastGPIO for the known hall sensor pins, which is a lot faster than digitalRead.
+ */
+bool quickRead(size_t pin)
+{
+  switch (pin)
+  {
+  case A0:
+    return FastGPIO::Pin<A0>::isInputHigh();
+  case A1:
+    return FastGPIO::Pin<A1>::isInputHigh();
+
+  default:
+    return digitalRead(pin) == HIGH;
+  }
+}
+
 Calibration::Calibration(Motor &m, size_t hall_pin) : motor(m), hall_pin(hall_pin)
 {
   pinMode(hall_pin, INPUT_PULLUP);
+
+  // Enable the pin change interrupt for the hall sensor
+  *digitalPinToPCMSK(hall_pin) |= bit(digitalPinToPCMSKbit(hall_pin));
+  *digitalPinToPCICR(hall_pin) |= bit(digitalPinToPCICRbit(hall_pin));
 }
 
 /**
@@ -16,6 +39,53 @@ void Calibration::startCalibration()
 {
   this->steps = 0;
   this->state = FIND_MAGNET;
+  this->edge_tail = this->edge_head;
+  this->precise = false;
+  this->step_delay = CALIBRATION_PRECISE_STEP_DELAY;
+  this->last_step_micros = 0;
+}
+
+/**
+ * @brief Starts a verification of a stored calibration instead of a full calibration.
+ *
+ * The stored position is only trusted, if the hall sensor agrees with it and the hand finds the field where it is expected:
+ * the hand is moved in front of the known field on the shortest way (APPROACH, at most half a revolution, accelerating like the
+ * coarse search) and sweeps through it precisely. A wrong position is corrected by the sweep, which measures the field like a full
+ * calibration.
+ *
+ * @param position Stored position of the motor.
+ * @param field_width Stored width of the magnet field.
+ * @return true The stored calibration is plausible, continue with calibrate().
+ * @return false The hall sensor disagrees. A full calibration is required.
+ */
+bool Calibration::startVerification(size_t position, size_t field_width)
+{
+  if (position >= MAX_STEPS || field_width < MIN_WIDTH_FOR_RECALIBRATION || field_width > MAX_STEPS / 2)
+    return false;
+
+  // Distance to the center of the field, the edges are uncertain by MIN_STEPS_OUTSIDE_FIELD
+  size_t distance = diff(position, 0, getShortestDirection(position, 0));
+  if (distance + MIN_STEPS_OUTSIDE_FIELD < field_width / 2 && !isInField())
+    return false;
+  if (distance > field_width / 2 + MIN_STEPS_OUTSIDE_FIELD && isInField())
+    return false;
+
+  this->motor.reset();
+  this->motor.setCurrentPosition(position);
+  this->field_width = field_width;
+  this->edge_tail = this->edge_head;
+
+  this->approach_pos = MAX_STEPS - (field_width / 2) - 2 * MIN_STEPS_OUTSIDE_FIELD;
+  this->state = APPROACH;
+  this->precise = false;
+  this->step_delay = CALIBRATION_PRECISE_STEP_DELAY;
+  this->last_step_micros = 0;
+  return true;
+}
+
+size_t Calibration::getFieldWidth()
+{
+  return this->field_width;
 }
 
 /**
@@ -26,10 +96,16 @@ void Calibration::startCalibration()
  *   1. Check if the motor is inside the magnetic field and the steps are less than MIN_STEPS_OUTSIDE_FIELD.
  *   2. Forcing the motor to leave the magnetic field by rotating it backwards until MIN_STEPS_OUTSIDE_FIELD is reached. (LEAVE_MAGNET)
  * 2. The motor must find the magnetic field (FIND_MAGNET) by stepping forward.
+ *   1. The first search is coarse: the motor accelerates up to its min step delay (Motor::getMinStepDelay()).
+ *   2. After the field is found, the motor backs off (LEAVE_MAGNET) and searches the edge again at CALIBRATION_PRECISE_STEP_DELAY.
  * 3. The motor must walk through the magnetic field (INFIELD) and count the width of the field.
  * 4. The motor must rotate backwards by half the width of the field (CENTERING).
  * 5. The motor is calibrated (CALIBRATED).
  *
+ * A verification started with startVerification() first moves the motor in front of the known field (APPROACH) and continues with 2.2.
+ *
+ * Every call executes at most one step. Call it in a tight loop, the step timing is handled internally.
+ *
  * @return true
  * @return false
  */
@@ -38,16 +114,39 @@ bool Calibration::calibrate()
   if (this->state == CALIBRATED)
     return true;
 
+  if (micros() - this->last_step_micros < this->step_delay)
+    return false;
+
   bool in_field = isInField();
 
   switch (this->state)
   {
+  case APPROACH:
+    if (this->motor.getCurrentPosition() == this->approach_pos)
+    {
+      this->steps = 0;
+      this->state = FIND_MAGNET;
+      this->precise = true; // The field is close, no coarse search required
+    }
+    else
+    {
+      this->stepMotor(getShortestDirection(this->motor.getCurrentPosition(), this->approach_pos));
+    }
+    break;
+
   case FIND_MAGNET:
     if (in_field && this->steps <= MIN_STEPS_OUTSIDE_FIELD)
     {
       this->steps = MIN_STEPS_OUTSIDE_FIELD + 1;
       this->state = LEAVE_MAGNET;
     }
+    else if (in_field && !this->precise)
+    {
+      // Field found by the coarse search: back off and find the edge again slowly
+      this->precise = true;
+      this->steps = 2 * MIN_STEPS_OUTSIDE_FIELD;
+      this->state = LEAVE_MAGNET;
+    }
     else if (in_field && this->steps > MIN_STEPS_OUTSIDE_FIELD)
     {
       this->steps = 0;
@@ -55,7 +154,7 @@ bool Calibration::calibrate()
     }
     else
     {
-      this->motor.stepForward();
+      this->stepMotor(true);
       this->steps++;
     }
     break;
@@ -67,11 +166,11 @@ bool Calibration::calibrate()
     }
     else if (in_field)
     {
-      this->motor.stepBackward();
+      this->stepMotor(false);
     }
     else
     {
-      this->motor.stepBackward();
+      this->stepMotor(false);
       this->steps--;
     }
     break;
@@ -80,11 +179,12 @@ bool Calibration::calibrate()
     if (!in_field)
     {
       this->state = CENTERING;
+      this->field_width = this->steps;
       this->steps = this->steps / 2;
     }
     else
     {
-      this->motor.stepForward();
+      this->stepMotor(true);
       this->steps++;
     }
     break;
@@ -92,14 +192,13 @@ bool Calibration::calibrate()
   case CENTERING:
     if (this->steps == 0)
     {
-      this->state = CALIBRATED;
       this->motor.reset();
-      this->recal_ignore_next_field = true;
+      this->finishCalibration();
     }
     else
     {
       this->steps--;
-      this->motor.stepBackward();
+      this->stepMotor(false);
     }
     break;
 
@@ -110,6 +209,45 @@ bool Calibration::calibrate()
   return false;
 }
 
+/**
+ * @brief Executes a single calibration step and updates the step delay.
+ *
+ * While searching coarsely the delay is reduced by CALIBRATION_ACCELERATION with every step until the min step delay of the motor
+ * (tuned and derated by the speed governor) is reached. Lost steps do not matter in this phase, the position is unknown anyway,
+ * but a stalled motor would never reach the field.
+ *
+ * @param forward Step direction. True means forward.
+ */
+void Calibration::stepMotor(bool forward)
+{
+  if (forward)
+    this->motor.stepForward();
+  else
+    this->motor.stepBackward();
+
+  this->last_step_micros = micros();
+
+  unsigned long fast_step_delay = this->motor.getMinStepDelay();
+  if (this->precise)
+    this->step_delay = CALIBRATION_PRECISE_STEP_DELAY;
+  else if (this->step_delay > fast_step_delay + CALIBRATION_ACCELERATION)
+    this->step_delay -= CALIBRATION_ACCELERATION;
+  else
+    this->step_delay = fast_step_delay;
+}
+
+/**
+ * @brief Switches to CALIBRATED and prepares the recalibration.
+ *
+ * The hand is in the center of the field, so the first field that is left must be ignored.
+ */
+void Calibration::finishCalibration()
+{
+  this->field.reset(this->field_width, isInField(), this->motor.getCurrentPosition(), this->motor.isRotatingForwards());
+  this->edge_tail = this->edge_head;
+  this->state = CALIBRATED;
+}
+
 /**
  * @brief Checks if the hall sensor detects the magnet.
  *
@@ -118,70 +256,72 @@ bool Calibration::calibrate()
  */
 bool Calibration::isInField()
 {
-  return digitalRead(this->hall_pin) == LOW;
+  return !quickRead(this->hall_pin);
 }
 
 /**
- * @brief 100 % bug free
+ * @brief Captures a field edge with the exact motor position. Called by the pin change interrupt.
  *
- * This method is called on every tick in main loop.
- * It checks if the hand/motor interacts with the magnet field and saves the enter and leave position.
- * With those values the magnet field width is calculated and the motor position is recalibrated.
+ * The edge is queued and processed by checkForCalibrationAfterStep() in the main loop.
+ * Edges are only captured while the motor is calibrated. If the queue is full, the edge is dropped.
  */
-void Calibration::checkForCalibrationAfterStep()
+void Calibration::captureEdge()
 {
   bool in_field = isInField();
-  if (!this->recal_infield && in_field)
-  {
-    this->recal_infield = true;
-    this->recal_enter_pos = this->motor.getCurrentPosition();
-    this->recal_enter_direction = motor.isRotatingForwards(); // true = forwards, false = backwards
-  }
-  else if (this->recal_infield && !in_field)
-  {
-    this->recal_infield = false;
-
-    if (this->recal_enter_direction != motor.isRotatingForwards())
-    {
-      return; // The field was left on the same side. Do not recalibrate
-    }
-
-    if (this->recal_ignore_next_field)
-    {
-      this->recal_ignore_next_field = false;
-      return; // Ignore the first field after calibration. Do not recalibrate
-    }
+  if (in_field == this->edge_last_in_field)
+    return; // Interrupt of the other hall sensor
 
-    this->recal_leave_pos = this->motor.getCurrentPosition();
+  this->edge_last_in_field = in_field;
+  if (this->state != CALIBRATED)
+    return;
 
-    size_t field_width = diff(this->recal_enter_pos, this->recal_leave_pos, this->recal_enter_direction);
+  uint8_t next = (this->edge_head + 1) % FIELD_EDGE_QUEUE_SIZE;
+  if (next == this->edge_tail)
+    return;
 
-    // Serial.print("Field width: ");
-    // Serial.println(field_width);
-    // Serial.print(" Enter pos: ");
-    // Serial.println(this->recal_enter_pos);
-    // Serial.print(" Leave pos: ");
-    // Serial.println(this->recal_leave_pos);
-    // Serial.print(" Enter dir: ");
-    // Serial.println(this->recal_enter_direction);
-
-    if (field_width < MIN_WIDTH_FOR_RECALIBRATION)
-    {
-      return; // The tracked magnet field was smaller then the minimum magnet field width. Do not recalibrate
-    }
+  FieldEdge &edge = this->edges[this->edge_head];
+  edge.position = this->motor.getCurrentPosition();
+  edge.forward = this->motor.isRotatingForwards();
+  edge.in_field = in_field;
+  this->edge_head = next;
+}
 
-    size_t target_leave_pos = calculateFieldLeavePosition(field_width, this->recal_enter_direction);
-    bool correction_direction = getShortestDirection(this->motor.getCurrentPosition(), target_leave_pos);
-    size_t steps_off = diff(this->motor.getCurrentPosition(), target_leave_pos, correction_direction);
+/**
+ * @brief 100 % bug free
+ *
+ * This method is called on every tick in main loop.
+ * It processes the field edges captured by captureEdge() with the FieldTracker, which measures the magnet field width and center
+ * and compares them with the field model of the direction.
+ * Measurements with an unexpected width are rejected as outliers.
+ * Small center errors update the model, large errors mean lost steps and the motor position is recalibrated.
+ * Every center error is also reported to the speed governor of the motor, which slows the motor down after lost steps.
+ */
+void Calibration::checkForCalibrationAfterStep()
+{
+  while (this->edge_tail != this->edge_head)
+  {
+    FieldEdge edge = this->edges[this->edge_tail];
+    this->edge_tail = (this->edge_tail + 1) % FIELD_EDGE_QUEUE_SIZE;
+    this->processEdge(edge);
+  }
+}
 
-    if (steps_off < MIN_STEPS_OFF_FOR_RECALIBRATION)
-    {
-      return; // The motor is not far enough off target position. Do not recalibrate
-    }
+/**
+ * @brief Reports a field crossing measured by the FieldTracker to the speed governor and corrects lost steps.
+ */
+void Calibration::processEdge(const FieldEdge &edge)
+{
+  FieldCrossing crossing;
+  if (!this->field.processEdge(edge, crossing))
+    return;
 
-    steps_off /= 2; // Soft recalibration (slowly pull hand back to correct position)
+  this->motor.recordFieldCrossing(crossing.steps_off);
+  if (!crossing.lost_steps)
+    return; // The motor is not far enough off target position. Do not recalibrate
 
-    this->motor.recalibrate(target_leave_pos, steps_off, correction_direction);
-    this->recal_ignore_next_field = true;
-  }
-}
\ No newline at end of file
+  // Steps were lost: The position is off by the whole error
+  size_t current_pos = this->motor.getCurrentPosition();
+  size_t target_pos = crossing.correction_direction ? (current_pos + crossing.steps_off) % MAX_STEPS
+                                                    : (current_pos + MAX_STEPS - crossing.steps_off) % MAX_STEPS;
+  this->motor.recalibrate(target_pos, crossing.steps_off, crossing.correction_direction);
+}
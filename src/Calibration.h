@@ -3,9 +3,12 @@
 
 #include <Arduino.h>
 #include "Motor.h"
+#include "FieldTracker.h"
+#include "Config.h"
 
 enum CalibrationState
 {
+  APPROACH,
   LEAVE_MAGNET,
   FIND_MAGNET,
   INFIELD,
@@ -25,23 +28,38 @@ class Calibration
 public:
   Calibration(Motor &m, size_t hall_pin);
   void startCalibration();
+  bool startVerification(size_t position, size_t field_width);
   bool calibrate();
 
+  size_t getFieldWidth();
+
   void checkForCalibrationAfterStep();
+  void captureEdge();
 
   bool isInField();
 
 private:
+  void stepMotor(bool forward);
+  void finishCalibration();
+  void processEdge(const FieldEdge &edge);
+
   Motor &motor;
   size_t hall_pin;
   CalibrationState state;
   size_t steps;
+  size_t field_width;
+  size_t approach_pos;
+  bool precise;            // false = coarse search with acceleration
+  unsigned int step_delay; // us
+  unsigned long last_step_micros;
+
+  // Field edges captured by the pin change interrupt
+  FieldEdge edges[FIELD_EDGE_QUEUE_SIZE];
+  volatile uint8_t edge_head; // written by ISR
+  volatile uint8_t edge_tail; // written by main loop
+  bool edge_last_in_field;
 
-  bool recal_infield;
-  bool recal_ignore_next_field; // Ignore the first field after calibration
-  bool recal_enter_direction;
-  size_t recal_enter_pos;
-  size_t recal_leave_pos;
+  FieldTracker field; // Recalibration after the calibration
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "CalibrationStorage.h"
+#include <EEPROM.h>
+#include "Config.h"
+
+#define CALIBRATION_STORAGE_MAGIC 0xAD
+
+CalibrationStorage::CalibrationStorage()
+{
+  this->current_slot = EEPROM_CALIBRATION_SLOTS - 1;
+  this->sequence = 0;
+  this->parked = false;
+}
+
+/**
+ * @brief Loads the latest calibration from EEPROM.
+ *
+ * The calibration is written into a ring of EEPROM_CALIBRATION_SLOTS slots to spread the EEPROM wear.
+ * Every new slot gets the next sequence number, so the latest slot is the last one in an unbroken sequence.
+ *
+ * @param data Receives the stored positions and field widths.
+ * @return true The stored data is valid and the clock was parked (no motor moved since it was written).
+ * @return false There is no trustworthy data. The motors must be fully calibrated.
+ */
+bool CalibrationStorage::load(StoredCalibration &data)
+{
+  Slot slot;
+  Slot latest;
+  bool found = false;
+
+  for (uint8_t i = 0; i < EEPROM_CALIBRATION_SLOTS; i++)
+  {
+    if (!this->readSlot(i, slot))
+      continue;
+
+    if (!found || (uint8_t)(slot.sequence - latest.sequence) < 0x80)
+    {
+      latest = slot;
+      this->current_slot = i;
+      found = true;
+    }
+  }
+
+  if (!found)
+    return false;
+
+  this->sequence = latest.sequence;
+  this->parked = latest.parked == 1;
+  data = latest.data;
+  return this->parked;
+}
+
+/**
+ * @brief Writes the current positions into the next slot and marks the clock as parked.
+ *
+ * Writing a slot takes approximately 40 ms. Only call this when both motors are idle.
+ */
+void CalibrationStorage::park(const StoredCalibration &data)
+{
+  Slot slot;
+  slot.magic = CALIBRATION_STORAGE_MAGIC;
+  slot.sequence = this->sequence + 1;
+  slot.data = data;
+  slot.checksum = checksum(slot);
+  slot.parked = 1;
+
+  this->current_slot = (this->current_slot + 1) % EEPROM_CALIBRATION_SLOTS;
+  this->sequence = slot.sequence;
+  EEPROM.put(address(this->current_slot), slot);
+  this->parked = true;
+}
+
+/**
+ * @brief Clears the parked marker. Must be called before a motor moves.
+ *
+ * Only a single byte is written. The EEPROM finishes the write in approximately 3.3 ms by itself, the call only waits for a previous
+ * write that is still running (e.g. the end of park()).
+ */
+void CalibrationStorage::unpark()
+{
+  if (!this->parked)
+    return;
+
+  EEPROM.update(address(this->current_slot) + offsetof(Slot, parked), 0);
+  this->parked = false;
+}
+
+bool CalibrationStorage::isParked()
+{
+  return this->parked;
+}
+
+uint8_t CalibrationStorage::checksum(const Slot &slot)
+{
+  const uint8_t *bytes = (const uint8_t *)&slot;
+  uint8_t sum = 0;
+  for (size_t i = 0; i < offsetof(Slot, checksum); i++)
+  {
+    sum = (sum << 1 | sum >> 7) ^ bytes[i];
+  }
+  return sum;
+}
+
+int CalibrationStorage::address(uint8_t slot)
+{
+  static_assert(EEPROM_CALIBRATION_START + EEPROM_CALIBRATION_SLOTS * sizeof(Slot) <= EEPROM_TUNING_START, "Calibration slots overlap the motor tuning");
+  return EEPROM_CALIBRATION_START + slot * sizeof(Slot);
+}
+
+bool CalibrationStorage::readSlot(uint8_t index, Slot &slot)
+{
+  EEPROM.get(address(index), slot);
+  return slot.magic == CALIBRATION_STORAGE_MAGIC && slot.checksum == checksum(slot);
+}
@@ -0,0 +1,40 @@
+#ifndef _CALIBRATION_STORAGE_H_
+#define _CALIBRATION_STORAGE_H_
+
+#include <Arduino.h>
+
+struct StoredCalibration
+{
+  uint16_t position[2];    // Motor position when the clock was parked
+  uint16_t field_width[2]; // Measured width of the magnet field
+};
+
+class CalibrationStorage
+{
+public:
+  CalibrationStorage();
+  bool load(StoredCalibration &data);
+  void park(const StoredCalibration &data);
+  void unpark();
+  bool isParked();
+
+private:
+  struct Slot
+  {
+    uint8_t magic;
+    uint8_t sequence;
+    StoredCalibration data;
+    uint8_t checksum;
+    uint8_t parked; // Not part of the checksum, cleared as soon as the motors move
+  };
+
+  static uint8_t checksum(const Slot &slot);
+  static int address(uint8_t slot);
+  bool readSlot(uint8_t index, Slot &slot);
+
+  uint8_t current_slot;
+  uint8_t sequence;
+  bool parked;
+};
+
+#endif
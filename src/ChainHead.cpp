@@ -0,0 +1,237 @@
+#include "ChainHead.h"
+#include <FastGPIO.h>
+#include "Instruction.h"
+
+ChainHead::ChainHead()
+{
+  this->frame_ready[0] = false;
+  this->frame_ready[1] = false;
+  this->receive_index = 0;
+  this->send_index = 0;
+  this->received_bytes = 0;
+  this->synced = false;
+  this->length_received = false;
+  this->last_frame_micros = 0;
+  this->clock_out_high = CLOCK_OUT_HIGH;
+  this->tick_period = CHAIN_HEAD_TICK_PERIOD;
+  this->frame_gap = DELAY_BETWEEN_INSTRUCTIONS + CHAIN_HEAD_GAP_MARGIN;
+  this->timing_bytes = 0;
+#ifdef CHAIN_HEAD_RETURN
+  this->returned_length = 0;
+  this->last_return_micros = 0;
+  this->return_latency = 0;
+  this->frame_start_micros = 0;
+#endif
+}
+
+void ChainHead::begin()
+{
+  pinMode(CHAIN_HEAD_OUT_DATA1, OUTPUT);
+  pinMode(CHAIN_HEAD_OUT_DATA2, OUTPUT);
+  pinMode(CHAIN_HEAD_OUT_DATA3, OUTPUT);
+  pinMode(CHAIN_HEAD_OUT_DATA4, OUTPUT);
+  pinMode(CHAIN_HEAD_OUT_CLOCK, OUTPUT);
+  FastGPIO::Pin<CHAIN_HEAD_OUT_CLOCK>::setOutputLow();
+
+#ifdef CHAIN_HEAD_RETURN
+  pinMode(CHAIN_HEAD_IN_DATA1, INPUT);
+  pinMode(CHAIN_HEAD_IN_DATA2, INPUT);
+  pinMode(CHAIN_HEAD_IN_DATA3, INPUT);
+  pinMode(CHAIN_HEAD_IN_DATA4, INPUT);
+#endif
+
+  Serial.begin(CHAIN_HEAD_BAUD_RATE);
+
+  // Both buffers are free
+  Serial.write(CHAIN_HEAD_ACK);
+  Serial.write(CHAIN_HEAD_ACK);
+}
+
+/**
+ * @brief Receives frames and sends them as soon as the gap to the previous frame is long enough.
+ *
+ * Must be called in a tight loop.
+ */
+void ChainHead::tick()
+{
+  this->receive();
+#ifdef CHAIN_HEAD_RETURN
+  this->sendReturnedFrame();
+#endif
+
+  if (!this->frame_ready[this->send_index])
+    return;
+
+  // Every clock must detect the end of the previous frame
+  if (micros() - this->last_frame_micros < this->frame_gap)
+    return;
+
+  this->sendFrame(this->frames[this->send_index], this->frame_length[this->send_index]);
+  this->last_frame_micros = micros();
+
+  this->frame_ready[this->send_index] = false;
+  this->send_index ^= 1;
+  Serial.write(CHAIN_HEAD_ACK); // The host may send the next frame
+}
+
+/**
+ * @brief Reads the available bytes from serial into the free frame buffer.
+ *
+ * Every frame starts with CHAIN_HEAD_SYNC, followed by the number of instructions and the packed instructions (two per byte).
+ * Frames may be shorter than CHAIN_LENGTH: The host leaves out the clocks after the last one that has to move.
+ * Bytes before a sync byte are dropped, so the host and the chain head resynchronize after a transmission error.
+ * A CHAIN_HEAD_TIMING message between two frames sets the timing of the following frames.
+ */
+void ChainHead::receive()
+{
+  while (!this->frame_ready[this->receive_index] && Serial.available() > 0)
+  {
+    uint8_t data = Serial.read();
+
+    if (this->timing_bytes > 0 || (!this->synced && data == CHAIN_HEAD_TIMING))
+    {
+      this->receiveTiming(data);
+      continue;
+    }
+
+    if (!this->synced)
+    {
+      this->synced = data == CHAIN_HEAD_SYNC;
+      continue;
+    }
+
+    if (!this->length_received)
+    {
+      if (data == 0 || data > CHAIN_LENGTH)
+      {
+        this->synced = false; // Invalid length, wait for the next frame
+        continue;
+      }
+      this->frame_length[this->receive_index] = data;
+      this->length_received = true;
+      continue;
+    }
+
+    this->frames[this->receive_index][this->received_bytes++] = data;
+    if (this->received_bytes == (this->frame_length[this->receive_index] + 1) / 2)
+    {
+      this->frame_ready[this->receive_index] = true;
+      this->receive_index ^= 1;
+      this->received_bytes = 0;
+      this->synced = false;
+      this->length_received = false;
+    }
+  }
+}
+
+void ChainHead::receiveTiming(uint8_t data)
+{
+  if (this->timing_bytes > 0)
+    this->timing_message[this->timing_bytes - 1] = data;
+  this->timing_bytes++;
+  if (this->timing_bytes < 5)
+    return;
+
+  this->timing_bytes = 0;
+  unsigned int frame_gap = this->timing_message[2] << 8 | this->timing_message[3];
+  if (this->timing_message[0] == 0 || this->timing_message[1] <= this->timing_message[0] || frame_gap < TIMING_MIN_FRAME_GAP)
+    return; // Invalid timing, the chain head would not be reachable any more
+  this->clock_out_high = this->timing_message[0];
+  this->tick_period = this->timing_message[1];
+  this->frame_gap = frame_gap;
+}
+
+/**
+ * @brief Clocks out all instructions of a frame. The first instruction is for the first clock.
+ *
+ * Takes approximately length * tick period microseconds.
+ */
+void ChainHead::sendFrame(const uint8_t *frame, uint8_t length)
+{
+#ifdef CHAIN_HEAD_RETURN
+  this->frame_start_micros = micros();
+#endif
+  for (uint8_t i = 0; i < length; i++)
+  {
+    unsigned long tick_micros = micros();
+    uint8_t data = frame[i / 2];
+    this->sendInstruction(i % 2 == 0 ? data >> 4 : data & 0x0F);
+
+    // Every clock in the chain must finish forwarding the previous instruction
+    while (micros() - tick_micros < this->tick_period)
+      ;
+  }
+}
+
+/**
+ * @brief Sends a single instruction packed by encodeInstruction().
+ */
+void ChainHead::sendInstruction(uint8_t instruction)
+{
+  Instruction data = decodeInstruction(instruction);
+  FastGPIO::Pin<CHAIN_HEAD_OUT_DATA1>::setOutputValue(data.hourBackward);
+  FastGPIO::Pin<CHAIN_HEAD_OUT_DATA2>::setOutputValue(data.hourForward);
+  FastGPIO::Pin<CHAIN_HEAD_OUT_DATA3>::setOutputValue(data.minuteBackward);
+  FastGPIO::Pin<CHAIN_HEAD_OUT_DATA4>::setOutputValue(data.minuteForward);
+  FastGPIO::Pin<CHAIN_HEAD_OUT_CLOCK>::setOutputHigh();
+  delayMicroseconds(this->clock_out_high);
+  FastGPIO::Pin<CHAIN_HEAD_OUT_CLOCK>::setOutputLow();
+}
+
+#ifdef CHAIN_HEAD_RETURN
+/**
+ * @brief Collects an instruction passed on by the last clock. Called by the interrupt of CHAIN_HEAD_IN_CLOCK.
+ *
+ * Instructions beyond CHAIN_LENGTH are dropped.
+ */
+void ChainHead::processReturnInput()
+{
+  uint8_t length = this->returned_length;
+  if (length == 0)
+    this->return_latency = micros() - this->frame_start_micros; // still within the sent frame, the chain is shorter than the frame
+  if (length < CHAIN_LENGTH)
+  {
+    uint8_t instruction = FastGPIO::Pin<CHAIN_HEAD_IN_DATA1>::isInputHigh() << 3 | FastGPIO::Pin<CHAIN_HEAD_IN_DATA2>::isInputHigh() << 2 |
+                          FastGPIO::Pin<CHAIN_HEAD_IN_DATA3>::isInputHigh() << 1 | FastGPIO::Pin<CHAIN_HEAD_IN_DATA4>::isInputHigh();
+    if (length % 2 == 0)
+      this->returned[length / 2] = instruction << 4;
+    else
+      this->returned[length / 2] |= instruction;
+    this->returned_length = length + 1;
+  }
+  this->last_return_micros = micros();
+}
+
+/**
+ * @brief Sends the returned frame to the host, once no instruction was returned for half the frame gap.
+ *
+ * The host tells the returned frames from the acknowledges by CHAIN_HEAD_SYNC. A CHAIN_HEAD_LATENCY message precedes every frame:
+ * the time from the first tick of the last sent frame until the first instruction returned, the propagation through the whole chain.
+ */
+void ChainHead::sendReturnedFrame()
+{
+  uint8_t frame[FRAME_BYTES];
+  uint8_t length;
+  noInterrupts();
+  length = this->returned_length;
+  if (length == 0 || micros() - this->last_return_micros <= this->frame_gap / 2)
+  {
+    interrupts();
+    return;
+  }
+  for (uint8_t i = 0; i < (length + 1) / 2; i++)
+    frame[i] = this->returned[i];
+  this->returned_length = 0;
+  unsigned long latency = this->return_latency;
+  interrupts();
+
+  if (latency > 0xFFFF)
+    latency = 0xFFFF;
+  Serial.write(CHAIN_HEAD_LATENCY);
+  Serial.write(latency >> 8);
+  Serial.write(latency & 0xFF);
+  Serial.write(CHAIN_HEAD_SYNC);
+  Serial.write(length);
+  Serial.write(frame, (length + 1) / 2);
+}
+#endif
@@ -0,0 +1,63 @@
+#ifndef _CHAIN_HEAD_H_
+#define _CHAIN_HEAD_H_
+
+#include <Arduino.h>
+#include "Config.h"
+
+#define FRAME_BYTES ((CHAIN_LENGTH + 1) / 2) // two instructions per byte
+
+/**
+ * @brief Firmware mode for an Arduino at the head of the chain.
+ *
+ * Receives frames from the host over USB serial and clocks them out to the first clock.
+ * A frame contains one instruction (nibble) for every clock of the chain.
+ * With CHAIN_HEAD_RETURN the instructions passed on by the last clock are received as well and sent to the host after the gap,
+ * in the same format as the host sends frames. Telemetry frames return the status of the clocks this way.
+ * The host tunes the timing of the chain head with a CHAIN_HEAD_TIMING message, see ChainTuner.
+ */
+class ChainHead
+{
+public:
+  ChainHead();
+  void begin();
+  void tick();
+#ifdef CHAIN_HEAD_RETURN
+  void processReturnInput();
+#endif
+
+private:
+  void receive();
+  void receiveTiming(uint8_t data);
+  void sendFrame(const uint8_t *frame, uint8_t length);
+  void sendInstruction(uint8_t instruction);
+
+  uint8_t frames[2][FRAME_BYTES]; // double buffer: one is received while the other one is sent
+  uint8_t frame_length[2];        // instructions in the frame, the following clocks keep still
+  bool frame_ready[2];
+  uint8_t receive_index;
+  uint8_t send_index;
+  uint8_t received_bytes; // of the current frame, without the sync and length byte
+  bool synced;            // sync byte received
+  bool length_received;   // length byte received
+
+  unsigned long last_frame_micros;
+
+  // Timing, CLOCK_OUT_HIGH, CHAIN_HEAD_TICK_PERIOD and DELAY_BETWEEN_INSTRUCTIONS + CHAIN_HEAD_GAP_MARGIN until the host sets it
+  uint8_t clock_out_high;      // us
+  uint8_t tick_period;         // us
+  unsigned int frame_gap;      // us
+  uint8_t timing_message[4];   // CHAIN_HEAD_TIMING message without the first byte
+  uint8_t timing_bytes;        // received bytes of the timing message, 0 = no timing message
+
+#ifdef CHAIN_HEAD_RETURN
+  void sendReturnedFrame();
+
+  volatile uint8_t returned[FRAME_BYTES]; // instructions of the last clock, written by processReturnInput()
+  volatile uint8_t returned_length;
+  volatile unsigned long last_return_micros;
+  volatile unsigned long return_latency;     // us from the first tick of the frame until its first instruction returned
+  volatile unsigned long frame_start_micros; // first tick of the last sent frame
+#endif
+};
+
+#endif
@@ -1,10 +1,25 @@
 #include "ClockCommunication.h"
 #include <FastGPIO.h>
 #include "Config.h"
+#include "Metrics.h"
 #include <Arduino.h>
+#include <util/atomic.h>
 
 ClockCommunication::ClockCommunication(OwnInstruction &own) : own(own)
 {
+  this->pass_on_instructions = false;
+  this->last_frame_millis = 0;
+  this->frame_type = FRAME_TYPE_STEPS;
+  this->index = ADDRESS_BROADCAST;
+  this->setTelemetry(0, 0, 0, 0);
+  this->telemetry.dropped_instructions = 0;
+  this->clock_out_high = CLOCK_OUT_HIGH;
+  this->frame_gap = DELAY_BETWEEN_INSTRUCTIONS;
+  this->next_clock_out_high = CLOCK_OUT_HIGH;
+  this->next_frame_gap = DELAY_BETWEEN_INSTRUCTIONS;
+  this->timing_changed = false;
+  this->timing_trial = false;
+
   pinMode(COMM_OUT_DATA1, OUTPUT);
   pinMode(COMM_OUT_DATA2, OUTPUT);
   pinMode(COMM_OUT_DATA3, OUTPUT);
@@ -27,10 +42,15 @@ ClockCommunication::ClockCommunication(OwnInstruction &own) : own(own)
  * Task 2:
  * Reset the pass_on_instructions variable after no new instruction for a long time, so the next instruction is interpreted as own instruction.
  *
- * All timings are configured inside the Config.h file.
+ * Task 3:
+ * Revert a timing on trial that was not kept within TIMING_TRIAL_PERIOD.
+ *
+ * The default timings are configured inside the Config.h file.
  */
 void ClockCommunication::tick()
 {
+  this->checkTimingTrial();
+
   if (!this->pass_on_instructions)
   {
     // if no messages are forwarded, there is nothing to do for this procedure
@@ -46,7 +66,7 @@ void ClockCommunication::tick()
     // Overflow or isr has interrupted and updated last_instruction_read_micros
     current_last_instruction_read_micros = current_micros;
   }
-  else if (current_micros - current_last_instruction_read_micros > DELAY_BETWEEN_INSTRUCTIONS)
+  else if (current_micros - current_last_instruction_read_micros > this->frame_gap)
   {
     // No new instruction for a long time
     this->pass_on_instructions = false;
@@ -56,33 +76,297 @@ void ClockCommunication::tick()
 /**
  * @brief Reads the instruction from the data pins and stores it as own instruction or passes it on to the next clock.
  *
+ * The first instruction of a frame is the own instruction, unless it marks an addressed or enumeration frame (see startFrame()).
+ *
  * This function takes approximately 9 microseconds to execute.
  * ~ 2 us for reading the data pins
  * ~ 3 us for reading micros()
- * ~ 4 us (CLOCK_OUT_HIGH) if sending the instruction to the next clock
+ * ~ 4 us (CLOCK_OUT_HIGH, see setTiming()) if sending the instruction to the next clock
  */
 void ClockCommunication::processDataInput()
 {
-  if (this->pass_on_instructions)
+  unsigned long current_micros = micros();
+  if (this->pass_on_instructions && current_micros - this->last_instruction_read_micros > this->frame_gap)
+  {
+    // A new frame started, but tick() was not called in time (e.g. the main loop was busy calibrating)
+    this->pass_on_instructions = false;
+  }
+
+  if (!this->pass_on_instructions)
+  {
+    this->startFrame();
+    this->pass_on_instructions = true; // Next instructions should be pass on to next clock
+  }
+  else if (this->frame_type == FRAME_TYPE_STEPS)
   {
     this->passOnInstruction();
   }
   else
   {
-    this->updateOwnInstruction();
-    this->pass_on_instructions = true; // Next instructions should be pass on to next clock
+    this->processFrameInstruction();
   }
 
-  this->last_instruction_read_micros = micros();
+  this->last_instruction_read_micros = current_micros;
 }
 
-void ClockCommunication::updateOwnInstruction()
+/**
+ * @brief Returns the position of the clock in the chain, ADDRESS_BROADCAST until an enumeration frame was received.
+ */
+uint8_t ClockCommunication::getIndex() const
 {
-  this->own.data.hourBackward = FastGPIO::Pin<COMM_IN_DATA1>::isInputHigh();
-  this->own.data.hourForward = FastGPIO::Pin<COMM_IN_DATA2>::isInputHigh();
-  this->own.data.minuteBackward = FastGPIO::Pin<COMM_IN_DATA3>::isInputHigh();
-  this->own.data.minuteForward = FastGPIO::Pin<COMM_IN_DATA4>::isInputHigh();
-  this->own.pending = true;
+  return this->index;
+}
+
+/**
+ * @brief Processes the first instruction of a frame.
+ *
+ * FRAME_ADDRESSED, FRAME_ENUMERATION and FRAME_TELEMETRY are passed on, so every clock of the chain sees the marker
+ * and all following instructions. While a command is received, the markers are arguments of the command and taken as own instruction.
+ * The command state is tracked here for every own instruction, also if the main loop is busy and drops instructions.
+ */
+void ClockCommunication::startFrame()
+{
+  uint8_t instruction = this->readInstruction();
+  this->last_frame_millis = millis();
+  if (this->timing_changed)
+  {
+    // The previous frame was passed on completely with the old timing
+    this->clock_out_high = this->next_clock_out_high;
+    this->frame_gap = this->next_frame_gap;
+    this->timing_changed = false;
+  }
+  this->frame_position = 0;
+  this->frame_type = FRAME_TYPE_STEPS;
+  if (!this->commands.isReceiving())
+  {
+    if (instruction == FRAME_ADDRESSED)
+      this->frame_type = FRAME_TYPE_ADDRESSED;
+    else if (instruction == FRAME_ENUMERATION)
+      this->frame_type = FRAME_TYPE_ENUMERATION;
+    else if (instruction == FRAME_TELEMETRY)
+      this->frame_type = FRAME_TYPE_TELEMETRY;
+  }
+
+  if (this->frame_type == FRAME_TYPE_STEPS)
+  {
+    this->updateOwnInstruction(instruction);
+  }
+  else
+  {
+    this->sendInstruction(instruction);
+  }
+}
+
+/**
+ * @brief Processes an instruction of a marked frame after its marker and passes it on.
+ *
+ * Enumeration: the counter is the index of the clock. It is incremented while passing it on, the lower nibble first for the carry.
+ * The clock behind the last one (the host, if it reads back the chain) receives the number of clocks.
+ *
+ * Addressed: the instruction of every (index, instruction) triple with the own index or ADDRESS_BROADCAST is the own instruction.
+ * It is also passed on, all clocks behind see the same frame.
+ *
+ * Telemetry: the index of the first polled clock is followed by a record of TELEMETRY_NIBBLES for every polled clock.
+ * The clock replaces the nibbles of its record by its status, all other nibbles are passed on unchanged.
+ */
+void ClockCommunication::processFrameInstruction()
+{
+  uint8_t instruction = this->readInstruction();
+  this->frame_position++;
+  if (this->frame_type == FRAME_TYPE_ENUMERATION)
+  {
+    if (this->frame_position == 1)
+    {
+      this->counter = instruction;
+      instruction = (instruction + 1) & 0x0F;
+    }
+    else if (this->frame_position == 2)
+    {
+      this->index = instruction << 4 | this->counter;
+      if (this->counter == 0x0F)
+        instruction = (instruction + 1) & 0x0F; // carry
+    }
+  }
+  else if (this->frame_position <= 2)
+  {
+    // Index of the addressed or first polled clock
+    this->address = this->frame_position == 1 ? instruction << 4 : this->address | instruction;
+    this->record = this->address;
+    this->record_nibble = 0;
+  }
+  else if (this->frame_type == FRAME_TYPE_ADDRESSED)
+  {
+    uint8_t field = (this->frame_position - 1) % 3;
+    if (field == 0)
+    {
+      this->address = instruction << 4;
+    }
+    else if (field == 1)
+    {
+      this->address |= instruction;
+    }
+    else if (this->address == this->index || this->address == ADDRESS_BROADCAST)
+    {
+      this->updateOwnInstruction(instruction);
+    }
+  }
+  else
+  {
+    if (this->record == this->index && this->index != ADDRESS_BROADCAST)
+    {
+      instruction = getTelemetryNibble(this->telemetry, this->record_nibble);
+    }
+    if (++this->record_nibble == TELEMETRY_NIBBLES)
+    {
+      this->record_nibble = 0;
+      this->record++;
+    }
+  }
+  this->sendInstruction(instruction);
+}
+
+/**
+ * @brief Time since the last frame started, the bus is idle meanwhile. Called by the main loop.
+ */
+unsigned long ClockCommunication::getMillisSinceFrame()
+{
+  unsigned long last_frame_millis;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    last_frame_millis = this->last_frame_millis;
+  }
+  return millis() - last_frame_millis;
+}
+
+/**
+ * @brief Shortest frame gap of the current and the next timing, tick() has to be called more often to detect the end of a frame.
+ */
+unsigned int ClockCommunication::getFrameGap()
+{
+  unsigned int frame_gap;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    frame_gap = this->frame_gap < this->next_frame_gap ? this->frame_gap : this->next_frame_gap;
+  }
+  return frame_gap;
+}
+
+/**
+ * @brief Sets the bus timing on trial, received by COMMAND_TIMING. It is used from the start of the next frame.
+ *
+ * The timing is reverted after TIMING_TRIAL_PERIOD unless keepTiming() is called: if the timing is too fast for the wall,
+ * the command to revert it would not reach the clocks behind.
+ */
+void ClockCommunication::setTiming(uint8_t clock_out_high, unsigned int frame_gap)
+{
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    if (!this->timing_trial)
+    {
+      this->kept_clock_out_high = this->next_clock_out_high;
+      this->kept_frame_gap = this->next_frame_gap;
+    }
+    this->next_clock_out_high = clock_out_high;
+    this->next_frame_gap = frame_gap;
+    this->timing_changed = true;
+  }
+  this->timing_trial = true;
+  this->trial_start_millis = millis();
+}
+
+/**
+ * @brief Keeps the timing on trial, received by COMMAND_TIMING_KEEP over the new timing. The timing is lost by a restart.
+ */
+void ClockCommunication::keepTiming()
+{
+  this->timing_trial = false;
+}
+
+void ClockCommunication::checkTimingTrial()
+{
+  if (!this->timing_trial || millis() - this->trial_start_millis < TIMING_TRIAL_PERIOD)
+  {
+    return;
+  }
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    this->next_clock_out_high = this->kept_clock_out_high;
+    this->next_frame_gap = this->kept_frame_gap;
+    this->timing_changed = true;
+  }
+  this->timing_trial = false;
+}
+
+/**
+ * @brief Updates the status reported in telemetry frames. Called by the main loop, the ISR reads it.
+ */
+void ClockCommunication::setTelemetry(uint16_t hour_position, uint16_t minute_position, uint8_t hour_recalibrations,
+                                      uint8_t minute_recalibrations)
+{
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    this->telemetry.positions[0] = hour_position;
+    this->telemetry.positions[1] = minute_position;
+    this->telemetry.recalibrations[0] = toTelemetryRecalibrations(hour_recalibrations);
+    this->telemetry.recalibrations[1] = toTelemetryRecalibrations(minute_recalibrations);
+  }
+}
+
+/**
+ * @brief Hands the own instruction to the main loop: a step instruction at once, a command when it is complete.
+ *
+ * A busy main loop only loses step instructions, the commands are parsed here and never shift their arguments.
+ */
+void ClockCommunication::updateOwnInstruction(uint8_t instruction)
+{
+  if (this->commands.receive(instruction))
+  {
+    if (this->commands.isComplete())
+    {
+      if (this->own.command_pending)
+      {
+        this->telemetry.dropped_instructions++; // the main loop did not execute the previous command yet
+      }
+      this->own.command = this->commands.getCommand();
+      this->own.command_pending = true;
+    }
+  }
+  else
+  {
+    if (this->own.pending)
+    {
+      this->telemetry.dropped_instructions++; // the main loop did not process the previous instruction yet
+    }
+    this->own.data = decodeInstruction(instruction);
+    this->own.pending = true;
+  }
+#ifdef ENABLE_METRICS
+  metrics.instructions_received++;
+#endif
+}
+
+uint8_t ClockCommunication::readInstruction()
+{
+  return FastGPIO::Pin<COMM_IN_DATA1>::isInputHigh() << 3 | FastGPIO::Pin<COMM_IN_DATA2>::isInputHigh() << 2 |
+         FastGPIO::Pin<COMM_IN_DATA3>::isInputHigh() << 1 | FastGPIO::Pin<COMM_IN_DATA4>::isInputHigh();
+}
+
+/**
+ * @brief Sends a (possibly rewritten) instruction of a marked frame to the next clock.
+ */
+void ClockCommunication::sendInstruction(uint8_t instruction)
+{
+  FastGPIO::Pin<COMM_OUT_DATA1>::setOutputValue(instruction & 0x08);
+  FastGPIO::Pin<COMM_OUT_DATA2>::setOutputValue(instruction & 0x04);
+  FastGPIO::Pin<COMM_OUT_DATA3>::setOutputValue(instruction & 0x02);
+  FastGPIO::Pin<COMM_OUT_DATA4>::setOutputValue(instruction & 0x01);
+  FastGPIO::Pin<COMM_OUT_CLOCK>::setOutputHigh();
+  delayMicroseconds(this->clock_out_high);
+  FastGPIO::Pin<COMM_OUT_CLOCK>::setOutputLow();
+#ifdef ENABLE_METRICS
+  metrics.instructions_forwarded++;
+#endif
 }
 
 void ClockCommunication::passOnInstruction()
@@ -92,18 +376,28 @@ void ClockCommunication::passOnInstruction()
   FastGPIO::Pin<COMM_OUT_DATA3>::setOutputValue(FastGPIO::Pin<COMM_IN_DATA3>::isInputHigh());
   FastGPIO::Pin<COMM_OUT_DATA4>::setOutputValue(FastGPIO::Pin<COMM_IN_DATA4>::isInputHigh());
   FastGPIO::Pin<COMM_OUT_CLOCK>::setOutputHigh();
-  delayMicroseconds(CLOCK_OUT_HIGH);
+  delayMicroseconds(this->clock_out_high);
   FastGPIO::Pin<COMM_OUT_CLOCK>::setOutputLow();
+#ifdef ENABLE_METRICS
+  metrics.instructions_forwarded++;
+#endif
 }
 
+/**
+ * @brief Sends a single instruction to the next clock.
+ *
+ * The output clock is pulled high for CLOCK_OUT_HIGH (see setTiming()) and low again.
+ * The caller is responsible for the timing between two instructions.
+ */
 void ClockCommunication::sendTestInstruction(Instruction &instruction)
 {
   this->pass_on_instructions = true;
+  this->frame_type = FRAME_TYPE_STEPS;
   FastGPIO::Pin<COMM_OUT_DATA1>::setOutputValue(instruction.hourBackward);
   FastGPIO::Pin<COMM_OUT_DATA2>::setOutputValue(instruction.hourForward);
   FastGPIO::Pin<COMM_OUT_DATA3>::setOutputValue(instruction.minuteBackward);
   FastGPIO::Pin<COMM_OUT_DATA4>::setOutputValue(instruction.minuteForward);
   FastGPIO::Pin<COMM_OUT_CLOCK>::setOutputHigh();
-  this->clock_out_high = true;
-  this->last_instruction_send_micros = micros();
+  delayMicroseconds(this->clock_out_high);
+  FastGPIO::Pin<COMM_OUT_CLOCK>::setOutputLow();
 }
\ No newline at end of file
@@ -1,6 +1,15 @@
 #ifndef _CLOCK_COMMUNICATION_H_
 #define _CLOCK_COMMUNICATION_H_
 #include "Instruction.h"
+#include "Telemetry.h"
+
+enum FrameType
+{
+  FRAME_TYPE_STEPS,       // the first instruction is the own instruction, all others are passed on
+  FRAME_TYPE_ADDRESSED,   // FRAME_ADDRESSED
+  FRAME_TYPE_ENUMERATION, // FRAME_ENUMERATION
+  FRAME_TYPE_TELEMETRY    // FRAME_TELEMETRY
+};
 
 class ClockCommunication
 {
@@ -12,16 +21,46 @@ public:
 
   void processDataInput();
   void sendTestInstruction(Instruction &instruction);
+  uint8_t getIndex() const;
+  unsigned long getMillisSinceFrame();
+  unsigned int getFrameGap();
+  void setTiming(uint8_t clock_out_high, unsigned int frame_gap);
+  void keepTiming();
+  void setTelemetry(uint16_t hour_position, uint16_t minute_position, uint8_t hour_recalibrations, uint8_t minute_recalibrations);
 
 private:
-  void updateOwnInstruction();
+  void checkTimingTrial();
+  void startFrame();
+  void processFrameInstruction();
+  void updateOwnInstruction(uint8_t instruction);
   void passOnInstruction();
+  uint8_t readInstruction();
+  void sendInstruction(uint8_t instruction);
 
   OwnInstruction &own;
   bool pass_on_instructions;
-  bool clock_out_high;
   unsigned long last_instruction_read_micros;
-  unsigned long last_instruction_send_micros;
+  volatile unsigned long last_frame_millis; // start of the last received frame
+  FrameType frame_type;
+  uint8_t frame_position; // instructions of the marked frame after its marker
+  uint8_t address;        // index of the addressed instruction or of the first polled clock
+  uint8_t record;         // telemetry: index of the clock the current record is reserved for
+  uint8_t record_nibble;  // telemetry: nibble within the current record
+  uint8_t counter;        // lower nibble of the enumeration counter
+  uint8_t index;          // position in the chain, learned from the enumeration frame. ADDRESS_BROADCAST before
+  Telemetry telemetry;
+  CommandParser commands; // the only parser of the own instructions, the main loop may process them much later
+
+  // Bus timing, see COMMAND_TIMING. The ISR switches to the next timing at the start of a frame
+  uint8_t clock_out_high;      // us, CLOCK_OUT_HIGH
+  unsigned int frame_gap;      // us, DELAY_BETWEEN_INSTRUCTIONS
+  uint8_t next_clock_out_high;
+  unsigned int next_frame_gap;
+  bool timing_changed;
+  uint8_t kept_clock_out_high; // timing before the trial
+  unsigned int kept_frame_gap;
+  unsigned long trial_start_millis;
+  bool timing_trial;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "CommandParser.h"
+
+/**
+ * @brief Number of argument nibbles of a command.
+ *
+ * @return uint8_t COMMAND_UNKNOWN for an unknown command code.
+ */
+uint8_t getCommandLength(uint8_t code)
+{
+  switch (code)
+  {
+  case COMMAND_VELOCITY:
+    return 4;
+  case COMMAND_MACRO_STORE:
+    return 14;
+  case COMMAND_MACRO_PLAY:
+    return 1;
+  case COMMAND_TIMING:
+    return 6;
+  case COMMAND_TIMING_KEEP:
+    return 0;
+  default:
+    return COMMAND_UNKNOWN;
+  }
+}
+
+/**
+ * @brief Combines two argument nibbles to a signed byte, the upper nibble first.
+ *
+ * ```cpp
+ * // arguments: 0xF, 0xE
+ * getCommandByte(command, 0); // returns: -2
+ * ```
+ *
+ * @param index Byte index, the nibbles 2 * index and 2 * index + 1.
+ */
+int8_t getCommandByte(const Command &command, size_t index)
+{
+  return (int8_t)((command.arguments[2 * index] << 4) | command.arguments[2 * index + 1]);
+}
+
+/**
+ * @brief Combines two bytes (four argument nibbles) to a signed 16 bit value, the upper byte first.
+ *
+ * @param index Byte index of the upper byte, see getCommandByte().
+ */
+int16_t getCommandWord(const Command &command, size_t index)
+{
+  return (int16_t)(((uint8_t)getCommandByte(command, index) << 8) | (uint8_t)getCommandByte(command, index + 1));
+}
+
+CommandParser::CommandParser()
+{
+  this->reset();
+}
+
+/**
+ * @brief Drops a partly received command.
+ */
+void CommandParser::reset()
+{
+  this->received = 0;
+  this->length = 0;
+  this->complete = false;
+}
+
+/**
+ * @brief Processes the next own instruction.
+ *
+ * @return true if the instruction is part of a command and must not be executed as step instruction. See isComplete().
+ */
+bool CommandParser::receive(uint8_t instruction)
+{
+  this->complete = false;
+  if (this->received == 0)
+  {
+    if (instruction != COMMAND_ESCAPE)
+      return false;
+    this->received = 1;
+    return true;
+  }
+
+  if (this->received == 1)
+  {
+    this->command.code = instruction;
+    this->length = getCommandLength(instruction);
+    if (this->length == COMMAND_UNKNOWN)
+    {
+      this->reset();
+      return true;
+    }
+  }
+  else
+  {
+    this->command.arguments[this->received - 2] = instruction;
+  }
+
+  this->received++;
+  if (this->received == this->length + 2)
+  {
+    this->received = 0;
+    this->complete = true;
+  }
+  return true;
+}
+
+/**
+ * @brief Checks if the last received instruction completed a command.
+ */
+bool CommandParser::isComplete() const
+{
+  return this->complete;
+}
+
+/**
+ * @brief Checks if a command is partly received, its next instruction is an argument.
+ */
+bool CommandParser::isReceiving() const
+{
+  return this->received > 0;
+}
+
+const Command &CommandParser::getCommand() const
+{
+  return this->command;
+}
@@ -0,0 +1,50 @@
+#ifndef _COMMAND_PARSER_H_
+#define _COMMAND_PARSER_H_
+
+#include <stddef.h> // no Arduino.h, the digital twin compiles this file natively
+#include <stdint.h>
+#include "Config.h"
+
+#define COMMAND_UNKNOWN 0xFF // getCommandLength() of an unknown command code
+
+/**
+ * @brief A command with its arguments, received over several frames.
+ */
+struct Command
+{
+  uint8_t code;
+  uint8_t arguments[COMMAND_MAX_ARGUMENTS]; // nibbles
+};
+
+uint8_t getCommandLength(uint8_t code);
+
+int8_t getCommandByte(const Command &command, size_t index);
+
+int16_t getCommandWord(const Command &command, size_t index);
+
+/**
+ * @brief Collects the own instructions that form a command.
+ *
+ * A clock only receives four bits per frame, which are all used by the step instructions. Commands are escaped:
+ * the own instruction COMMAND_ESCAPE (a calibration with a moving hand, never sent for a calibration) is followed by the command code
+ * and its arguments in the next own instructions. Meanwhile the hands do not receive step instructions.
+ * An unknown command code ends the command, the following instructions are step instructions again.
+ */
+class CommandParser
+{
+public:
+  CommandParser();
+  void reset();
+  bool receive(uint8_t instruction);
+  bool isComplete() const;
+  bool isReceiving() const;
+  const Command &getCommand() const;
+
+private:
+  Command command;
+  uint8_t received; // instructions of the current command, 0 = no command
+  uint8_t length;   // arguments of the current command
+  bool complete;
+};
+
+#endif
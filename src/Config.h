@@ -3,28 +3,140 @@
 
 // #define COIL_MODE_SINGLE
 
+// PWM microstepping: sine and cosine currents instead of switching the coils on and off, positions are counted in microsteps
+// #define COIL_MODE_MICROSTEP
+
+// Build the firmware for the Arduino at the head of the chain, that receives frames from the host over USB serial
+// #define CHAIN_HEAD
+
+// The outputs of the last clock are wired back to the chain head, which sends the returned frames to the host (telemetry)
+// #define CHAIN_HEAD_RETURN
+
+// Run the motor self-test (MotorTuner) on every startup, not only when no tuning is stored
+// #define FORCE_MOTOR_TUNING
+
+// Debug build: Collect loop, step and ISR timings and print them over Serial (uses COMM_OUT_DATA3 and COMM_OUT_DATA4)
+// #define ENABLE_METRICS
+
 // Motor
 #ifdef COIL_MODE_SINGLE
+#define MICROSTEPS 1
 #define MAX_COIL_STATE 4
 #define MAX_STEPS 1706
 #define MIN_STEP_DELAY 2300
+#elif defined(COIL_MODE_MICROSTEP)
+#define MICROSTEPS 4 // microsteps per half step, must match MICROSTEP_CURRENTS in Motor.cpp
+#define MAX_COIL_STATE (8 * MICROSTEPS)
+#define MAX_STEPS (3414 * MICROSTEPS)
+#define MIN_STEP_DELAY (1100 / MICROSTEPS)
 #else
+#define MICROSTEPS 1
 #define MAX_COIL_STATE 8
 #define MAX_STEPS 3414
 #define MIN_STEP_DELAY 1100
 #endif
 #define MIN_STANDSTILL_DELAY 10000 // us
 
+// Step pacing: the steps follow the rate of the received instructions instead of running at MIN_STEP_DELAY
+#define PACING_WEIGHT 4           // a new instruction interval changes the estimated rate by 1 / PACING_WEIGHT
+#define PACING_BACKLOG 4          // planned steps that halve the paced step delay, so the backlog is drained
+#define PACING_MAX_INTERVAL 50000 // us, a longer pause starts a new motion, that is not paced
+
+// Motor tuning: a self-test finds the fastest reliable step delay and acceleration of every motor
+#define TUNING_MIN_DELAY (MIN_STEP_DELAY / 2)     // us, fastest tested step delay
+#define TUNING_MAX_DELAY (MIN_STEP_DELAY * 2)     // us, slowest tested step delay, a motor failing there is not tuned
+#define TUNING_DELAY_STEP (50 / MICROSTEPS)       // us between two tested step delays
+#define TUNING_MAX_ACCELERATION (40 / MICROSTEPS) // us less delay per step, first tested acceleration (halved after a failure)
+#define TUNING_MIN_ACCELERATION (5 / MICROSTEPS)  // us, gentlest tested acceleration
+#define TUNING_REVOLUTIONS 2                      // revolutions per test
+#define TUNING_TOLERANCE (MAX_COIL_STATE / 2)     // steps, lost steps are multiples of MAX_COIL_STATE, smaller errors are sensor noise
+#define TUNING_MARGIN (100 / MICROSTEPS)          // us added to the fastest reliable step delay
+#define TUNING_PAUSE 200                          // ms standstill before every test
+
+// Speed governor: lost steps found by the recalibration slow a motor down, clean field crossings speed it up again
+#define GOVERNOR_DERATE (200 / MICROSTEPS)        // us added to the min step delay for every crossing with lost steps
+#define GOVERNOR_MAX_DERATE (2000 / MICROSTEPS)   // us
+#define GOVERNOR_CLEAN_ERROR (MAX_COIL_STATE / 2) // steps, a smaller error at a crossing is clean
+#define GOVERNOR_PROBE_CROSSINGS 8                // clean crossings at the derated speed before the delay is shortened
+#define GOVERNOR_PROBE_STEP (25 / MICROSTEPS)     // us less delay after GOVERNOR_PROBE_CROSSINGS clean crossings
+#define GOVERNOR_CRUISE_TOLERANCE 8               // a crossing up to 1 / GOVERNOR_CRUISE_TOLERANCE slower than the derated speed counts
+
 // Calibration
 #define MIN_STEPS_OUTSIDE_FIELD (2 * MAX_COIL_STATE)
 #define MIN_WIDTH_FOR_RECALIBRATION (3 * MAX_COIL_STATE)
 #define MIN_STEPS_OFF_FOR_RECALIBRATION (3 * MAX_COIL_STATE) // deactivate recalibration, real value: 20
+#define CALIBRATION_PRECISE_STEP_DELAY MIN_STEP_DELAY          // us, measuring the field
+#define CALIBRATION_ACCELERATION (10 / MICROSTEPS)             // us less delay per step during the coarse search, up to the min step delay of the motor
+#define FIELD_WIDTH_TOLERANCE (2 * MAX_COIL_STATE) // max deviation from the learned field width, otherwise the measurement is an outlier
+#define FIELD_MODEL_MAX_OUTLIERS 3                  // consecutive outliers that restart the learned field width
+#define FIELD_MODEL_SCALE 8                         // fixed point scale of the field model
+#define FIELD_MODEL_WEIGHT 8                        // new measurements change the field model by 1 / FIELD_MODEL_WEIGHT
+#define FIELD_EDGE_QUEUE_SIZE 4 // field edges captured by the interrupt, but not processed yet
+#define CALIBRATION_TIMEOUT ((unsigned long)MAX_STEPS * 2 * MIN_STEP_DELAY / 1000) // ms
+
+// Calibration storage (EEPROM)
+#define EEPROM_CALIBRATION_START 0
+#define EEPROM_CALIBRATION_SLOTS 32 // ring of slots to spread the EEPROM wear
+#define PARK_DELAY 2000             // ms standstill before the positions are stored
+#define PARK_BUS_IDLE 1000          // ms without a frame before the positions are stored, frames during the write would be dropped
+#define EEPROM_TUNING_START 384     // behind the calibration slots (EEPROM_CALIBRATION_SLOTS * 12 bytes)
+#define EEPROM_MACRO_START 400      // behind the motor tuning
 
-// Communication parameters
+// Communication parameters, defaults until COMMAND_TIMING (see ChainTuner of the host) sets the timing of the wall
 #define CLOCK_OUT_HIGH 4               // us
 #define DELAY_BETWEEN_INSTRUCTIONS 300 // us
+#define TIMING_TRIAL_PERIOD 2000       // ms, a timing set by COMMAND_TIMING is reverted after this time unless COMMAND_TIMING_KEEP follows
+#define TIMING_MIN_FRAME_GAP 50        // us, shortest accepted DELAY_BETWEEN_INSTRUCTIONS, processDataInput() must fit between two ticks
+
+// Commands: the own instruction COMMAND_ESCAPE (hour hand calibrate, minute hand forward) starts a command, see CommandParser
+// The command code and its arguments follow as the next own instructions, one nibble per frame
+#define COMMAND_ESCAPE 0xD
+#define COMMAND_MAX_ARGUMENTS 14
+#define COMMAND_VELOCITY 0x1           // 4 arguments: speed of the hour hand and of the minute hand, signed bytes (upper nibble first)
+#define COMMAND_MACRO_STORE 0x2        // 14 arguments: slot, move index, hour steps, minute steps, frames (16 bit each, upper nibble first)
+#define COMMAND_MACRO_PLAY 0x3         // 1 argument: slot
+#define COMMAND_TIMING 0x4             // 6 arguments: CLOCK_OUT_HIGH (byte) and DELAY_BETWEEN_INSTRUCTIONS (16 bit) on trial, upper nibble first
+#define COMMAND_TIMING_KEEP 0x5        // no arguments: keeps the timing on trial
+#define VELOCITY_UNIT (8 * MICROSTEPS) // steps per second per speed unit of COMMAND_VELOCITY
+
+// Frame types: the first instruction of a frame marks it (a calibration with a moving hand, never sent for a calibration)
+// Every clock forwards all instructions of a marked frame, the marker is not an own instruction. See ClockCommunication
+#define FRAME_ADDRESSED 0x7    // followed by (index upper nibble, index lower nibble, instruction) for every addressed clock
+#define FRAME_ENUMERATION 0xB  // followed by a counter (lower nibble, upper nibble), every clock takes it as index and increments it
+#define ADDRESS_BROADCAST 0xFF // index of an addressed instruction for all clocks, also the index of a clock before the enumeration
+#define FRAME_TELEMETRY 0xE    // followed by the index of the first polled clock (upper, lower nibble) and TELEMETRY_NIBBLES per polled clock
+#define TELEMETRY_NIBBLES 12   // reserved for the status of a clock, it overwrites them while passing them on. See Telemetry.h
+
+// Macros: step sequences stored on the clock, see MacroPlayer
+#define MACRO_SLOTS 8
+#define MACRO_MAX_MOVES 12
+#define MACRO_FRAME_PERIOD MIN_STEP_DELAY // us between two instructions of a playing macro, a move steps at most once per frame
+
+// Chain head (only with CHAIN_HEAD)
+#define CHAIN_LENGTH 24             // clocks in the chain
+#define CHAIN_HEAD_BAUD_RATE 500000
+#define CHAIN_HEAD_SYNC 0xA5        // first byte of every frame
+#define CHAIN_HEAD_ACK 0x06         // sent to the host for every free frame buffer
+#define CHAIN_HEAD_TICK_PERIOD 50   // us between two instructions of a frame: processDataInput() (~9 us), CLOCK_OUT_HIGH and the timer0 and PCINT interrupts of every clock, lowered by the ChainTuner
+#define CHAIN_HEAD_GAP_MARGIN 50    // us added to DELAY_BETWEEN_INSTRUCTIONS between two frames
+#define CHAIN_HEAD_TIMING 0x54      // first byte of a timing message: clock out high, tick period and frame gap (16 bit, upper byte first)
+#define CHAIN_HEAD_LATENCY 0x4C     // first byte of a latency message, sent before a returned frame: us (16 bit, upper byte first)
+
+// Scheduler: loop() executes the tasks by priority, a task only starts if its worst case runtime ends before the next step
+#define SCHEDULER_MAX_TASKS 8
+#define SCHEDULER_MAX_DELAY 1000000UL                       // us, longest sleep of a task
+#define SCHEDULER_WORST_CASE_WINDOW 1000000UL               // us, a measured worst case is kept for one to two windows
+#define SCHEDULER_MAX_MEASURED 500                          // us, longest measured runtime of a task without a given worst case
+#define CALIBRATION_TASK_INTERVAL 1000                      // us, the interrupt queues up to FIELD_EDGE_QUEUE_SIZE field edges meanwhile
+#define PARK_TASK_INTERVAL 100000                           // us
+#define PARK_WORST_CASE 40000                               // us, writing a calibration slot
+
+// Metrics (only with ENABLE_METRICS)
+#define METRICS_BAUD_RATE 115200
+#define METRICS_REPORT_INTERVAL 5000 // ms
 
 // Pins
+// The hall sensors must be connected to port C (A0 - A5), see PCINT1_vect in main.cpp
 #define HALL_DATA_PIN_1 A1
 #define HALL_DATA_PIN_2 A0
 
@@ -45,6 +157,20 @@
 #define COMM_OUT_DATA3 1 // tx
 #define COMM_OUT_DATA4 0 // rx
 
+// Pins for the chain head (Serial uses pins 0 and 1)
+#define CHAIN_HEAD_OUT_CLOCK A3
+#define CHAIN_HEAD_OUT_DATA1 A2
+#define CHAIN_HEAD_OUT_DATA2 A4
+#define CHAIN_HEAD_OUT_DATA3 A5
+#define CHAIN_HEAD_OUT_DATA4 A1
+
+// Pins for the frames returned to the chain head (only with CHAIN_HEAD_RETURN), wired to the COMM_OUT pins of the last clock
+#define CHAIN_HEAD_IN_CLOCK 2 // interrupt pin
+#define CHAIN_HEAD_IN_DATA1 3
+#define CHAIN_HEAD_IN_DATA2 4
+#define CHAIN_HEAD_IN_DATA3 5
+#define CHAIN_HEAD_IN_DATA4 6
+
 // Pins for DataReceiver (Receiving from previous Arduino or Raspberry Pi Zero)
 #define COMM_IN_CLOCK 2  // interrupt pin
 #define COMM_IN_DATA1 A5 // 1
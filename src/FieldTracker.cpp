@@ -0,0 +1,97 @@
+#include "FieldTracker.h"
+#include <stdlib.h>
+#include "Config.h"
+#include "Utils.h"
+
+FieldTracker::FieldTracker()
+{
+  this->reset(0, false, 0, false);
+}
+
+/**
+ * @brief Starts the field model of both directions with the calibrated field width.
+ *
+ * The field is expected to be centered at position 0 in both directions.
+ * The hand is in the center of the field after a calibration, so the first field that is left is ignored.
+ *
+ * @param field_width Calibrated width of the field.
+ * @param in_field The hall sensor detects the magnet.
+ * @param position Current position of the motor.
+ * @param forward Current direction of the motor.
+ */
+void FieldTracker::reset(size_t field_width, bool in_field, size_t position, bool forward)
+{
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    this->model[i].width = (long)field_width * FIELD_MODEL_SCALE;
+    this->model[i].center = 0;
+    this->model[i].outliers = 0;
+  }
+  this->infield = in_field;
+  this->enter_pos = position;
+  this->enter_forward = forward;
+  this->ignore_next_field = true;
+}
+
+/**
+ * @brief Saves the enter position of the field and measures the crossing when the field is left.
+ *
+ * The magnet field width and center are calculated and compared with the field model of the direction.
+ *
+ * @return true The field was crossed cleanly, crossing is set. The caller reports it to the speed governor and corrects lost steps.
+ * @return false No crossing to report (entered the field, left it on the same side, first field or outlier).
+ */
+bool FieldTracker::processEdge(const FieldEdge &edge, FieldCrossing &crossing)
+{
+  if (!this->infield && edge.in_field)
+  {
+    this->infield = true;
+    this->enter_pos = edge.position;
+    this->enter_forward = edge.forward;
+    return false;
+  }
+  if (!this->infield || edge.in_field)
+    return false;
+
+  this->infield = false;
+  if (this->enter_forward != edge.forward)
+    return false; // The field was left on the same side. Do not recalibrate
+
+  if (this->ignore_next_field)
+  {
+    this->ignore_next_field = false;
+    return false; // Ignore the first field after calibration. Do not recalibrate
+  }
+
+  size_t field_width = diff(this->enter_pos, edge.position, this->enter_forward);
+  if (field_width < MIN_WIDTH_FOR_RECALIBRATION)
+    return false; // The tracked magnet field was smaller then the minimum magnet field width. Do not recalibrate
+
+  FieldModel &model = this->model[this->enter_forward ? 1 : 0];
+
+  long width_error = (long)field_width * FIELD_MODEL_SCALE - model.width;
+  if (labs(width_error) > FIELD_WIDTH_TOLERANCE * FIELD_MODEL_SCALE)
+  {
+    if (++model.outliers < FIELD_MODEL_MAX_OUTLIERS)
+      return false; // Single noisy measurement. Do not recalibrate
+
+    // The field seems to have changed permanently: Restart the width model with this measurement
+    model.width = (long)field_width * FIELD_MODEL_SCALE;
+    model.outliers = 0;
+    return false;
+  }
+  model.outliers = 0;
+  model.width += width_error / FIELD_MODEL_WEIGHT;
+
+  // Center of the measured field. Compared with the center the model expects for this direction
+  long half_width = (long)field_width * FIELD_MODEL_SCALE / 2;
+  long center = (long)toSignedPosition(this->enter_pos) * FIELD_MODEL_SCALE + (this->enter_forward ? half_width : -half_width);
+  long center_error = center - model.center;
+  crossing.steps_off = (labs(center_error) + FIELD_MODEL_SCALE / 2) / FIELD_MODEL_SCALE;
+  crossing.lost_steps = crossing.steps_off >= MIN_STEPS_OFF_FOR_RECALIBRATION;
+  crossing.correction_direction = center_error < 0;
+
+  if (!crossing.lost_steps)
+    model.center += center_error / FIELD_MODEL_WEIGHT; // Follow slow drifts of the sensor (e.g. hysteresis)
+  return true;
+}
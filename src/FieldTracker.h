@@ -0,0 +1,52 @@
+#ifndef _FIELD_TRACKER_H_
+#define _FIELD_TRACKER_H_
+
+#include <stddef.h> // no Arduino.h, the digital twin compiles this file natively
+#include <stdint.h>
+
+struct FieldEdge
+{
+  size_t position; // Motor position when the hall sensor changed
+  bool forward;    // Motor direction when the hall sensor changed
+  bool in_field;   // true = entered the field, false = left the field
+};
+
+struct FieldModel
+{
+  long width;       // Expected field width in 1 / FIELD_MODEL_SCALE steps, exceeds int with microsteps
+  long center;      // Expected field center relative to position 0 in 1 / FIELD_MODEL_SCALE steps
+  uint8_t outliers; // Consecutive measurements that did not match the expected width
+};
+
+/**
+ * @brief A clean field crossing measured by FieldTracker::processEdge().
+ */
+struct FieldCrossing
+{
+  size_t steps_off;          // Steps the position is off the field model
+  bool lost_steps;           // steps_off is MIN_STEPS_OFF_FOR_RECALIBRATION or more, the position must be corrected
+  bool correction_direction; // true = the hand is steps_off ahead of the position (forwards), false = behind
+};
+
+/**
+ * @brief Follows the field crossings of a calibrated hand and learns the width and the center of its field for both directions.
+ *
+ * Measurements with an unexpected width are rejected as outliers. Small center errors update the model,
+ * large errors mean lost steps. Used by Calibration and compiled natively by the digital twin.
+ */
+class FieldTracker
+{
+public:
+  FieldTracker();
+  void reset(size_t field_width, bool in_field, size_t position, bool forward);
+  bool processEdge(const FieldEdge &edge, FieldCrossing &crossing);
+
+private:
+  bool infield;
+  bool ignore_next_field; // Ignore the first field after calibration
+  bool enter_forward;
+  size_t enter_pos;
+  FieldModel model[2]; // 0 = backward, 1 = forward
+};
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef _INSTRUCTION_H_
 #define _INSTRUCTION_H_
 
+#include "CommandParser.h"
+
 struct Instruction
 {
   bool hourBackward;
@@ -9,10 +11,38 @@ struct Instruction
   bool minuteForward;
 };
 
+/**
+ * @brief Handed from the data receiving ISR to the main loop. The ISR parses the commands, a command is only handed over complete.
+ */
 struct OwnInstruction
 {
-  bool pending;
+  bool pending; // step instruction, overwritten by the next one if the main loop is busy
   Instruction data;
+  bool command_pending; // complete command, its instructions are no step instructions
+  Command command;
 };
 
+/**
+ * @brief Packs an instruction into four bits as it is transmitted over the data wires.
+ *
+ * Most significant bit first: hour backward, hour forward, minute backward, minute forward.
+ */
+inline unsigned char encodeInstruction(const Instruction &instruction)
+{
+  return (instruction.hourBackward << 3) | (instruction.hourForward << 2) | (instruction.minuteBackward << 1) | instruction.minuteForward;
+}
+
+/**
+ * @brief Unpacks four bits into an instruction. See encodeInstruction().
+ */
+inline Instruction decodeInstruction(unsigned char nibble)
+{
+  Instruction instruction;
+  instruction.hourBackward = nibble & 0x08;
+  instruction.hourForward = nibble & 0x04;
+  instruction.minuteBackward = nibble & 0x02;
+  instruction.minuteForward = nibble & 0x01;
+  return instruction;
+}
+
 #endif
\ No newline at end of file
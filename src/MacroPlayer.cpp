@@ -0,0 +1,97 @@
+#include "MacroPlayer.h"
+#include "Instruction.h"
+
+/**
+ * @brief Frames of a move, a hand steps at most once per frame.
+ */
+uint16_t getMoveFrames(const MacroMove &move)
+{
+  uint16_t hour = move.hour_steps < 0 ? -move.hour_steps : move.hour_steps;
+  uint16_t minute = move.minute_steps < 0 ? -move.minute_steps : move.minute_steps;
+  uint16_t frames = move.frames;
+  if (hour > frames)
+    frames = hour;
+  if (minute > frames)
+    frames = minute;
+  return frames;
+}
+
+/**
+ * @brief Checks if a hand steps in a frame of a move, the steps are spread evenly over all frames.
+ */
+bool isMoveStep(int16_t steps, uint16_t frame, uint16_t frames)
+{
+  unsigned long distance = steps < 0 ? -(long)steps : steps;
+  return (frame + 1) * distance / frames != frame * distance / frames;
+}
+
+/**
+ * @brief Writes a move of an uploaded macro.
+ *
+ * The moves are uploaded in order: index 0 starts a new macro, every following index appends or replaces a move.
+ *
+ * @return true The macro was changed. false if the index is behind the end of the macro.
+ */
+bool storeMacroMove(Macro &macro, uint8_t index, const MacroMove &move)
+{
+  uint8_t length = macro.length <= MACRO_MAX_MOVES ? macro.length : 0; // erased EEPROM
+  if (index >= MACRO_MAX_MOVES || index > length)
+    return false;
+
+  macro.moves[index] = move;
+  macro.length = index + 1;
+  return true;
+}
+
+MacroPlayer::MacroPlayer()
+{
+  this->stop();
+}
+
+void MacroPlayer::start(const Macro &macro)
+{
+  this->macro = macro;
+  this->move = 0;
+  this->frame = 0;
+  this->playing = macro.length > 0 && macro.length <= MACRO_MAX_MOVES;
+}
+
+void MacroPlayer::stop()
+{
+  this->playing = false;
+}
+
+bool MacroPlayer::isPlaying() const
+{
+  return this->playing;
+}
+
+/**
+ * @brief Returns the instruction of the next frame and advances by one frame. The last frame ends the playback.
+ *
+ * @return uint8_t Instruction as received over the data wires, see encodeInstruction(). 0 (keep still) if the macro is not playing.
+ */
+uint8_t MacroPlayer::next()
+{
+  while (this->playing && this->frame >= getMoveFrames(this->macro.moves[this->move]))
+  {
+    this->frame = 0;
+    this->move++;
+    this->playing = this->move < this->macro.length;
+  }
+  if (!this->playing)
+    return 0;
+
+  const MacroMove &move = this->macro.moves[this->move];
+  uint16_t frames = getMoveFrames(move);
+  Instruction instruction;
+  instruction.hourForward = move.hour_steps > 0 && isMoveStep(move.hour_steps, this->frame, frames);
+  instruction.hourBackward = move.hour_steps < 0 && isMoveStep(move.hour_steps, this->frame, frames);
+  instruction.minuteForward = move.minute_steps > 0 && isMoveStep(move.minute_steps, this->frame, frames);
+  instruction.minuteBackward = move.minute_steps < 0 && isMoveStep(move.minute_steps, this->frame, frames);
+
+  this->frame++;
+  if (this->frame >= frames && this->move + 1 >= this->macro.length)
+    this->playing = false;
+  return encodeInstruction(instruction);
+}
@@ -0,0 +1,51 @@
+#ifndef _MACRO_PLAYER_H_
+#define _MACRO_PLAYER_H_
+
+#include <stddef.h> // no Arduino.h, the digital twin compiles this file natively
+#include <stdint.h>
+#include "Config.h"
+
+/**
+ * @brief A straight move of both hands: the steps are spread evenly over the frames.
+ */
+struct MacroMove
+{
+  int16_t hour_steps;   // negative = backward, positive = forward
+  int16_t minute_steps;
+  uint16_t frames;      // duration in MACRO_FRAME_PERIOD, at least the steps of the faster hand
+};
+
+/**
+ * @brief A step sequence stored on the clock.
+ */
+struct Macro
+{
+  uint8_t length; // moves
+  MacroMove moves[MACRO_MAX_MOVES];
+};
+
+bool storeMacroMove(Macro &macro, uint8_t index, const MacroMove &move);
+
+/**
+ * @brief Plays a macro as a local stream of instructions.
+ *
+ * next() returns one instruction per MACRO_FRAME_PERIOD, like the own instruction of a frame.
+ * The instructions are executed like received ones, so the steps are paced and scheduled like the steps from the bus.
+ */
+class MacroPlayer
+{
+public:
+  MacroPlayer();
+  void start(const Macro &macro);
+  void stop();
+  bool isPlaying() const;
+  uint8_t next();
+
+private:
+  Macro macro;
+  uint8_t move;   // index of the current move
+  uint16_t frame; // frame within the current move
+  bool playing;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "MacroStorage.h"
+#include <EEPROM.h>
+#include "Config.h"
+
+/**
+ * @brief Loads a macro from EEPROM.
+ *
+ * @return true The slot contains a valid macro.
+ * @return false The slot is empty, was not completely uploaded or does not exist.
+ */
+bool MacroStorage::load(uint8_t slot, Macro &macro)
+{
+  if (slot >= MACRO_SLOTS)
+    return false;
+
+  Record record;
+  EEPROM.get(address(slot), record);
+  if (record.checksum != checksum(record) || record.macro.length == 0 || record.macro.length > MACRO_MAX_MOVES)
+    return false;
+
+  macro = record.macro;
+  return true;
+}
+
+/**
+ * @brief Writes a move of an uploaded macro, see storeMacroMove(). Takes approximately 3.3 ms per changed byte (up to 30 ms).
+ */
+void MacroStorage::storeMove(uint8_t slot, uint8_t index, const MacroMove &move)
+{
+  if (slot >= MACRO_SLOTS)
+    return;
+
+  Record record;
+  EEPROM.get(address(slot), record);
+  if (!storeMacroMove(record.macro, index, move))
+    return;
+
+  record.checksum = checksum(record);
+  EEPROM.put(address(slot), record); // only writes the changed bytes
+}
+
+uint8_t MacroStorage::checksum(const Record &record)
+{
+  const uint8_t *bytes = (const uint8_t *)&record.macro;
+  size_t length = offsetof(Macro, moves) + (record.macro.length <= MACRO_MAX_MOVES ? record.macro.length : 0) * sizeof(MacroMove);
+  uint8_t sum = 0;
+  for (size_t i = 0; i < length; i++)
+  {
+    sum = (sum << 1 | sum >> 7) ^ bytes[i];
+  }
+  return sum;
+}
+
+int MacroStorage::address(uint8_t slot)
+{
+  static_assert(EEPROM_MACRO_START + MACRO_SLOTS * sizeof(Record) <= E2END + 1, "Macros do not fit into the EEPROM");
+  return EEPROM_MACRO_START + slot * sizeof(Record);
+}
@@ -0,0 +1,24 @@
+#ifndef _MACRO_STORAGE_H_
+#define _MACRO_STORAGE_H_
+
+#include <Arduino.h>
+#include "MacroPlayer.h"
+
+class MacroStorage
+{
+public:
+  bool load(uint8_t slot, Macro &macro);
+  void storeMove(uint8_t slot, uint8_t index, const MacroMove &move);
+
+private:
+  struct Record
+  {
+    Macro macro;
+    uint8_t checksum;
+  };
+
+  static uint8_t checksum(const Record &record);
+  static int address(uint8_t slot);
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "Metrics.h"
+
+#ifdef ENABLE_METRICS
+
+Metrics metrics;
+
+/**
+ * @brief Adds a value to the matching bucket.
+ *
+ * Safe to call from an ISR. Takes approximately 2 microseconds.
+ *
+ * @param value Measured value, usually in microseconds.
+ */
+void Histogram::record(unsigned long value)
+{
+  if (value > this->max)
+  {
+    this->max = value;
+  }
+
+  uint8_t bucket = 0;
+  while (value != 0 && bucket < METRICS_BUCKETS - 1)
+  {
+    value >>= 1;
+    bucket++;
+  }
+
+  if (this->buckets[bucket] != 0xFFFF)
+  {
+    this->buckets[bucket]++;
+  }
+}
+
+void Histogram::reset()
+{
+  for (uint8_t i = 0; i < METRICS_BUCKETS; i++)
+  {
+    this->buckets[i] = 0;
+  }
+  this->max = 0;
+}
+
+/**
+ * @brief Prints the histogram as a single line: name, maximum and all bucket counts.
+ *
+ * Bucket i contains the values below 2^i us.
+ */
+void Histogram::print(const char *name)
+{
+  Serial.print(name);
+  Serial.print(" max=");
+  Serial.print(this->max);
+  for (uint8_t i = 0; i < METRICS_BUCKETS; i++)
+  {
+    Serial.print(" ");
+    Serial.print(this->buckets[i]);
+  }
+  Serial.println();
+}
+
+/**
+ * @brief Starts the serial output for the metrics report.
+ *
+ * The serial port shares pins 0 and 1 with COMM_OUT_DATA3 and COMM_OUT_DATA4.
+ * Only use this on a single clock or the last clock of the chain.
+ */
+void Metrics::begin()
+{
+  Serial.begin(METRICS_BAUD_RATE);
+  this->loop_period.reset();
+  this->step_lateness.reset();
+  this->isr_duration.reset();
+  this->last_loop_micros = micros();
+  this->last_report_millis = millis();
+}
+
+/**
+ * @brief Records the time since the previous loop() iteration and sends a report after METRICS_REPORT_INTERVAL.
+ */
+void Metrics::recordLoop()
+{
+  unsigned long current_micros = micros();
+  this->loop_period.record(current_micros - this->last_loop_micros);
+  this->last_loop_micros = current_micros;
+
+  if (millis() - this->last_report_millis > METRICS_REPORT_INTERVAL)
+  {
+    this->report();
+    // Do not count the time spent on printing as loop period
+    this->last_report_millis = millis();
+    this->last_loop_micros = micros();
+  }
+}
+
+/**
+ * @brief Prints all counters and histograms over Serial and resets the histograms.
+ *
+ * Counters are not reset, so the host can calculate rates from two reports.
+ */
+void Metrics::report()
+{
+  // The ISR writes into these values, take a consistent copy first
+  noInterrupts();
+  Histogram isr_duration = this->isr_duration;
+  this->isr_duration.reset();
+  unsigned long received = this->instructions_received;
+  unsigned long forwarded = this->instructions_forwarded;
+  interrupts();
+
+  Serial.print("received=");
+  Serial.print(received);
+  Serial.print(" forwarded=");
+  Serial.println(forwarded);
+
+  this->loop_period.print("loop");
+  this->step_lateness.print("late");
+  isr_duration.print("isr");
+
+  this->loop_period.reset();
+  this->step_lateness.reset();
+}
+
+#endif
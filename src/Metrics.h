@@ -0,0 +1,50 @@
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include <Arduino.h>
+#include "Config.h"
+
+#ifdef ENABLE_METRICS
+
+#define METRICS_BUCKETS 16
+
+/**
+ * @brief Histogram with logarithmic (log2) buckets.
+ *
+ * Bucket 0 counts the value 0, bucket i counts values in [2^(i-1), 2^i).
+ * The last bucket also counts every larger value. Counters saturate instead of overflowing.
+ */
+class Histogram
+{
+public:
+  void record(unsigned long value);
+  void reset();
+  void print(const char *name);
+
+private:
+  uint16_t buckets[METRICS_BUCKETS];
+  unsigned long max;
+};
+
+struct Metrics
+{
+  Histogram loop_period;   // us between two loop() iterations
+  Histogram step_lateness; // us a step fired after it was due
+  Histogram isr_duration;  // us spent inside the data receiving ISR
+
+  volatile unsigned long instructions_received;
+  volatile unsigned long instructions_forwarded;
+
+  unsigned long last_loop_micros;
+  unsigned long last_report_millis;
+
+  void begin();
+  void recordLoop();
+  void report();
+};
+
+extern Metrics metrics;
+
+#endif
+
+#endif
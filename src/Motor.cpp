@@ -1,6 +1,9 @@
 #include "Motor.h"
 #include <FastGPIO.h>
+#include <util/atomic.h>
 #include "Config.h"
+#include "Metrics.h"
+#include "Utils.h"
 
 void quickWrite(uint8_t pin, bool state)
 {
@@ -37,10 +40,92 @@ void quickWrite(uint8_t pin, bool state)
   }
 }
 
+#ifdef COIL_MODE_MICROSTEP
+// Quarter sine wave as PWM duty cycle: round(255 * sin(i * 90° / (2 * MICROSTEPS)))
+const uint8_t MICROSTEP_CURRENTS[] = {0, 50, 98, 142, 180, 212, 236, 250, 255};
+static_assert(sizeof(MICROSTEP_CURRENTS) == MAX_COIL_STATE / 4 + 1, "MICROSTEP_CURRENTS does not match MICROSTEPS");
+
+/**
+ * @brief Current of a phase at an electrical angle, as signed PWM duty cycle.
+ *
+ * @param angle Electrical angle in microsteps, MAX_COIL_STATE is a full period.
+ * @return int Sine of the angle between [-255, 255].
+ */
+int microstepCurrent(size_t angle)
+{
+  const size_t quarter = MAX_COIL_STATE / 4;
+  angle %= MAX_COIL_STATE;
+  size_t offset = angle % quarter;
+  switch (angle / quarter)
+  {
+  case 0:
+    return MICROSTEP_CURRENTS[offset];
+  case 1:
+    return MICROSTEP_CURRENTS[quarter - offset];
+  case 2:
+    return -MICROSTEP_CURRENTS[offset];
+  default:
+    return -MICROSTEP_CURRENTS[quarter - offset];
+  }
+}
+
+/**
+ * @brief Writes a duty cycle to a motor pin. Pins without hardware PWM are switched at half the duty cycle.
+ *
+ * analogWrite() also disconnects the timer for 0 and 255, so the pins are never left in PWM mode.
+ */
+void writeDuty(uint8_t pin, uint8_t duty)
+{
+  if (digitalPinToTimer(pin) != NOT_ON_TIMER)
+    analogWrite(pin, duty);
+  else
+    quickWrite(pin, duty >= 128);
+}
+
+/**
+ * @brief Drives one phase of the motor (two opposite halves of the coil) with a signed current.
+ *
+ * Only one pin of every phase is PWM capable (pins 6, 9, 10 and 11). If the current has to flow through the half without PWM,
+ * that half is switched on fully and the PWM half works against it with the complementary duty cycle. The net flux is the same,
+ * but both halves draw current, so the motor gets warmer in this mode.
+ */
+void writePhase(uint8_t positive_pin, uint8_t negative_pin, int current)
+{
+  uint8_t on_pin = current >= 0 ? positive_pin : negative_pin;
+  uint8_t off_pin = current >= 0 ? negative_pin : positive_pin;
+  uint8_t duty = current >= 0 ? current : -current;
+
+  if (digitalPinToTimer(on_pin) != NOT_ON_TIMER || duty == 0)
+  {
+    writeDuty(off_pin, 0);
+    writeDuty(on_pin, duty);
+  }
+  else
+  {
+    writeDuty(on_pin, 255);
+    writeDuty(off_pin, 255 - duty);
+  }
+}
+
+/**
+ * @brief Raises the PWM frequency of the motor pins on timer 1 (pins 9, 10) and timer 2 (pin 11) to 31 kHz, above the audible range.
+ *
+ * Timer 0 (pin 6) keeps its 980 Hz, it also drives micros(). Call it in setup(), init() resets the timers before.
+ */
+void Motor::beginMicrostepping()
+{
+  TCCR1B = (TCCR1B & 0xF8) | 0x01;
+  TCCR2B = (TCCR2B & 0xF8) | 0x01;
+}
+#endif
+
 Motor::Motor(uint8_t _pin1, uint8_t _pin2, uint8_t _pin3, uint8_t _pin4) : pin1(_pin1), pin2(_pin2), pin3(_pin3), pin4(_pin4)
 {
   this->coil_state = 1;
   this->previous_coil_state = 0;
+  this->tuning.min_step_delay = MIN_STEP_DELAY;
+  this->tuning.acceleration = 0;
+  this->recalibrations = 0;
 
   pinMode(pin1, OUTPUT);
   pinMode(pin2, OUTPUT);
@@ -52,16 +137,49 @@ Motor::Motor(uint8_t _pin1, uint8_t _pin2, uint8_t _pin3, uint8_t _pin4) : pin1(
   this->reset();
 }
 
+/**
+ * @brief Plans a step forward. Ends a continuous rotation, see setVelocity().
+ */
 void Motor::planStepForward()
 {
+  this->velocity_interval = 0;
+  this->updatePacing();
+#ifdef ENABLE_METRICS
+  if (this->planned_steps == 0)
+    this->step_planned_micros = micros();
+#endif
   this->planned_steps++; // plan one step in positive direction (forward)
 }
 
+/**
+ * @brief Plans a step backward. Ends a continuous rotation, see setVelocity().
+ */
 void Motor::planStepBackward()
 {
+  this->velocity_interval = 0;
+  this->updatePacing();
+#ifdef ENABLE_METRICS
+  if (this->planned_steps == 0)
+    this->step_planned_micros = micros();
+#endif
   this->planned_steps--; // plan one step in negative direction (backward)
 }
 
+/**
+ * @brief Rotates the hand continuously, tryStep() generates the steps without planned steps.
+ *
+ * The rotation lasts until the next planned step (planStepForward(), planStepBackward()), setVelocity(0) or reset().
+ * Planned steps and recalibrations are executed first, then the rotation continues. The speed is limited by the min step delay of the motor
+ * and a tuned motor accelerates like for planned steps. The coils stay active, even if the steps are further apart than MIN_STANDSTILL_DELAY.
+ *
+ * @param velocity Steps per second, negative = backward, 0 = no rotation.
+ */
+void Motor::setVelocity(int velocity)
+{
+  this->velocity_interval = calculateVelocityInterval(velocity);
+  this->velocity_forward = velocity > 0;
+}
+
 void Motor::stepForward()
 {
   // Move hand
@@ -72,14 +190,17 @@ void Motor::stepForward()
   }
   this->writeNewCoilState();
 
-  // Update position
-  if (this->current_pos == MAX_STEPS - 1)
+  // Update position (atomic, the pin change interrupt reads it)
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
   {
-    this->current_pos = 0;
-  }
-  else
-  {
-    this->current_pos++;
+    if (this->current_pos == MAX_STEPS - 1)
+    {
+      this->current_pos = 0;
+    }
+    else
+    {
+      this->current_pos++;
+    }
   }
   this->current_direction = true;
 }
@@ -94,14 +215,17 @@ void Motor::stepBackward()
   }
   this->writeNewCoilState();
 
-  // Update position
-  if (this->current_pos == 0)
-  {
-    this->current_pos = MAX_STEPS - 1;
-  }
-  else
+  // Update position (atomic, the pin change interrupt reads it)
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
   {
-    this->current_pos--;
+    if (this->current_pos == 0)
+    {
+      this->current_pos = MAX_STEPS - 1;
+    }
+    else
+    {
+      this->current_pos--;
+    }
   }
   this->current_direction = false;
 }
@@ -110,7 +234,12 @@ void Motor::writeNewCoilState()
 {
   this->coils_active = true;
 
-#ifdef COIL_MODE_SINGLE
+#if defined(COIL_MODE_MICROSTEP)
+  // The half step states are the multiples of MICROSTEPS: pin1 (A+), pin2 (B+), pin3 (A-), pin4 (B-), with sine and cosine currents in between
+  size_t angle = this->coil_state - 1;
+  writePhase(pin1, pin3, microstepCurrent(angle + MAX_COIL_STATE / 4));
+  writePhase(pin2, pin4, microstepCurrent(angle));
+#elif defined(COIL_MODE_SINGLE)
   switch (this->coil_state)
   {
   case 1:
@@ -186,7 +315,7 @@ void Motor::writeNewCoilState()
 
 bool Motor::tryStep()
 {
-  if (this->coils_active == false && this->planned_steps == 0 && this->recal_steps == 0)
+  if (this->coils_active == false && !this->hasSteps() && this->recal_steps == 0)
   {
     return false;
   }
@@ -194,7 +323,7 @@ bool Motor::tryStep()
   unsigned long micros_since_last_step = micros() - this->last_step_micros; // always positive. Overflow save
 
   // No planned steps? Prevent motor from overheating by disabling coils
-  if (this->planned_steps == 0 && micros_since_last_step > MIN_STANDSTILL_DELAY)
+  if (!this->hasSteps() && micros_since_last_step > MIN_STANDSTILL_DELAY)
   {
     this->disableAllCoils();
     this->last_step_micros = 0;
@@ -202,7 +331,8 @@ bool Motor::tryStep()
   }
 
   // If we are not ready for the next step, skip current iteration
-  if (micros_since_last_step < MIN_STEP_DELAY)
+  unsigned long step_delay = this->getStepDelay(micros_since_last_step);
+  if (micros_since_last_step < step_delay)
   {
     return false;
   }
@@ -253,29 +383,109 @@ bool Motor::tryStep()
     this->stepForward();
     this->planned_steps--;
   }
+  else if (this->velocity_interval != 0)
+  {
+    this->velocity_forward ? this->stepForward() : this->stepBackward();
+  }
   else
   {
     return false;
   }
+
+#ifdef ENABLE_METRICS
+  // The step was due step_delay after the previous step, but not before it was planned
+  unsigned long lateness = micros_since_last_step - step_delay;
+  unsigned long micros_since_planned = micros() - this->step_planned_micros;
+  metrics.step_lateness.record(micros_since_planned < lateness ? micros_since_planned : lateness);
+#endif
+
+  this->last_step_delay = micros_since_last_step;
   this->last_step_micros = micros();
   return true;
 }
 
+/**
+ * @brief Calculates the delay between the last and the next planned step: paced, but not faster than the ramp allows.
+ *
+ * A tuned motor accelerates up to its min step delay, after a reversal it starts again at MIN_STEP_DELAY.
+ * Without planned steps a continuous rotation steps with its velocity interval.
+ */
+unsigned long Motor::getStepDelay(unsigned long micros_since_last_step)
+{
+  bool forward = this->planned_steps != 0 ? this->planned_steps > 0 : this->velocity_forward;
+  bool reversing = this->hasSteps() && forward != this->current_direction;
+  unsigned long last_step_delay = micros_since_last_step > this->last_step_delay ? micros_since_last_step : this->last_step_delay;
+  if (reversing)
+    last_step_delay = MIN_STEP_DELAY;
+  unsigned long ramp_delay = calculateRampDelay(last_step_delay, this->getMinStepDelay(), this->tuning.acceleration);
+
+  if (this->planned_steps == 0 && this->velocity_interval != 0)
+    return this->velocity_interval > ramp_delay ? this->velocity_interval : ramp_delay;
+  return calculateStepDelay(this->plan_interval, this->planned_steps, ramp_delay);
+}
+
+/**
+ * @brief Checks if there are planned steps or a continuous rotation.
+ */
+bool Motor::hasSteps()
+{
+  return this->planned_steps != 0 || this->velocity_interval != 0;
+}
+
+/**
+ * @brief Calculates the time until tryStep() has something to do: the next step or disabling the coils.
+ *
+ * @return unsigned long Time in us, 0 if tryStep() must be called now. MOTOR_IDLE if the motor has nothing to do.
+ */
+unsigned long Motor::getMicrosUntilStep()
+{
+  if (this->coils_active == false && !this->hasSteps())
+    return MOTOR_IDLE;
+
+  unsigned long micros_since_last_step = micros() - this->last_step_micros;
+  unsigned long step_delay = !this->hasSteps() ? MIN_STANDSTILL_DELAY + 1 : this->getStepDelay(micros_since_last_step);
+  return micros_since_last_step >= step_delay ? 0 : step_delay - micros_since_last_step;
+}
+
+/**
+ * @brief Measures the interval between the planned steps to pace the steps with the rate of the instructions.
+ *
+ * See updatePlanInterval() and calculateStepDelay().
+ */
+void Motor::updatePacing()
+{
+  unsigned long now = micros();
+  this->plan_interval = updatePlanInterval(this->plan_interval, now - this->last_plan_micros);
+  this->last_plan_micros = now;
+}
+
 void Motor::reset()
 {
   this->current_pos = 0;
   this->last_step_micros = 0;
+  this->last_step_delay = PACING_MAX_INTERVAL;
   this->planned_steps = 0;
   this->recal_steps = 0;
+  this->velocity_interval = 0;
+  this->velocity_forward = true;
+  this->plan_interval = MIN_STEP_DELAY;
+  this->last_plan_micros = micros() - PACING_MAX_INTERVAL - 1;
   this->disableAllCoils();
 }
 
 void Motor::disableAllCoils()
 {
+#ifdef COIL_MODE_MICROSTEP
+  writeDuty(pin1, 0);
+  writeDuty(pin2, 0);
+  writeDuty(pin3, 0);
+  writeDuty(pin4, 0);
+#else
   quickWrite(pin1, LOW);
   quickWrite(pin2, LOW);
   quickWrite(pin3, LOW);
   quickWrite(pin4, LOW);
+#endif
   this->coils_active = false;
 }
 
@@ -284,6 +494,22 @@ size_t Motor::getCurrentPosition()
   return this->current_pos;
 }
 
+void Motor::setCurrentPosition(size_t position)
+{
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    this->current_pos = position % MAX_STEPS;
+  }
+}
+
+/**
+ * @brief Checks if the motor has nothing to do and the coils are disabled. A continuously rotating motor is never idle.
+ */
+bool Motor::isIdle()
+{
+  return !this->hasSteps() && !this->coils_active;
+}
+
 bool Motor::isRotatingForwards()
 {
   return this->current_direction;
@@ -299,16 +525,59 @@ void Motor::recalibrate(size_t target_pos, size_t steps_off, bool correction_dir
   // Serial.println(correction_direction);
   // Serial.print("Current position: ");
   // Serial.print(this->current_pos);
-  if (correction_direction)
-  {
-    this->planned_steps -= steps_off;
-    this->current_pos = (target_pos + steps_off) % MAX_STEPS;
-  }
-  else
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
   {
-    this->planned_steps += steps_off;
-    this->current_pos = (target_pos - steps_off + MAX_STEPS) % MAX_STEPS;
+    // The hand is at target_pos, but should be where the old position says. Move it back there
+    if (correction_direction)
+    {
+      this->planned_steps -= steps_off;
+    }
+    else
+    {
+      this->planned_steps += steps_off;
+    }
+    this->current_pos = target_pos;
   }
+  this->recalibrations++;
   // Serial.print("New Current position: ");
   // Serial.println(this->current_pos);
+}
+
+/**
+ * @brief Returns the number of recalibrations since startup, counted modulo 256.
+ */
+uint8_t Motor::getRecalibrations()
+{
+  return this->recalibrations;
+}
+
+/**
+ * @brief Sets the speed limits of this motor. Without a tuning the motor steps with MIN_STEP_DELAY at most.
+ */
+void Motor::setTuning(const MotorTuning &tuning)
+{
+  this->tuning = tuning;
+}
+
+MotorTuning Motor::getTuning()
+{
+  return this->tuning;
+}
+
+/**
+ * @brief Reports a field crossing measured by the recalibration to the speed governor.
+ *
+ * @param steps_off Steps the position was off at the crossing. See SpeedGovernor::recordCrossing().
+ */
+void Motor::recordFieldCrossing(size_t steps_off)
+{
+  this->governor.recordCrossing(steps_off, this->last_step_delay, this->tuning.min_step_delay);
+}
+
+/**
+ * @brief Returns the shortest step delay: the tuning, derated by the speed governor after lost steps.
+ */
+unsigned int Motor::getMinStepDelay()
+{
+  return this->governor.getStepDelay(this->tuning.min_step_delay);
 }
\ No newline at end of file
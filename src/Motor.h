@@ -2,25 +2,54 @@
 #define _MOTOR_H_
 
 #include <Arduino.h>
+#include "Config.h"
+#include "SpeedGovernor.h"
+
+#define MOTOR_IDLE 0xFFFFFFFFUL // getMicrosUntilStep() of a motor without planned steps
+
+/**
+ * @brief Speed limits of a single motor, found by MotorTuner.
+ */
+struct MotorTuning
+{
+  uint16_t min_step_delay; // us, fastest reliable step delay
+  uint16_t acceleration;   // us less delay per step when accelerating from MIN_STEP_DELAY, 0 = no acceleration required
+};
 
 class Motor
 {
 public:
   Motor(uint8_t pin1, uint8_t pin2, uint8_t pin3, uint8_t pin4);
+#ifdef COIL_MODE_MICROSTEP
+  static void beginMicrostepping();
+#endif
   void stepForward();
   void stepBackward();
   void planStepForward();
   void planStepBackward();
+  void setVelocity(int velocity);
   bool tryStep();
+  unsigned long getMicrosUntilStep();
   void reset();
 
   size_t getCurrentPosition();
+  void setCurrentPosition(size_t position);
+  bool isIdle();
   bool isRotatingForwards();
   void recalibrate(size_t target_pos, size_t steps_off, bool correction_direction);
+  uint8_t getRecalibrations();
+
+  void setTuning(const MotorTuning &tuning);
+  MotorTuning getTuning();
+  void recordFieldCrossing(size_t steps_off);
+  unsigned int getMinStepDelay();
 
 private:
   void writeNewCoilState();
   void disableAllCoils();
+  void updatePacing();
+  unsigned long getStepDelay(unsigned long micros_since_last_step);
+  bool hasSteps();
 
   const uint8_t pin1;
   const uint8_t pin2;
@@ -34,8 +63,19 @@ private:
   int recal_steps;        // negative = backward, positive = forward (TODO: unused)
 
   unsigned long last_step_micros;
+  unsigned long last_step_delay;   // us between the last two steps, for the acceleration
+  unsigned long last_plan_micros;  // time of the last planned step
+  unsigned long plan_interval;     // us, estimated interval between the planned steps
+  unsigned long velocity_interval; // us between the steps of the continuous rotation, 0 = no rotation
+  bool velocity_forward;
+#ifdef ENABLE_METRICS
+  unsigned long step_planned_micros; // time when the first step after standstill was planned
+#endif
   size_t coil_state;
   size_t previous_coil_state;
+  MotorTuning tuning;
+  SpeedGovernor governor;
+  uint8_t recalibrations; // since startup, reported by the telemetry
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "MotorTuner.h"
+#include "Utils.h"
+
+MotorTuner::MotorTuner(Motor &m, Calibration &c) : motor(m), calibration(c)
+{
+  this->state = TUNING_FINISHED;
+  this->found = false;
+}
+
+/**
+ * @brief Starts the self-test of the motor.
+ *
+ * The hand rotates forwards and the hall sensor measures every revolution: the field is entered again after exactly MAX_STEPS steps,
+ * unless steps were lost. A stepper motor loses steps in multiples of MAX_COIL_STATE, so a deviation above TUNING_TOLERANCE is a failed test.
+ *
+ * 1. The hand moves slowly to the edge of the field, where every test starts and ends. (TUNING_FIND_EDGE)
+ * 2. The motor stands still for TUNING_PAUSE, then runs TUNING_REVOLUTIONS revolutions from the standstill with the candidate. (TUNING_STANDSTILL, TUNING_RUN)
+ * 3. The step delay starts at MIN_STEP_DELAY and is shortened by TUNING_DELAY_STEP after every reliable test.
+ *    Delays below MIN_STEP_DELAY accelerate from MIN_STEP_DELAY, starting with TUNING_MAX_ACCELERATION. A failed test halves the acceleration.
+ * 4. The sweep ends with the first delay that fails with TUNING_MIN_ACCELERATION. The result is the last reliable candidate plus TUNING_MARGIN.
+ *    If MIN_STEP_DELAY already fails, longer delays are tested up to TUNING_MAX_DELAY instead. (TUNING_FINISHED)
+ *
+ * Motors that can not even find the field or do not work with TUNING_MAX_DELAY are not tuned. (TUNING_FAILED)
+ * The self-test loses the position of the hand, the motor must be calibrated afterwards.
+ */
+void MotorTuner::start()
+{
+  this->found = false;
+  this->slower = false;
+  this->candidate.min_step_delay = MIN_STEP_DELAY;
+  this->candidate.acceleration = 0;
+
+  this->state = TUNING_FIND_EDGE;
+  this->steps = 0;
+  this->entry_steps = 0;
+  this->last_in_field = this->calibration.isInField();
+  this->step_delay = CALIBRATION_PRECISE_STEP_DELAY;
+  this->last_step_micros = 0;
+}
+
+/**
+ * @brief Executes the self-test. Every call executes at most one step, call it in a tight loop.
+ *
+ * @return true The self-test is finished, see isSuccessful().
+ * @return false The self-test is still running.
+ */
+bool MotorTuner::tune()
+{
+  if (this->state == TUNING_FINISHED || this->state == TUNING_FAILED)
+    return true;
+
+  if (this->state == TUNING_STANDSTILL)
+  {
+    if (millis() - this->pause_millis >= TUNING_PAUSE)
+      this->startTest();
+    return false;
+  }
+
+  if (micros() - this->last_step_micros < this->step_delay)
+    return false;
+
+  this->stepMotor();
+  bool in_field = this->calibration.isInField();
+  bool entered = in_field && !this->last_in_field;
+  this->last_in_field = in_field;
+
+  if (this->state == TUNING_FIND_EDGE)
+  {
+    // Count the steps outside of the field, the edge is only trusted after MIN_STEPS_OUTSIDE_FIELD
+    if (entered && this->entry_steps >= MIN_STEPS_OUTSIDE_FIELD)
+    {
+      this->state = TUNING_STANDSTILL;
+      this->pause_millis = millis();
+    }
+    else if (this->steps > 3 * (unsigned long)MAX_STEPS)
+    {
+      this->state = TUNING_FAILED; // No field found
+    }
+    this->entry_steps = in_field ? 0 : this->entry_steps + 1;
+    return false;
+  }
+
+  // TUNING_RUN: The field is entered once per revolution, the first half revolution ignores sensor noise at the start edge
+  unsigned int revolution_steps = this->steps - this->entry_steps;
+  if (entered && revolution_steps > MAX_STEPS / 2)
+  {
+    if (abs((int)revolution_steps - MAX_STEPS) > TUNING_TOLERANCE)
+    {
+      this->finishTest(false); // Lost steps. The hand is at the edge again, ready for the next test
+    }
+    else if (++this->revolutions == TUNING_REVOLUTIONS)
+    {
+      this->finishTest(true);
+    }
+    this->entry_steps = this->steps;
+  }
+  else if (revolution_steps > MAX_STEPS + MAX_STEPS / 2)
+  {
+    // The motor stalled and missed the field: search the edge again
+    this->finishTest(false);
+    if (this->state == TUNING_STANDSTILL)
+    {
+      this->state = TUNING_FIND_EDGE;
+      this->steps = 0;
+      this->entry_steps = 0;
+      this->step_delay = CALIBRATION_PRECISE_STEP_DELAY;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Checks if the self-test found a reliable tuning.
+ */
+bool MotorTuner::isSuccessful()
+{
+  return this->state == TUNING_FINISHED && this->found;
+}
+
+/**
+ * @brief Returns the fastest reliable tuning with TUNING_MARGIN. Only valid if isSuccessful().
+ */
+MotorTuning MotorTuner::getResult()
+{
+  MotorTuning result = this->best;
+  result.min_step_delay += TUNING_MARGIN;
+  if (result.min_step_delay >= MIN_STEP_DELAY)
+    result.acceleration = 0;
+  return result;
+}
+
+/**
+ * @brief Executes a single forward step and calculates the delay of the next one like Motor::tryStep().
+ */
+void MotorTuner::stepMotor()
+{
+  unsigned long now = micros();
+  this->last_step_delay = now - this->last_step_micros;
+  this->last_step_micros = now;
+  this->motor.stepForward();
+  this->steps++;
+
+  if (this->state == TUNING_RUN)
+    this->step_delay = calculateRampDelay(this->last_step_delay, this->candidate.min_step_delay, this->candidate.acceleration);
+}
+
+/**
+ * @brief Starts the test of the candidate from the standstill at the field edge.
+ */
+void MotorTuner::startTest()
+{
+  this->state = TUNING_RUN;
+  this->steps = 0;
+  this->entry_steps = 0;
+  this->revolutions = 0;
+  this->last_step_micros = micros() - PACING_MAX_INTERVAL; // standstill
+  this->step_delay = 0;                                  // the first step is executed at once
+}
+
+/**
+ * @brief Evaluates the test of the candidate and selects the next candidate or finishes the sweep.
+ *
+ * @param reliable true if no step was lost.
+ */
+void MotorTuner::finishTest(bool reliable)
+{
+  this->state = TUNING_STANDSTILL;
+  this->pause_millis = millis();
+  MotorTuning &next = this->candidate;
+
+  if (reliable)
+  {
+    this->best = this->candidate;
+    this->found = true;
+    if (this->slower || next.min_step_delay < TUNING_MIN_DELAY + TUNING_DELAY_STEP)
+    {
+      this->state = TUNING_FINISHED;
+      return;
+    }
+    next.min_step_delay -= TUNING_DELAY_STEP;
+    next.acceleration = next.min_step_delay < MIN_STEP_DELAY ? TUNING_MAX_ACCELERATION : 0;
+  }
+  else if (next.acceleration > TUNING_MIN_ACCELERATION)
+  {
+    next.acceleration /= 2; // Try the same delay with a gentler acceleration
+  }
+  else if (this->found)
+  {
+    this->state = TUNING_FINISHED;
+  }
+  else if (next.min_step_delay + TUNING_DELAY_STEP <= TUNING_MAX_DELAY)
+  {
+    this->slower = true;
+    next.min_step_delay += TUNING_DELAY_STEP;
+    next.acceleration = 0;
+  }
+  else
+  {
+    this->state = TUNING_FAILED;
+  }
+}
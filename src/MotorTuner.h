@@ -0,0 +1,52 @@
+#ifndef _MOTOR_TUNER_H_
+#define _MOTOR_TUNER_H_
+
+#include <Arduino.h>
+#include "Motor.h"
+#include "Calibration.h"
+#include "Config.h"
+
+enum TuningState
+{
+  TUNING_FIND_EDGE,
+  TUNING_STANDSTILL,
+  TUNING_RUN,
+  TUNING_FINISHED,
+  TUNING_FAILED
+};
+
+class MotorTuner
+{
+public:
+  MotorTuner(Motor &m, Calibration &c);
+  void start();
+  bool tune();
+
+  bool isSuccessful();
+  MotorTuning getResult();
+
+private:
+  void stepMotor();
+  void startTest();
+  void finishTest(bool reliable);
+
+  Motor &motor;
+  Calibration &calibration;
+  TuningState state;
+
+  MotorTuning candidate; // tested delay and acceleration
+  MotorTuning best;      // fastest reliable candidate
+  bool found;            // best is valid
+  bool slower;           // MIN_STEP_DELAY failed, the sweep continues with longer delays
+
+  unsigned int steps;       // steps of the current test or search
+  unsigned int entry_steps; // steps at the last field entry
+  uint8_t revolutions;
+  bool last_in_field;
+  unsigned long step_delay; // us
+  unsigned long last_step_delay;
+  unsigned long last_step_micros;
+  unsigned long pause_millis;
+};
+
+#endif
@@ -0,0 +1,152 @@
+#include "Scheduler.h"
+
+Scheduler::Scheduler(SchedulerClock clock)
+{
+  this->clock = clock;
+  this->count = 0;
+  this->window_start = clock();
+}
+
+/**
+ * @brief Adds a task, that is due at once.
+ *
+ * @param function Function of the task, see TaskFunction.
+ * @param priority Tasks with a higher priority are never delayed by this task.
+ * @param worst_case Expected runtime in us until it is measured (e.g. for a task that writes the EEPROM).
+ * @param polling The task only polls for work, less important tasks may delay it (see Task::polling).
+ * @return uint8_t Id of the task for wake(). SCHEDULER_MAX_TASKS if there are too many tasks.
+ */
+uint8_t Scheduler::add(TaskFunction function, TaskPriority priority, unsigned long worst_case, bool polling)
+{
+  if (this->count == SCHEDULER_MAX_TASKS)
+    return SCHEDULER_MAX_TASKS;
+
+  Task &task = this->tasks[this->count];
+  task.function = function;
+  task.priority = priority;
+  task.next_run = this->clock();
+  task.worst_case = worst_case;
+  task.window_max = 0;
+  task.expected = worst_case;
+  task.polling = polling;
+  task.woken = false;
+  return this->count++;
+}
+
+/**
+ * @brief Makes the task due at once, e.g. after an event it waits for. Safe to call from an ISR.
+ */
+void Scheduler::wake(uint8_t task)
+{
+  if (task < this->count)
+    this->tasks[task].woken = true;
+}
+
+/**
+ * @brief Executes the most important due task that fits before the deadlines of the more important tasks.
+ *
+ * The runtime of the task is measured, the longest one of the last two windows is its worst case runtime (see measure()).
+ * Tasks of the highest priority always fit.
+ *
+ * @return true A task was executed.
+ */
+bool Scheduler::run()
+{
+  unsigned long now = this->clock();
+  Task *next = NULL;
+  this->ageWorstCases(now);
+
+  for (uint8_t i = 0; i < this->count; i++)
+  {
+    Task &task = this->tasks[i];
+    if (this->getMicrosUntilDue(task, now) > 0)
+      continue;
+    task.next_run = now; // A waiting task stays due, even if micros() overflows meanwhile
+    if (next != NULL && next->priority <= task.priority)
+      continue;
+    if (task.priority != PRIORITY_STEP && this->getSlack(task.priority, now) < (long)task.worst_case)
+      continue; // Would delay a more important task
+    next = &task;
+  }
+
+  if (next == NULL)
+    return false;
+
+  next->woken = false;
+  unsigned long start = this->clock();
+  unsigned long delay = next->function();
+  unsigned long finish = this->clock();
+
+  this->measure(*next, finish - start);
+  next->next_run = finish + (delay > SCHEDULER_MAX_DELAY ? SCHEDULER_MAX_DELAY : delay);
+  return true;
+}
+
+/**
+ * @brief Raises the worst case of the task by a measured runtime.
+ *
+ * A runtime beyond SCHEDULER_MAX_MEASURED and the expected worst case is counted as SCHEDULER_MAX_MEASURED: only interrupts stretch
+ * a short task that far, a task with a longer runtime must give it to add().
+ */
+void Scheduler::measure(Task &task, unsigned long runtime)
+{
+  unsigned long limit = task.expected > SCHEDULER_MAX_MEASURED ? task.expected : SCHEDULER_MAX_MEASURED;
+  if (runtime > limit)
+    runtime = limit;
+  if (runtime > task.window_max)
+    task.window_max = runtime;
+  if (runtime > task.worst_case)
+    task.worst_case = runtime;
+}
+
+/**
+ * @brief Starts a new window every SCHEDULER_WORST_CASE_WINDOW, the worst cases fall back to the longest runtime of the ended window.
+ *
+ * Also a task that is skipped because of its worst case gets a new chance, as it is not measured meanwhile.
+ */
+void Scheduler::ageWorstCases(unsigned long now)
+{
+  if (now - this->window_start < SCHEDULER_WORST_CASE_WINDOW)
+    return;
+
+  this->window_start = now;
+  for (uint8_t i = 0; i < this->count; i++)
+  {
+    Task &task = this->tasks[i];
+    task.worst_case = task.window_max > task.expected ? task.window_max : task.expected;
+    task.window_max = 0;
+  }
+}
+
+unsigned long Scheduler::getWorstCase(uint8_t task)
+{
+  return task < this->count ? this->tasks[task].worst_case : 0;
+}
+
+/**
+ * @brief Time until the task is due. Zero or negative if it is due.
+ */
+long Scheduler::getMicrosUntilDue(const Task &task, unsigned long now)
+{
+  if (task.woken)
+    return 0;
+  return (long)(task.next_run - now); // SCHEDULER_MAX_DELAY keeps this overflow save
+}
+
+/**
+ * @brief Time until the next deadline of all tasks, that are more important than the priority. Polling tasks have no deadline.
+ */
+long Scheduler::getSlack(TaskPriority priority, unsigned long now)
+{
+  long slack = SCHEDULER_MAX_DELAY;
+  for (uint8_t i = 0; i < this->count; i++)
+  {
+    if (this->tasks[i].priority >= priority || this->tasks[i].polling)
+      continue;
+
+    long until_due = this->getMicrosUntilDue(this->tasks[i], now);
+    if (until_due < slack)
+      slack = until_due;
+  }
+  return slack;
+}
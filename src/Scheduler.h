@@ -0,0 +1,70 @@
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include <stddef.h> // no Arduino.h, the scheduler is tested natively
+#include <stdint.h>
+#include "Config.h"
+
+enum TaskPriority
+{
+  PRIORITY_STEP,        // own instructions and motor steps
+  PRIORITY_COMM,        // communication housekeeping
+  PRIORITY_CALIBRATION, // recalibration at the field crossings
+  PRIORITY_BACKGROUND   // parking, diagnostics
+};
+
+/**
+ * @brief Function of a task. Returns the time in us until the task must run again.
+ */
+typedef unsigned long (*TaskFunction)();
+
+/**
+ * @brief Time source of the scheduler in us, micros() on the clock.
+ */
+typedef unsigned long (*SchedulerClock)();
+
+struct Task
+{
+  TaskFunction function;
+  TaskPriority priority;
+  unsigned long next_run;   // micros() when the task is due
+  unsigned long worst_case; // us, longest runtime of the task in the current and the previous window, at least expected
+  unsigned long window_max; // us, longest runtime in the current window
+  unsigned long expected;   // us, worst case given to add()
+  bool polling;             // the returned time is a polling interval, not a deadline: less important tasks may delay it
+  volatile bool woken;      // due now, set by wake()
+};
+
+/**
+ * @brief Cooperative scheduler for loop(). The tasks are static, there is no allocation.
+ *
+ * Every call of run() executes at most one due task: the most important one, whose worst case runtime ends before the next deadline
+ * of every more important task. So a long task never delays a step, it waits until the motors are idle long enough.
+ * Polling tasks have no deadline, they are left out of the slack: otherwise a task that polls every few 100 us would block every
+ * longer task of a lower priority forever.
+ * The measured worst case is forgotten after two SCHEDULER_WORST_CASE_WINDOW: a single run stretched by interrupts must not keep a
+ * task from starting for good.
+ */
+class Scheduler
+{
+public:
+  explicit Scheduler(SchedulerClock clock);
+  uint8_t add(TaskFunction function, TaskPriority priority, unsigned long worst_case = 0, bool polling = false);
+  void wake(uint8_t task);
+  bool run();
+
+  unsigned long getWorstCase(uint8_t task);
+
+private:
+  long getMicrosUntilDue(const Task &task, unsigned long now);
+  long getSlack(TaskPriority priority, unsigned long now);
+  void measure(Task &task, unsigned long runtime);
+  void ageWorstCases(unsigned long now);
+
+  SchedulerClock clock;
+  unsigned long window_start; // us, start of the current worst case window
+  Task tasks[SCHEDULER_MAX_TASKS];
+  uint8_t count;
+};
+
+#endif
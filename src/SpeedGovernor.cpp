@@ -0,0 +1,62 @@
+#include "SpeedGovernor.h"
+#include "Config.h"
+
+SpeedGovernor::SpeedGovernor()
+{
+  this->reset();
+}
+
+void SpeedGovernor::reset()
+{
+  this->derate = 0;
+  this->clean_crossings = 0;
+}
+
+/**
+ * @brief Updates the derating with a measured field crossing.
+ *
+ * A crossing with an error of GOVERNOR_CLEAN_ERROR or more steps is not clean, but only MIN_STEPS_OFF_FOR_RECALIBRATION is treated as lost steps.
+ * Clean crossings only count if the motor crossed the field at its derated speed, slow crossings do not prove that a shorter delay works.
+ *
+ * @param steps_off Steps the position was off at the crossing.
+ * @param step_delay Delay of the last step before the crossing in us.
+ * @param min_step_delay Min step delay of the motor without derating in us.
+ */
+void SpeedGovernor::recordCrossing(size_t steps_off, unsigned long step_delay, unsigned int min_step_delay)
+{
+  if (steps_off >= MIN_STEPS_OFF_FOR_RECALIBRATION)
+  {
+    this->derate = this->derate + GOVERNOR_DERATE > GOVERNOR_MAX_DERATE ? GOVERNOR_MAX_DERATE : this->derate + GOVERNOR_DERATE;
+    this->clean_crossings = 0;
+    return;
+  }
+
+  if (steps_off >= GOVERNOR_CLEAN_ERROR)
+  {
+    this->clean_crossings = 0;
+    return;
+  }
+
+  unsigned int governed_delay = this->getStepDelay(min_step_delay);
+  if (this->derate == 0 || step_delay > governed_delay + governed_delay / GOVERNOR_CRUISE_TOLERANCE)
+    return;
+
+  if (++this->clean_crossings < GOVERNOR_PROBE_CROSSINGS)
+    return;
+
+  this->clean_crossings = 0;
+  this->derate = this->derate > GOVERNOR_PROBE_STEP ? this->derate - GOVERNOR_PROBE_STEP : 0;
+}
+
+/**
+ * @brief Returns the min step delay of the motor including the derating.
+ */
+unsigned int SpeedGovernor::getStepDelay(unsigned int min_step_delay) const
+{
+  return min_step_delay + this->derate;
+}
+
+unsigned int SpeedGovernor::getDerate() const
+{
+  return this->derate;
+}
@@ -0,0 +1,29 @@
+#ifndef _SPEED_GOVERNOR_H_
+#define _SPEED_GOVERNOR_H_
+
+#include <stddef.h> // no Arduino.h, the digital twin compiles this file natively
+#include <stdint.h>
+
+/**
+ * @brief Slows a motor down after lost steps and speeds it up again after clean field crossings.
+ *
+ * Every field crossing measured by the recalibration is reported with the number of steps the position was off.
+ * Lost steps (a recalibration) add GOVERNOR_DERATE to the min step delay of the motor.
+ * After GOVERNOR_PROBE_CROSSINGS clean crossings at the derated speed the delay is shortened by GOVERNOR_PROBE_STEP again.
+ */
+class SpeedGovernor
+{
+public:
+  SpeedGovernor();
+  void reset();
+  void recordCrossing(size_t steps_off, unsigned long step_delay, unsigned int min_step_delay);
+
+  unsigned int getStepDelay(unsigned int min_step_delay) const;
+  unsigned int getDerate() const;
+
+private:
+  unsigned int derate;     // us added to the min step delay
+  uint8_t clean_crossings; // clean crossings at the derated speed since the last change
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+#include <stddef.h> // no Arduino.h, the digital twin compiles this file natively
+#include <stdint.h>
+#include "Config.h"
+
+/**
+ * @brief Status of a clock, written into the reserved instructions of a telemetry frame (FRAME_TELEMETRY).
+ */
+struct Telemetry
+{
+  uint16_t positions[2];        // hour, minute
+  uint8_t recalibrations[2];    // field crossings with lost steps, hour and minute, modulo 16 (see toTelemetryRecalibrations())
+  uint8_t dropped_instructions; // own instructions overwritten before the main loop processed them, counted modulo 256
+};
+
+/**
+ * @brief Reduces a recalibration count to the one nibble transmitted per hand.
+ *
+ * The reported count wraps from 15 to 0, a reader has to poll at least every 15 recalibrations to count them all.
+ */
+inline uint8_t toTelemetryRecalibrations(unsigned long recalibrations)
+{
+  return recalibrations & 0x0F;
+}
+
+/**
+ * @brief Returns a nibble of the telemetry record, TELEMETRY_NIBBLES in total.
+ *
+ * Upper nibble first: hour position (4), minute position (4), hour recalibrations (1), minute recalibrations (1), dropped instructions (2).
+ */
+inline uint8_t getTelemetryNibble(const Telemetry &telemetry, uint8_t index)
+{
+  if (index < 8)
+    return telemetry.positions[index / 4] >> (12 - 4 * (index % 4)) & 0x0F;
+  if (index < 10)
+    return telemetry.recalibrations[index - 8];
+  return index == 10 ? telemetry.dropped_instructions >> 4 : telemetry.dropped_instructions & 0x0F;
+}
+
+#endif
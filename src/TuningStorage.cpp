@@ -0,0 +1,59 @@
+#include "TuningStorage.h"
+#include <EEPROM.h>
+#include "Config.h"
+
+#define TUNING_STORAGE_MAGIC 0x7E
+
+/**
+ * @brief Loads the tuning of both motors from EEPROM.
+ *
+ * The tuning is written once after the self-test, so a single record at EEPROM_TUNING_START is enough.
+ * A tuning of a firmware with another MIN_STEP_DELAY (e.g. COIL_MODE_SINGLE) is not used.
+ *
+ * @param data Receives the stored tuning.
+ * @return true The stored tuning is valid.
+ * @return false There is no tuning. The self-test must be executed.
+ */
+bool TuningStorage::load(StoredTuning &data)
+{
+  Record record;
+  EEPROM.get(EEPROM_TUNING_START, record);
+  if (record.magic != TUNING_STORAGE_MAGIC || record.checksum != checksum(record) || record.config != MIN_STEP_DELAY)
+    return false;
+  if (!isPlausible(record.data.motor[0]) || !isPlausible(record.data.motor[1]))
+    return false;
+
+  data = record.data;
+  return true;
+}
+
+/**
+ * @brief Writes the tuning of both motors. Takes approximately 3.3 ms per changed byte.
+ */
+void TuningStorage::save(const StoredTuning &data)
+{
+  static_assert(EEPROM_TUNING_START + sizeof(Record) <= EEPROM_MACRO_START, "Motor tuning overlaps the macros");
+  Record record;
+  record.magic = TUNING_STORAGE_MAGIC;
+  record.config = MIN_STEP_DELAY;
+  record.data = data;
+  record.checksum = checksum(record);
+  EEPROM.put(EEPROM_TUNING_START, record);
+}
+
+uint8_t TuningStorage::checksum(const Record &record)
+{
+  const uint8_t *bytes = (const uint8_t *)&record;
+  uint8_t sum = 0;
+  for (size_t i = 0; i < offsetof(Record, checksum); i++)
+  {
+    sum = (sum << 1 | sum >> 7) ^ bytes[i];
+  }
+  return sum;
+}
+
+bool TuningStorage::isPlausible(const MotorTuning &tuning)
+{
+  return tuning.min_step_delay >= TUNING_MIN_DELAY && tuning.min_step_delay <= TUNING_MAX_DELAY + TUNING_MARGIN &&
+         tuning.acceleration <= TUNING_MAX_ACCELERATION;
+}
@@ -0,0 +1,31 @@
+#ifndef _TUNING_STORAGE_H_
+#define _TUNING_STORAGE_H_
+
+#include <Arduino.h>
+#include "Motor.h"
+
+struct StoredTuning
+{
+  MotorTuning motor[2]; // Result of the self-test of both motors
+};
+
+class TuningStorage
+{
+public:
+  bool load(StoredTuning &data);
+  void save(const StoredTuning &data);
+
+private:
+  struct Record
+  {
+    uint8_t magic;
+    uint16_t config; // MIN_STEP_DELAY of the firmware that tuned the motors
+    StoredTuning data;
+    uint8_t checksum;
+  };
+
+  static uint8_t checksum(const Record &record);
+  static bool isPlausible(const MotorTuning &tuning);
+};
+
+#endif
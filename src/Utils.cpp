@@ -57,4 +57,133 @@ size_t calculateFieldLeavePosition(size_t fieldWidth, bool direction)
 bool getShortestDirection(size_t from, size_t to)
 {
   return (diff(from, to, true) < diff(from, to, false));
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Converts a position into the signed distance from position 0 (12 o'clock).
+ *
+ * ```cpp
+ * toSignedPosition(10);             // returns:  10
+ * toSignedPosition(MAX_STEPS - 10); // returns: -10
+ * ```
+ *
+ * @param position Position between [0, MAX_STEPS)
+ * @return int Distance between [-MAX_STEPS / 2, MAX_STEPS / 2]. Negative means before 12 o'clock.
+ */
+int toSignedPosition(size_t position)
+{
+  return position > MAX_STEPS / 2 ? (int)position - MAX_STEPS : (int)position;
+}
+
+/**
+ * @brief Updates the estimated interval between two planned steps with a new measurement.
+ *
+ * ```cpp
+ * updatePlanInterval(4000, 8000);  // returns: 5000
+ * updatePlanInterval(4000, 60000); // returns: MIN_STEP_DELAY (new motion)
+ * ```
+ *
+ * @param plan_interval Estimated interval in us.
+ * @param interval Time since the previous planned step in us.
+ * @return unsigned long New estimated interval in us. Moves by 1 / PACING_WEIGHT towards the measurement.
+ */
+unsigned long updatePlanInterval(unsigned long plan_interval, unsigned long interval)
+{
+  if (interval > PACING_MAX_INTERVAL)
+    return MIN_STEP_DELAY;
+
+  if (interval > plan_interval)
+    return plan_interval + (interval - plan_interval) / PACING_WEIGHT;
+  else
+    return plan_interval - (plan_interval - interval) / PACING_WEIGHT;
+}
+
+/**
+ * @brief Calculates the delay before the next planned step, so the steps follow the rate of the instructions.
+ *
+ * With a single planned step the delay is the estimated interval. Every additional PACING_BACKLOG steps shorten it,
+ * so a backlog is drained quickly and the lag stays small. The delay is never shorter than min_step_delay.
+ *
+ * ```cpp
+ * calculateStepDelay(8000, 1);                  // returns: 8000
+ * calculateStepDelay(8000, PACING_BACKLOG + 1); // returns: 4000
+ * ```
+ *
+ * @param plan_interval Estimated interval between two planned steps in us.
+ * @param planned_steps Planned steps, negative means backward.
+ * @param min_step_delay Shortest delay the motor can step with in us, see calculateRampDelay().
+ * @return unsigned long Delay in us between [min_step_delay, PACING_MAX_INTERVAL].
+ */
+unsigned long calculateStepDelay(unsigned long plan_interval, int planned_steps, unsigned long min_step_delay)
+{
+  unsigned long backlog = planned_steps < 0 ? -(long)planned_steps : planned_steps;
+  if (backlog == 0)
+    return min_step_delay;
+
+  unsigned long delay = plan_interval * PACING_BACKLOG / (PACING_BACKLOG + backlog - 1);
+  if (delay > PACING_MAX_INTERVAL)
+    return PACING_MAX_INTERVAL;
+  return delay < min_step_delay ? min_step_delay : delay;
+}
+
+/**
+ * @brief Calculates the shortest delay before the next step of a tuned motor.
+ *
+ * A motor tuned faster than MIN_STEP_DELAY does not start at its full speed.
+ * It accelerates from MIN_STEP_DELAY and every step may only be acceleration shorter than the previous one.
+ *
+ * ```cpp
+ * calculateRampDelay(60000, 600, 20);           // returns: MIN_STEP_DELAY - 20 (standstill)
+ * calculateRampDelay(700, 600, 20);             // returns: 680
+ * calculateRampDelay(610, 600, 20);             // returns: 600
+ * calculateRampDelay(700, MIN_STEP_DELAY, 0);   // returns: MIN_STEP_DELAY (not tuned)
+ * ```
+ *
+ * @param last_step_delay Time between the last two steps in us, or the time since the last step if that is longer.
+ * @param min_step_delay Fastest reliable step delay of the motor in us.
+ * @param acceleration Delay reduction per step in us. 0 = the motor starts at min_step_delay.
+ * @return unsigned long Delay in us between [min_step_delay, MIN_STEP_DELAY].
+ */
+unsigned long calculateRampDelay(unsigned long last_step_delay, unsigned int min_step_delay, unsigned int acceleration)
+{
+  if (acceleration == 0 || min_step_delay >= MIN_STEP_DELAY)
+    return min_step_delay;
+
+  if (last_step_delay > MIN_STEP_DELAY)
+    last_step_delay = MIN_STEP_DELAY;
+  if (last_step_delay < (unsigned long)min_step_delay + acceleration)
+    return min_step_delay;
+  return last_step_delay - acceleration;
+}
+
+/**
+ * @brief Calculates the delay between two steps of a continuous rotation.
+ *
+ * ```cpp
+ * calculateVelocityInterval(500);  // returns: 2000
+ * calculateVelocityInterval(-250); // returns: 4000
+ * calculateVelocityInterval(0);    // returns: 0 (no rotation)
+ * ```
+ *
+ * @param velocity Steps per second, negative means backward.
+ * @return unsigned long Delay in us, 0 if the hand does not rotate.
+ */
+unsigned long calculateVelocityInterval(int velocity)
+{
+  if (velocity == 0)
+    return 0;
+  return 1000000UL / (velocity < 0 ? -(long)velocity : velocity);
+}
+
+/**
+ * @brief Checks a bus timing received by COMMAND_TIMING.
+ *
+ * The clock pulse must be long enough to be detected and the gap must be longer than processDataInput() and the clock pulse.
+ *
+ * @param clock_out_high us, replaces CLOCK_OUT_HIGH
+ * @param frame_gap us, replaces DELAY_BETWEEN_INSTRUCTIONS
+ */
+bool isValidTiming(unsigned int clock_out_high, unsigned int frame_gap)
+{
+  return clock_out_high > 0 && frame_gap >= TIMING_MIN_FRAME_GAP && frame_gap > 2 * clock_out_high;
+}
@@ -1,7 +1,8 @@
 #ifndef _UTILS_H_
 #define _UTILS_H_
 
-#include <Arduino.h>
+#include <stddef.h> // no Arduino.h, the host libraries compile this file natively
+#include "Config.h"
 
 size_t diff(size_t start, size_t finish, bool direction);
 
@@ -9,4 +10,16 @@ size_t calculateFieldLeavePosition(size_t fieldWidth, bool direction);
 
 bool getShortestDirection(size_t from, size_t to);
 
+int toSignedPosition(size_t position);
+
+unsigned long updatePlanInterval(unsigned long plan_interval, unsigned long interval);
+
+unsigned long calculateStepDelay(unsigned long plan_interval, int planned_steps, unsigned long min_step_delay = MIN_STEP_DELAY);
+
+unsigned long calculateRampDelay(unsigned long last_step_delay, unsigned int min_step_delay, unsigned int acceleration);
+
+unsigned long calculateVelocityInterval(int velocity);
+
+bool isValidTiming(unsigned int clock_out_high, unsigned int frame_gap);
+
 #endif
\ No newline at end of file
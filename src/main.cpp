@@ -1,7 +1,43 @@
 #include <Arduino.h>
+#include <util/atomic.h>
 #include "Config.h"
+
+#ifdef CHAIN_HEAD
+#include "ChainHead.h"
+
+ChainHead head;
+
+#ifdef CHAIN_HEAD_RETURN
+void isr_return_receiving()
+{
+  head.processReturnInput();
+}
+#endif
+
+void setup()
+{
+  head.begin();
+#ifdef CHAIN_HEAD_RETURN
+  attachInterrupt(digitalPinToInterrupt(CHAIN_HEAD_IN_CLOCK), isr_return_receiving, RISING);
+#endif
+}
+
+void loop()
+{
+  head.tick();
+}
+
+#else
 #include "Calibration.h"
 #include "ClockCommunication.h"
+#include "CalibrationStorage.h"
+#include "MotorTuner.h"
+#include "TuningStorage.h"
+#include "Scheduler.h"
+#include "CommandParser.h"
+#include "MacroStorage.h"
+#include "Metrics.h"
+#include "Utils.h"
 
 Motor motor1(MOTOR_1_PIN_1, MOTOR_1_PIN_2, MOTOR_1_PIN_3, MOTOR_1_PIN_4);
 Motor motor2(MOTOR_2_PIN_1, MOTOR_2_PIN_2, MOTOR_2_PIN_3, MOTOR_2_PIN_4);
@@ -10,9 +46,20 @@ Calibration calibration1(motor1, HALL_DATA_PIN_1);
 Calibration calibration2(motor2, HALL_DATA_PIN_2);
 
 OwnInstruction ownInstruction;
+MacroStorage macroStorage;
+MacroPlayer macroPlayer;
 
 ClockCommunication comm(ownInstruction);
 
+CalibrationStorage storage;
+TuningStorage tuningStorage;
+unsigned long last_motion_millis = 0;
+
+Scheduler scheduler(micros);
+uint8_t instructionTask;
+uint8_t stepTask;
+uint8_t macroTask;
+
 /**
  * @brief Interrupt Service Routine that is called when the clock receives a tick.
  *
@@ -21,7 +68,55 @@ ClockCommunication comm(ownInstruction);
  */
 void isr_data_receiving()
 {
+#ifdef ENABLE_METRICS
+  unsigned long isr_start_micros = micros();
+  comm.processDataInput();
+  metrics.isr_duration.record(micros() - isr_start_micros);
+#else
   comm.processDataInput();
+#endif
+
+  if (ownInstruction.pending || ownInstruction.command_pending)
+  {
+    scheduler.wake(instructionTask);
+  }
+}
+
+/**
+ * @brief Interrupt Service Routine that is called when a hall sensor on port C changes.
+ *
+ * Captures the exact motor position of the field edge for the recalibration.
+ */
+ISR(PCINT1_vect)
+{
+  calibration1.captureEdge();
+  calibration2.captureEdge();
+}
+
+/**
+ * @brief Executes the started calibration or verification of both stepper motors.
+ *
+ * @return true if the calibration was successful.
+ */
+bool runCalibration()
+{
+  storage.unpark();
+  bool motor1Calibrated = false;
+  bool motor2Calibrated = false;
+  unsigned long start_millis = millis();
+  do
+  {
+    motor1Calibrated = calibration1.calibrate();
+    motor2Calibrated = calibration2.calibrate();
+
+    if (millis() - start_millis > CALIBRATION_TIMEOUT)
+    {
+      return false;
+    }
+  } while (!motor1Calibrated || !motor2Calibrated);
+
+  last_motion_millis = millis();
+  return true;
 }
 
 /**
@@ -40,23 +135,111 @@ bool calibrateMotors()
 {
   calibration1.startCalibration();
   calibration2.startCalibration();
-  bool motor1Calibrated = false;
-  bool motor2Calibrated = false;
-  size_t counter = 0;
+  return runCalibration();
+}
+
+/**
+ * @brief Restores the calibration stored in EEPROM when the clock was parked.
+ *
+ * Instead of a full search only a short verification sweep through the known field is done.
+ * Falls back to a full calibration, if the stored data is missing or does not match the hall sensors.
+ *
+ * @return true if the calibration was successful.
+ */
+bool restoreCalibration()
+{
+  StoredCalibration stored;
+  if (storage.load(stored) &&
+      calibration1.startVerification(stored.position[0], stored.field_width[0]) &&
+      calibration2.startVerification(stored.position[1], stored.field_width[1]) &&
+      runCalibration())
+  {
+    return true;
+  }
+
+  return calibrateMotors();
+}
+
+/**
+ * @brief Sets the speed limits of both motors, found by the self-test.
+ *
+ * The stored tuning is used if there is one. Otherwise (or with FORCE_MOTOR_TUNING) both motors run the self-test of MotorTuner at the same time
+ * and the result is stored in EEPROM. A motor that fails the self-test keeps MIN_STEP_DELAY and the self-test is repeated on the next startup.
+ * The self-test moves the hands, so the parked calibration is cleared and restoreCalibration() executes a full calibration.
+ */
+void tuneMotors()
+{
+  StoredTuning tuning;
+#ifndef FORCE_MOTOR_TUNING
+  if (tuningStorage.load(tuning))
+  {
+    motor1.setTuning(tuning.motor[0]);
+    motor2.setTuning(tuning.motor[1]);
+    return;
+  }
+#endif
+
+  StoredCalibration stored;
+  storage.load(stored);
+  storage.unpark();
+
+  MotorTuner tuner1(motor1, calibration1);
+  MotorTuner tuner2(motor2, calibration2);
+  tuner1.start();
+  tuner2.start();
+  bool motor1Tuned = false;
+  bool motor2Tuned = false;
   do
   {
-    motor1Calibrated = calibration1.calibrate();
-    motor2Calibrated = calibration2.calibrate();
-    counter++;
-    delayMicroseconds(MIN_STEP_DELAY);
+    motor1Tuned = tuner1.tune();
+    motor2Tuned = tuner2.tune();
+  } while (!motor1Tuned || !motor2Tuned);
+
+  if (tuner1.isSuccessful())
+    motor1.setTuning(tuner1.getResult());
+  if (tuner2.isSuccessful())
+    motor2.setTuning(tuner2.getResult());
+  if (tuner1.isSuccessful() && tuner2.isSuccessful())
+  {
+    tuning.motor[0] = motor1.getTuning();
+    tuning.motor[1] = motor2.getTuning();
+    tuningStorage.save(tuning);
+  }
+}
 
-    if (counter > MAX_STEPS * 2)
-    {
-      return false;
-    }
-  } while (!motor1Calibrated || !motor2Calibrated);
+/**
+ * @brief Stores the positions in EEPROM after both motors were idle for PARK_DELAY and no frame was received for PARK_BUS_IDLE.
+ *
+ * On the next startup the stored positions are used by restoreCalibration().
+ * The write takes PARK_WORST_CASE, a second frame received meanwhile would overwrite the unprocessed own instruction.
+ */
+void parkIfIdle()
+{
+  if (storage.isParked() || !motor1.isIdle() || !motor2.isIdle() || millis() - last_motion_millis < PARK_DELAY ||
+      comm.getMillisSinceFrame() < PARK_BUS_IDLE)
+    return;
+
+  StoredCalibration stored;
+  stored.position[0] = motor1.getCurrentPosition();
+  stored.position[1] = motor2.getCurrentPosition();
+  stored.field_width[0] = calibration1.getFieldWidth();
+  stored.field_width[1] = calibration2.getFieldWidth();
+  storage.park(stored);
+}
 
-  return true;
+/**
+ * @brief Notes that the motors move and clears the parked marker before the first step.
+ *
+ * Only one EEPROM byte is written, the hardware finishes the write by itself. The call only waits for a write still running,
+ * i.e. once if a move starts within a few ms after parking.
+ */
+void unparkIfMoving()
+{
+  if (!motor1.isIdle() || !motor2.isIdle())
+  {
+    last_motion_millis = millis();
+    storage.unpark();
+  }
 }
 
 void testCommunicationWithInstruction(Instruction &instruction, size_t clocks, size_t repeats, size_t delayBetweenClocks, size_t delayBetweenInstructions)
@@ -140,7 +323,7 @@ void testCommunication()
 
 void testMotorSpeed(size_t delay_us)
 {
-  for (size_t i = 0; i < MAX_STEPS * 6; i++)
+  for (unsigned long i = 0; i < MAX_STEPS * 6UL; i++)
   {
     motor1.stepForward();
     motor2.stepBackward();
@@ -241,9 +424,207 @@ void testRecalibration()
   }
 }
 
+/**
+ * @brief Executes a command received with CommandParser.
+ */
+void executeCommand(const Command &command)
+{
+  switch (command.code)
+  {
+  case COMMAND_VELOCITY:
+    motor1.setVelocity(getCommandByte(command, 0) * VELOCITY_UNIT);
+    motor2.setVelocity(getCommandByte(command, 1) * VELOCITY_UNIT);
+    break;
+  case COMMAND_MACRO_STORE:
+  {
+    MacroMove move;
+    move.hour_steps = getCommandWord(command, 1);
+    move.minute_steps = getCommandWord(command, 3);
+    move.frames = getCommandWord(command, 5);
+    macroStorage.storeMove(command.arguments[0], command.arguments[1], move);
+    break;
+  }
+  case COMMAND_MACRO_PLAY:
+  {
+    Macro macro;
+    if (macroStorage.load(command.arguments[0], macro))
+    {
+      macroPlayer.start(macro);
+      scheduler.wake(macroTask);
+    }
+    break;
+  }
+  case COMMAND_TIMING:
+  {
+    uint8_t clock_out_high = getCommandByte(command, 0);
+    uint16_t frame_gap = getCommandWord(command, 1);
+    if (isValidTiming(clock_out_high, frame_gap))
+    {
+      comm.setTiming(clock_out_high, frame_gap);
+    }
+    break;
+  }
+  case COMMAND_TIMING_KEEP:
+    comm.keepTiming();
+    break;
+  }
+}
+
+/**
+ * @brief Plans the steps or calibrates, for an instruction received over the bus or played from a macro.
+ *
+ * The calibration blocks the main loop for seconds, deliberately not as a task: the hands can not follow other instructions
+ * meanwhile and the frames are still passed on by the data receiving ISR, which also detects the frame gaps without tick().
+ * The own instructions received meanwhile are dropped and counted in the telemetry.
+ */
+void executeInstruction(const Instruction &instruction)
+{
+  if ((instruction.hourBackward && instruction.hourForward) || (instruction.minuteBackward && instruction.minuteForward))
+  {
+    calibrateMotors();
+    return;
+  }
+
+  // Update motor1
+  if (instruction.hourBackward)
+  {
+    motor1.planStepBackward();
+  }
+  else if (instruction.hourForward)
+  {
+    motor1.planStepForward();
+  }
+
+  // Update motor2
+  if (instruction.minuteBackward)
+  {
+    motor2.planStepBackward();
+  }
+  else if (instruction.minuteForward)
+  {
+    motor2.planStepForward();
+  }
+}
+
+/**
+ * @brief Task: Executes the command and plans the steps or calibrates for the own instruction, handed over by the data receiving ISR.
+ *
+ * Every command and every instruction except keeping still ends a playing macro.
+ */
+unsigned long processInstruction()
+{
+  if (!ownInstruction.pending && !ownInstruction.command_pending)
+  {
+    return SCHEDULER_MAX_DELAY;
+  }
+
+  if (ownInstruction.command_pending)
+  {
+    Command command;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      command = ownInstruction.command;
+      ownInstruction.command_pending = false;
+    }
+    macroPlayer.stop();
+    executeCommand(command);
+  }
+
+  if (ownInstruction.pending)
+  {
+    Instruction instruction;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      instruction = ownInstruction.data;
+      ownInstruction.pending = false; // own instruction processed
+    }
+    if (encodeInstruction(instruction) != 0)
+    {
+      macroPlayer.stop();
+    }
+    executeInstruction(instruction);
+  }
+
+  scheduler.wake(stepTask);
+  return SCHEDULER_MAX_DELAY;
+}
+
+/**
+ * @brief Task: Executes the next instruction of the playing macro every MACRO_FRAME_PERIOD. Woken by COMMAND_MACRO_PLAY.
+ */
+unsigned long playMacro()
+{
+  if (!macroPlayer.isPlaying())
+  {
+    return SCHEDULER_MAX_DELAY;
+  }
+
+  executeInstruction(decodeInstruction(macroPlayer.next()));
+  scheduler.wake(stepTask);
+  return MACRO_FRAME_PERIOD;
+}
+
+/**
+ * @brief Task: Executes the due steps of both motors.
+ *
+ * @return unsigned long Time until the next step, the deadline for all less important tasks.
+ */
+unsigned long stepMotors()
+{
+  unparkIfMoving();
+
+  motor1.tryStep();
+  motor2.tryStep();
+
+  unsigned long motor1Due = motor1.getMicrosUntilStep();
+  unsigned long motor2Due = motor2.getMicrosUntilStep();
+  return motor1Due < motor2Due ? motor1Due : motor2Due;
+}
+
+/**
+ * @brief Task: Stops passing on instructions at the end of a frame and updates the status reported in telemetry frames.
+ *
+ * Runs twice per frame gap of the current bus timing, COMMAND_TIMING may shorten it at runtime.
+ * Polls: a background task may delay it, the data receiving ISR detects the frame gaps by itself meanwhile.
+ */
+unsigned long tickCommunication()
+{
+  comm.tick();
+  comm.setTelemetry(motor1.getCurrentPosition(), motor2.getCurrentPosition(), motor1.getRecalibrations(), motor2.getRecalibrations());
+  return comm.getFrameGap() / 2;
+}
+
+/**
+ * @brief Task: Processes the field edges captured by the hall sensor interrupt. A recalibration plans steps.
+ *
+ * Polls: a background task may delay it, the background tasks only start while the motors are idle.
+ */
+unsigned long checkCalibration()
+{
+  calibration1.checkForCalibrationAfterStep();
+  calibration2.checkForCalibrationAfterStep();
+  scheduler.wake(stepTask);
+  return CALIBRATION_TASK_INTERVAL;
+}
+
+/**
+ * @brief Task: Stores the positions after the motors were idle for PARK_DELAY.
+ *
+ * Writing the EEPROM takes PARK_WORST_CASE, the scheduler only starts it when no step is due for that long.
+ */
+unsigned long parkMotors()
+{
+  parkIfIdle();
+  return PARK_TASK_INTERVAL;
+}
+
 void setup()
 {
-  calibrateMotors();
+#ifdef COIL_MODE_MICROSTEP
+  Motor::beginMicrostepping();
+#endif
+  tuneMotors();
+  restoreCalibration();
 
   // Test communication
   // testCommunication();
@@ -259,53 +640,28 @@ void setup()
   // Test recalibration
   // testRecalibration();
 
+#ifdef ENABLE_METRICS
+  metrics.begin();
+#endif
+
+  instructionTask = scheduler.add(processInstruction, PRIORITY_STEP);
+  stepTask = scheduler.add(stepMotors, PRIORITY_STEP);
+  macroTask = scheduler.add(playMacro, PRIORITY_STEP);
+  scheduler.add(tickCommunication, PRIORITY_COMM, 0, true);
+  scheduler.add(checkCalibration, PRIORITY_CALIBRATION, 0, true);
+  scheduler.add(parkMotors, PRIORITY_BACKGROUND, PARK_WORST_CASE);
+
   // ISR for Data Input
   attachInterrupt(digitalPinToInterrupt(COMM_IN_CLOCK), isr_data_receiving, RISING);
 }
 
 void loop()
 {
+#ifdef ENABLE_METRICS
+  metrics.recordLoop();
+#endif
 
-  if (ownInstruction.pending)
-  {
-    // Read own instruction and update motors
-    if ((ownInstruction.data.hourBackward && ownInstruction.data.hourForward) || (ownInstruction.data.minuteBackward && ownInstruction.data.minuteForward))
-    {
-      calibrateMotors();
-    }
-    else
-    {
-      // Update motor1
-      if (ownInstruction.data.hourBackward)
-      {
-        motor1.planStepBackward();
-      }
-      else if (ownInstruction.data.hourForward)
-      {
-        motor1.planStepForward();
-      }
-
-      // Update motor2
-      if (ownInstruction.data.minuteBackward)
-      {
-        motor2.planStepBackward();
-      }
-      else if (ownInstruction.data.minuteForward)
-      {
-        motor2.planStepForward();
-      }
-    }
-    ownInstruction.pending = false; // own instruction processed
-  }
-
-  comm.tick();
-
-  if (motor1.tryStep())
-  {
-    calibration1.checkForCalibrationAfterStep();
-  }
-  if (motor2.tryStep())
-  {
-    calibration2.checkForCalibrationAfterStep();
-  }
+  scheduler.run();
 }
+
+#endif
@@ -0,0 +1,165 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include "AnimationCompiler.h"
+
+#define TEST_CLOCKS 4
+#define TEST_STEPS 1000
+#define TEST_FRAME_PERIOD 1000
+
+// Compiles the script and reads the written animation into memory
+size_t compile(const char *source, uint8_t *buffer, size_t capacity, uint32_t *frames)
+{
+  FILE *script = tmpfile();
+  fputs(source, script);
+  rewind(script);
+
+  FILE *output = tmpfile();
+  AnimationCompiler compiler(TEST_CLOCKS, TEST_STEPS, TEST_FRAME_PERIOD);
+  AnimationWriter writer(output, TEST_CLOCKS, TEST_FRAME_PERIOD);
+  TEST_ASSERT_TRUE(writer.begin());
+  TEST_ASSERT_TRUE(compiler.compileScript(script, writer));
+  TEST_ASSERT_TRUE(writer.end());
+  *frames = writer.getFrameCount();
+
+  rewind(output);
+  size_t size = fread(buffer, 1, capacity, output);
+  fclose(script);
+  fclose(output);
+  return size;
+}
+
+void test_easing()
+{
+  Easing easings[4] = {LINEAR, EASE_IN, EASE_OUT, EASE_IN_OUT};
+  for (size_t i = 0; i < 4; i++)
+  {
+    TEST_ASSERT_FLOAT_WITHIN(0.0001, 0.0, AnimationCompiler::ease(easings[i], 0));
+    TEST_ASSERT_FLOAT_WITHIN(0.0001, 1.0, AnimationCompiler::ease(easings[i], 1));
+  }
+  TEST_ASSERT_FLOAT_WITHIN(0.0001, 0.5, AnimationCompiler::ease(EASE_IN_OUT, 0.5));
+}
+
+void test_compile_and_play()
+{
+  const char *source =
+      "# move, hold, move back\n"
+      "300 ease_in_out 36 -36 0 0 0 0 0 0\n"
+      "50 linear - - - - - - - -\n"
+      "\n"
+      "10 linear 0 0 - - - - - 18\n";
+
+  uint8_t buffer[4096];
+  uint32_t frames = 0;
+  size_t size = compile(source, buffer, sizeof(buffer), &frames);
+
+  AnimationReader reader(buffer, size);
+  TEST_ASSERT_TRUE(reader.isValid());
+  TEST_ASSERT_EQUAL(TEST_CLOCKS, reader.getClocks());
+  TEST_ASSERT_EQUAL(TEST_FRAME_PERIOD, reader.getFramePeriod());
+  TEST_ASSERT_EQUAL(frames, reader.getFrameCount());
+  // 300 frames, 50 idle frames, then 100 steps back at one step per frame
+  TEST_ASSERT_EQUAL(300 + 50 + 100, frames);
+
+  long positions[TEST_CLOCKS * 2] = {};
+  size_t idle = 0;
+  Frame frame;
+  uint32_t read = 0;
+  while (reader.next(frame))
+  {
+    idle += frame.isIdle();
+    for (size_t i = 0; i < TEST_CLOCKS * 2; i++)
+    {
+      HandInstruction instruction = frame.getHand(i / 2, (Hand)(i % 2));
+      positions[i] += instruction == HAND_FORWARD ? 1 : instruction == HAND_BACKWARD ? -1 : 0;
+    }
+    read++;
+
+    if (read == 300)
+    {
+      TEST_ASSERT_EQUAL(100, positions[0]);
+      TEST_ASSERT_EQUAL(-100, positions[1]);
+    }
+  }
+
+  TEST_ASSERT_EQUAL(frames, read);
+  TEST_ASSERT_EQUAL(300 - 100 + 50, idle); // the hands only need 100 of the first 300 frames
+  TEST_ASSERT_EQUAL(0, positions[0]);
+  TEST_ASSERT_EQUAL(0, positions[1]);
+  TEST_ASSERT_EQUAL(50, positions[7]);
+  // Idle frames are run length encoded and frames are truncated
+  TEST_ASSERT_TRUE(size < ANIMATION_HEADER_SIZE + 300 * 2 + 3 + 100 * 3);
+}
+
+void test_invalid_script()
+{
+  FILE *script = tmpfile();
+  fputs("100 bounce 0 0 0 0 0 0 0 0\n", script);
+  rewind(script);
+
+  FILE *output = tmpfile();
+  AnimationCompiler compiler(TEST_CLOCKS, TEST_STEPS, TEST_FRAME_PERIOD);
+  AnimationWriter writer(output, TEST_CLOCKS, TEST_FRAME_PERIOD);
+  writer.begin();
+  TEST_ASSERT_FALSE(compiler.compileScript(script, writer));
+  fclose(script);
+  fclose(output);
+}
+
+void test_write_error()
+{
+  FILE *script = tmpfile();
+  fputs("100 linear 90 0 0 0 0 0 0 0\n", script);
+  rewind(script);
+
+  // Read only, every write fails
+  FILE *output = fopen("/dev/null", "rb");
+  AnimationCompiler compiler(TEST_CLOCKS, TEST_STEPS, TEST_FRAME_PERIOD);
+  AnimationWriter writer(output, TEST_CLOCKS, TEST_FRAME_PERIOD);
+  writer.begin();
+  TEST_ASSERT_FALSE(compiler.compileScript(script, writer));
+  fclose(script);
+  fclose(output);
+}
+
+void test_zero_frame_period()
+{
+  Keyframe keyframe = {100, LINEAR, {}};
+  FILE *output = tmpfile();
+  AnimationCompiler compiler(TEST_CLOCKS, TEST_STEPS, 0);
+  AnimationWriter writer(output, TEST_CLOCKS, 0);
+  writer.begin();
+  TEST_ASSERT_FALSE(compiler.compileKeyframe(keyframe, writer));
+  fclose(output);
+}
+
+void test_invalid_animation()
+{
+  uint8_t data[ANIMATION_HEADER_SIZE] = {'N', 'O', 'P', 'E'};
+  AnimationReader reader(data, sizeof(data));
+  Frame frame;
+  TEST_ASSERT_FALSE(reader.isValid());
+  TEST_ASSERT_FALSE(reader.next(frame));
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_easing);
+  RUN_TEST(test_compile_and_play);
+  RUN_TEST(test_invalid_script);
+  RUN_TEST(test_write_error);
+  RUN_TEST(test_zero_frame_period);
+  RUN_TEST(test_invalid_animation);
+
+  UNITY_END();
+}
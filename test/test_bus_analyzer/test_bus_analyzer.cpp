@@ -0,0 +1,168 @@
+#include <unity.h>
+#include <stdio.h>
+#include "BusDecoder.h"
+#include "Capture.h"
+#include "Config.h"
+
+#define TEST_SAMPLE_RATE 1000000 // 1 sample per us
+#define TEST_TICK_PERIOD 20
+#define TEST_PULSE_WIDTH 5
+#define TEST_HOP_LATENCY 9
+#define TEST_FRAME_GAP 400
+
+static const uint8_t test_frames[2][3] = {{0x1, 0x2, 0x5}, {0xA, 0x0, 0x3}};
+
+class RecordingOutput : public FrameOutput
+{
+public:
+  RecordingOutput() : count(0)
+  {
+  }
+
+  bool send(const Frame &frame) override
+  {
+    if (this->count < 2)
+      this->frames[this->count] = frame;
+    this->count++;
+    return true;
+  }
+
+  Frame frames[2];
+  size_t count;
+};
+
+/**
+ * @brief Levels of the bus in a sample: clock 0, data 1 - 4, next clock 5.
+ */
+uint8_t sampleLevels(size_t sample)
+{
+  size_t frame_length = TEST_TICK_PERIOD * 3 + TEST_FRAME_GAP;
+  size_t frame = sample / frame_length;
+  size_t offset = sample % frame_length;
+  size_t tick = offset / TEST_TICK_PERIOD;
+  size_t tick_offset = offset % TEST_TICK_PERIOD;
+  if (frame >= 2 || tick >= 3)
+    return 0;
+
+  uint8_t instruction = test_frames[frame][tick];
+  uint8_t levels = ((instruction >> 3) & 1) << 1 | ((instruction >> 2) & 1) << 2 | ((instruction >> 1) & 1) << 3 | (instruction & 1) << 4;
+  if (tick_offset >= 1 && tick_offset < 1 + TEST_PULSE_WIDTH)
+    levels |= 1 << 0;
+  if (tick > 0 && tick_offset >= 1 + TEST_HOP_LATENCY && tick_offset < 1 + TEST_HOP_LATENCY + TEST_PULSE_WIDTH)
+    levels |= 1 << 5;
+  return levels;
+}
+
+size_t captureSamples()
+{
+  return 2 * (TEST_TICK_PERIOD * 3 + TEST_FRAME_GAP) + 10;
+}
+
+void decode(Capture &capture, BusDecoder &decoder)
+{
+  uint64_t time_ns;
+  uint32_t levels;
+  while (capture.next(time_ns, levels))
+    decoder.feed(time_ns, levels);
+  decoder.finish();
+}
+
+void assertReport(const BusReport &report, const RecordingOutput &output)
+{
+  TEST_ASSERT_EQUAL(2, report.frames);
+  TEST_ASSERT_EQUAL(6, report.instructions);
+  TEST_ASSERT_EQUAL(2, output.count);
+  for (size_t frame = 0; frame < 2; frame++)
+  {
+    TEST_ASSERT_EQUAL(3, output.frames[frame].getClocks());
+    for (size_t clock = 0; clock < 3; clock++)
+      TEST_ASSERT_EQUAL(test_frames[frame][clock], output.frames[frame].getInstruction(clock));
+  }
+
+  TEST_ASSERT_EQUAL(4, report.tick_period.count);
+  TEST_ASSERT_EQUAL(TEST_TICK_PERIOD * 1000, report.tick_period.mean());
+  TEST_ASSERT_EQUAL(TEST_PULSE_WIDTH * 1000, report.pulse_width.max);
+  TEST_ASSERT_EQUAL(1, report.frame_gap.count);
+  TEST_ASSERT_EQUAL((TEST_FRAME_GAP + TEST_TICK_PERIOD) * 1000, report.frame_gap.min);
+  TEST_ASSERT_EQUAL(4, report.hop_latency.count);
+  TEST_ASSERT_EQUAL(TEST_HOP_LATENCY * 1000, report.hop_latency.max);
+  TEST_ASSERT_EQUAL(0, report.short_pulses);
+  TEST_ASSERT_EQUAL(0, report.slow_ticks);
+}
+
+void test_binary_capture()
+{
+  FILE *file = tmpfile();
+  for (size_t sample = 0; sample < captureSamples(); sample++)
+    fputc(sampleLevels(sample), file);
+  rewind(file);
+
+  BinaryCapture capture;
+  capture.setSampleRate(TEST_SAMPLE_RATE);
+  TEST_ASSERT_TRUE(capture.open(file));
+
+  BusChannels channels;
+  channels.next_clock = 5;
+  RecordingOutput output;
+  BusDecoder decoder(channels, &output);
+  decode(capture, decoder);
+  assertReport(decoder.getReport(), output);
+  fclose(file);
+}
+
+void test_csv_capture()
+{
+  FILE *file = tmpfile();
+  fprintf(file, "; CSV, generated by libsigrok\n; Samplerate: 1 MHz\nclk,d1,d2,d3,d4,next\n");
+  for (size_t sample = 0; sample < captureSamples(); sample++)
+  {
+    uint8_t levels = sampleLevels(sample);
+    for (size_t channel = 0; channel < 6; channel++)
+      fprintf(file, channel == 0 ? "%d" : ",%d", (levels >> channel) & 1);
+    fprintf(file, "\n");
+  }
+  rewind(file);
+
+  CsvCapture capture;
+  TEST_ASSERT_TRUE(capture.open(file));
+
+  BusChannels channels;
+  channels.next_clock = 5;
+  RecordingOutput output;
+  BusDecoder decoder(channels, &output);
+  decode(capture, decoder);
+  TEST_ASSERT_EQUAL(TEST_SAMPLE_RATE, capture.getSampleRate());
+  assertReport(decoder.getReport(), output);
+  fclose(file);
+}
+
+void test_short_pulse()
+{
+  BusChannels channels;
+  BusDecoder decoder(channels);
+  decoder.feed(0, 0);
+  decoder.feed(1000, 1);
+  decoder.feed(1000 + (CLOCK_OUT_HIGH - 1) * 1000, 0);
+  decoder.finish();
+  TEST_ASSERT_EQUAL(1, decoder.getReport().short_pulses);
+  TEST_ASSERT_EQUAL(1, decoder.getReport().frames);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_binary_capture);
+  RUN_TEST(test_csv_capture);
+  RUN_TEST(test_short_pulse);
+
+  UNITY_END();
+}
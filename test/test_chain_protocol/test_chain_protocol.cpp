@@ -0,0 +1,351 @@
+#include <unity.h>
+#include "Frame.h"
+#include "ChainLayout.h"
+#include "FrameEncoder.h"
+#include "CommandEncoder.h"
+#include "CommandParser.h"
+#include "FrameAddressing.h"
+#include "FrameTelemetry.h"
+#include "Telemetry.h"
+#include "Instruction.h"
+#include "Config.h"
+
+void test_frame_packing()
+{
+  Frame frame(3);
+  frame.setHand(0, HOUR_HAND, HAND_BACKWARD);
+  frame.setHand(1, MINUTE_HAND, HAND_FORWARD);
+  frame.setHand(2, HOUR_HAND, HAND_CALIBRATE);
+  frame.setHand(2, MINUTE_HAND, HAND_CALIBRATE);
+
+  TEST_ASSERT_EQUAL(2, frame.getSize());
+  TEST_ASSERT_EQUAL_HEX8(0x81, frame.getData()[0]);
+  TEST_ASSERT_EQUAL_HEX8(0xF0, frame.getData()[1]);
+  TEST_ASSERT_EQUAL(HAND_BACKWARD, frame.getHand(0, HOUR_HAND));
+  TEST_ASSERT_EQUAL(HAND_STILL, frame.getHand(0, MINUTE_HAND));
+}
+
+void test_frame_matches_firmware_instruction()
+{
+  Frame frame(2);
+  frame.setHand(0, HOUR_HAND, HAND_BACKWARD);
+  frame.setHand(0, MINUTE_HAND, HAND_FORWARD);
+  frame.setHand(1, HOUR_HAND, HAND_FORWARD);
+  frame.setHand(1, MINUTE_HAND, HAND_BACKWARD);
+
+  Instruction first = decodeInstruction(frame.getInstruction(0));
+  TEST_ASSERT_TRUE(first.hourBackward);
+  TEST_ASSERT_FALSE(first.hourForward);
+  TEST_ASSERT_FALSE(first.minuteBackward);
+  TEST_ASSERT_TRUE(first.minuteForward);
+
+  Instruction second = decodeInstruction(frame.getInstruction(1));
+  TEST_ASSERT_FALSE(second.hourBackward);
+  TEST_ASSERT_TRUE(second.hourForward);
+  TEST_ASSERT_TRUE(second.minuteBackward);
+  TEST_ASSERT_FALSE(second.minuteForward);
+
+  TEST_ASSERT_EQUAL(frame.getInstruction(1), encodeInstruction(second));
+}
+
+void test_frame_serialize()
+{
+  Frame frame(CHAIN_LENGTH);
+  frame.calibrateAll();
+
+  uint8_t buffer[MAX_SERIALIZED_FRAME_BYTES];
+  TEST_ASSERT_EQUAL(CHAIN_LENGTH / 2 + 2, frame.serialize(buffer));
+  TEST_ASSERT_EQUAL_HEX8(CHAIN_HEAD_SYNC, buffer[0]);
+  TEST_ASSERT_EQUAL(CHAIN_LENGTH, buffer[1]);
+  TEST_ASSERT_EQUAL_HEX8(0xFF, buffer[CHAIN_LENGTH / 2 + 1]);
+}
+
+void test_frame_truncation()
+{
+  Frame frame(CHAIN_LENGTH);
+  uint8_t buffer[MAX_SERIALIZED_FRAME_BYTES];
+  TEST_ASSERT_TRUE(frame.isIdle());
+  TEST_ASSERT_EQUAL(0, frame.getActiveClocks());
+  TEST_ASSERT_EQUAL(0, frame.serialize(buffer));
+
+  frame.setHand(2, MINUTE_HAND, HAND_FORWARD);
+  TEST_ASSERT_EQUAL(3, frame.getActiveClocks());
+  TEST_ASSERT_EQUAL(4, frame.serialize(buffer));
+  TEST_ASSERT_EQUAL(3, buffer[1]);
+  TEST_ASSERT_EQUAL_HEX8(0x00, buffer[2]);
+  TEST_ASSERT_EQUAL_HEX8(0x10, buffer[3]);
+
+  // A complete frame keeps its zeros, the chain head receives every instruction
+  Frame data(5);
+  data.setInstruction(1, 0x4);
+  data.setComplete(true);
+  TEST_ASSERT_EQUAL(5, data.getActiveClocks());
+  size_t size = data.serialize(buffer);
+  TEST_ASSERT_EQUAL(5, buffer[1]);
+  Frame received;
+  TEST_ASSERT_TRUE(received.deserialize(buffer, size));
+  TEST_ASSERT_EQUAL(5, received.getClocks());
+  TEST_ASSERT_EQUAL(0x4, received.getInstruction(1));
+  TEST_ASSERT_EQUAL(0x0, received.getInstruction(4));
+
+  data.clear();
+  TEST_ASSERT_TRUE(data.isIdle());
+  TEST_ASSERT_EQUAL(5, data.getActiveClocks());
+  TEST_ASSERT_EQUAL(5, received.deserialize(buffer, data.serialize(buffer)) ? received.getClocks() : 0);
+}
+
+void test_encoder_steps()
+{
+  FrameEncoder encoder(CHAIN_LENGTH);
+  encoder.setSteps(0, HOUR_HAND, 3);
+  encoder.setSteps(5, MINUTE_HAND, -5);
+  encoder.setSteps(CHAIN_LENGTH - 1, HOUR_HAND, 1);
+  TEST_ASSERT_EQUAL(5, encoder.getRemainingFrames());
+
+  Frame frames[10];
+  TEST_ASSERT_EQUAL(5, encoder.encode(frames, 10));
+  TEST_ASSERT_FALSE(encoder.hasNextFrame());
+
+  // Replay the frames like the clocks do
+  long steps[CHAIN_LENGTH][2] = {};
+  for (size_t i = 0; i < 5; i++)
+  {
+    for (size_t clock = 0; clock < CHAIN_LENGTH; clock++)
+    {
+      Instruction instruction = decodeInstruction(frames[i].getInstruction(clock));
+      steps[clock][0] += instruction.hourForward - instruction.hourBackward;
+      steps[clock][1] += instruction.minuteForward - instruction.minuteBackward;
+    }
+  }
+  TEST_ASSERT_EQUAL(3, steps[0][0]);
+  TEST_ASSERT_EQUAL(-5, steps[5][1]);
+  TEST_ASSERT_EQUAL(1, steps[CHAIN_LENGTH - 1][0]);
+  TEST_ASSERT_EQUAL(0, steps[1][0]);
+  TEST_ASSERT_TRUE(frames[4].getHand(0, HOUR_HAND) == HAND_STILL);
+}
+
+void test_encoder_limited_capacity()
+{
+  FrameEncoder encoder(2);
+  encoder.setSteps(1, HOUR_HAND, 4);
+
+  Frame frames[3];
+  TEST_ASSERT_EQUAL(3, encoder.encode(frames, 3));
+  TEST_ASSERT_EQUAL(1, encoder.getSteps(1, HOUR_HAND));
+  TEST_ASSERT_TRUE(encoder.hasNextFrame());
+}
+
+void test_command_matches_firmware_parser()
+{
+  TEST_ASSERT_EQUAL(COMMAND_ESCAPE, FRAME_COMMAND_ESCAPE);
+  TEST_ASSERT_EQUAL(COMMAND_VELOCITY, FRAME_COMMAND_VELOCITY);
+
+  CommandEncoder encoder(3);
+  encoder.setVelocity(1, -2, 100);
+  Frame frames[MAX_COMMAND_FRAMES];
+  size_t length = 2 + getCommandLength(COMMAND_VELOCITY); // escape, code and arguments
+  TEST_ASSERT_EQUAL(length, encoder.encode(frames, MAX_COMMAND_FRAMES));
+  TEST_ASSERT_FALSE(encoder.hasNextFrame());
+
+  CommandParser parser;
+  for (size_t i = 0; i < length; i++)
+  {
+    TEST_ASSERT_EQUAL(HAND_STILL, frames[i].getInstruction(0));
+    TEST_ASSERT_FALSE(parser.isComplete());
+    TEST_ASSERT_TRUE(parser.receive(frames[i].getInstruction(1)));
+  }
+  TEST_ASSERT_TRUE(parser.isComplete());
+  TEST_ASSERT_EQUAL(COMMAND_VELOCITY, parser.getCommand().code);
+  TEST_ASSERT_EQUAL(-2, getCommandByte(parser.getCommand(), 0));
+  TEST_ASSERT_EQUAL(100, getCommandByte(parser.getCommand(), 1));
+
+  // Step instructions are not consumed, an unknown command code ends the command
+  TEST_ASSERT_FALSE(parser.receive(HAND_FORWARD));
+  TEST_ASSERT_TRUE(parser.receive(COMMAND_ESCAPE));
+  TEST_ASSERT_TRUE(parser.receive(0xE));
+  TEST_ASSERT_FALSE(parser.isComplete());
+  TEST_ASSERT_FALSE(parser.receive(HAND_FORWARD));
+}
+
+void test_macro_command()
+{
+  TEST_ASSERT_EQUAL(COMMAND_MACRO_STORE, FRAME_COMMAND_MACRO_STORE);
+  TEST_ASSERT_EQUAL(COMMAND_MACRO_PLAY, FRAME_COMMAND_MACRO_PLAY);
+  TEST_ASSERT_TRUE(2 + COMMAND_MAX_ARGUMENTS <= MAX_COMMAND_FRAMES);
+
+  CommandEncoder encoder(1);
+  encoder.storeMacroMove(0, 5, 2, -300, 1234, 40000);
+  Frame frames[MAX_COMMAND_FRAMES];
+  size_t count = encoder.encode(frames, MAX_COMMAND_FRAMES);
+  TEST_ASSERT_EQUAL(2 + getCommandLength(COMMAND_MACRO_STORE), count);
+
+  CommandParser parser;
+  for (size_t i = 0; i < count; i++)
+    TEST_ASSERT_TRUE(parser.receive(frames[i].getInstruction(0)));
+  TEST_ASSERT_TRUE(parser.isComplete());
+  const Command &command = parser.getCommand();
+  TEST_ASSERT_EQUAL(5, command.arguments[0]);
+  TEST_ASSERT_EQUAL(2, command.arguments[1]);
+  TEST_ASSERT_EQUAL(-300, getCommandWord(command, 1));
+  TEST_ASSERT_EQUAL(1234, getCommandWord(command, 3));
+  TEST_ASSERT_EQUAL(40000, (uint16_t)getCommandWord(command, 5));
+}
+
+void test_timing_command()
+{
+  TEST_ASSERT_EQUAL(COMMAND_TIMING, FRAME_COMMAND_TIMING);
+  TEST_ASSERT_EQUAL(COMMAND_TIMING_KEEP, FRAME_COMMAND_TIMING_KEEP);
+
+  CommandEncoder encoder(2);
+  encoder.setTiming(0, 3, 180);
+  encoder.keepTiming(1);
+  Frame frames[MAX_COMMAND_FRAMES];
+  size_t count = encoder.encode(frames, MAX_COMMAND_FRAMES);
+  TEST_ASSERT_EQUAL(2 + getCommandLength(COMMAND_TIMING), count);
+
+  CommandParser timing;
+  CommandParser keep;
+  for (size_t i = 0; i < count; i++)
+  {
+    TEST_ASSERT_TRUE(timing.receive(frames[i].getInstruction(0)));
+    if (i < 2)
+      TEST_ASSERT_TRUE(keep.receive(frames[i].getInstruction(1)));
+    else
+      TEST_ASSERT_EQUAL(HAND_STILL, frames[i].getInstruction(1));
+  }
+  TEST_ASSERT_TRUE(timing.isComplete());
+  TEST_ASSERT_EQUAL(3, getCommandByte(timing.getCommand(), 0));
+  TEST_ASSERT_EQUAL(180, getCommandWord(timing.getCommand(), 1));
+  TEST_ASSERT_TRUE(keep.isComplete());
+  TEST_ASSERT_EQUAL(COMMAND_TIMING_KEEP, keep.getCommand().code);
+}
+
+void test_addressed_frame()
+{
+  TEST_ASSERT_EQUAL(FRAME_ADDRESSED, FRAME_MARKER_ADDRESSED);
+  TEST_ASSERT_EQUAL(FRAME_ENUMERATION, FRAME_MARKER_ENUMERATION);
+  TEST_ASSERT_EQUAL(ADDRESS_BROADCAST, FRAME_ADDRESS_BROADCAST);
+
+  Frame frame(24);
+  frame.setHand(3, HOUR_HAND, HAND_FORWARD);
+  frame.setHand(20, MINUTE_HAND, HAND_BACKWARD);
+  Frame addressed;
+  TEST_ASSERT_TRUE(encodeAddressed(frame, addressed));
+  TEST_ASSERT_EQUAL(7, addressed.getClocks());
+  const uint8_t expected[7] = {FRAME_ADDRESSED, 0x0, 0x3, 0x4, 0x1, 0x4, 0x2};
+  for (size_t i = 0; i < 7; i++)
+    TEST_ASSERT_EQUAL(expected[i], addressed.getInstruction(i));
+
+  // Zero indexes are sent, the frame is not truncated
+  addAddressedInstruction(addressed, 0, HAND_STILL);
+  TEST_ASSERT_EQUAL(10, addressed.getActiveClocks());
+
+  // Not shorter: sent as it is
+  frame.clear();
+  frame.setHand(0, HOUR_HAND, HAND_FORWARD);
+  frame.setHand(2, HOUR_HAND, HAND_FORWARD);
+  TEST_ASSERT_FALSE(encodeAddressed(frame, addressed));
+  TEST_ASSERT_FALSE(encodeAddressed(frame, addressed));
+  TEST_ASSERT_FALSE(encodeAddressed(Frame(24), addressed));
+}
+
+void test_enumeration_frame()
+{
+  Frame frame;
+  encodeEnumeration(frame);
+  TEST_ASSERT_EQUAL(3, frame.getActiveClocks());
+
+  // Read back behind a chain of 31 clocks: every clock incremented the counter, the lower nibble first
+  frame.setInstruction(1, 0xF);
+  frame.setInstruction(2, 0x1);
+  size_t clocks;
+  TEST_ASSERT_TRUE(decodeEnumeration(frame, clocks));
+  TEST_ASSERT_EQUAL(31, clocks);
+  TEST_ASSERT_FALSE(decodeEnumeration(Frame(3), clocks));
+}
+
+void test_telemetry_matches_firmware()
+{
+  TEST_ASSERT_EQUAL(FRAME_TELEMETRY, FRAME_MARKER_TELEMETRY);
+  TEST_ASSERT_EQUAL(TELEMETRY_NIBBLES, FRAME_TELEMETRY_NIBBLES);
+
+  Frame frame;
+  encodeTelemetryRequest(frame, 0x12, 2);
+  TEST_ASSERT_EQUAL(3 + 2 * TELEMETRY_NIBBLES, frame.getActiveClocks());
+  TEST_ASSERT_EQUAL(0x1, frame.getInstruction(1));
+  TEST_ASSERT_EQUAL(0x2, frame.getInstruction(2));
+
+  // The second polled clock writes its record like ClockCommunication
+  Telemetry telemetry = {{3413, 1234}, {2, 15}, 0xA7};
+  for (uint8_t i = 0; i < TELEMETRY_NIBBLES; i++)
+    frame.setInstruction(3 + TELEMETRY_NIBBLES + i, getTelemetryNibble(telemetry, i));
+
+  ClockTelemetry decoded;
+  TEST_ASSERT_TRUE(decodeTelemetry(frame, 1, decoded));
+  TEST_ASSERT_EQUAL(3413, decoded.positions[HOUR_HAND]);
+  TEST_ASSERT_EQUAL(1234, decoded.positions[MINUTE_HAND]);
+  TEST_ASSERT_EQUAL(2, decoded.recalibrations[HOUR_HAND]);
+  TEST_ASSERT_EQUAL(15, decoded.recalibrations[MINUTE_HAND]);
+  TEST_ASSERT_EQUAL(0xA7, decoded.dropped_instructions);
+  TEST_ASSERT_TRUE(decodeTelemetry(frame, 0, decoded));
+  TEST_ASSERT_EQUAL(0, decoded.positions[HOUR_HAND]);
+  TEST_ASSERT_FALSE(decodeTelemetry(frame, 2, decoded));
+}
+
+void test_chain_layout()
+{
+  ChainLayout layout(CHAIN_LENGTH + 1, 3);
+  TEST_ASSERT_EQUAL(3, layout.getChains());
+  TEST_ASSERT_EQUAL(CHAIN_LENGTH + 1, layout.getClocks());
+  TEST_ASSERT_EQUAL(CHAIN_LENGTH / 3 + 1, layout.getLength(0));
+  TEST_ASSERT_EQUAL(CHAIN_LENGTH / 3, layout.getLength(2));
+  TEST_ASSERT_EQUAL(2 * CHAIN_LENGTH / 3 + 1, layout.getOffset(2));
+
+  Frame frame(CHAIN_LENGTH + 1);
+  frame.setHand(0, HOUR_HAND, HAND_FORWARD);
+  frame.setHand(layout.getOffset(1), MINUTE_HAND, HAND_BACKWARD);
+  frame.setHand(CHAIN_LENGTH, HOUR_HAND, HAND_CALIBRATE);
+
+  Frame chains[MAX_CHAINS];
+  layout.split(frame, chains);
+  TEST_ASSERT_EQUAL(1, chains[0].getActiveClocks());
+  TEST_ASSERT_TRUE(chains[1].getHand(0, MINUTE_HAND) == HAND_BACKWARD);
+  TEST_ASSERT_TRUE(chains[2].getHand(layout.getLength(2) - 1, HOUR_HAND) == HAND_CALIBRATE);
+
+  Frame merged;
+  layout.merge(chains, merged);
+  TEST_ASSERT_EQUAL(frame.getClocks(), merged.getClocks());
+  for (size_t clock = 0; clock < frame.getClocks(); clock++)
+  {
+    TEST_ASSERT_EQUAL(frame.getInstruction(clock), merged.getInstruction(clock));
+  }
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_frame_packing);
+  RUN_TEST(test_frame_matches_firmware_instruction);
+  RUN_TEST(test_frame_serialize);
+  RUN_TEST(test_frame_truncation);
+  RUN_TEST(test_encoder_steps);
+  RUN_TEST(test_encoder_limited_capacity);
+  RUN_TEST(test_command_matches_firmware_parser);
+  RUN_TEST(test_macro_command);
+  RUN_TEST(test_timing_command);
+  RUN_TEST(test_addressed_frame);
+  RUN_TEST(test_enumeration_frame);
+  RUN_TEST(test_telemetry_matches_firmware);
+  RUN_TEST(test_chain_layout);
+
+  UNITY_END();
+}
@@ -0,0 +1,190 @@
+#include <unity.h>
+#include "ChainTuner.h"
+#include "DigitalTwin.h"
+#include "Config.h"
+
+#define TEST_CLOCKS 12
+#define TEST_MIN_TICK_PERIOD 12  // us, the chain corrupts frames below these limits
+#define TEST_MIN_CLOCK_OUT_HIGH 2 // us
+#define TEST_MIN_FRAME_GAP 120   // us, of the clocks
+
+// Loops the twin back to the host and corrupts the frames if the host or a clock uses a timing too fast for the wall.
+// The twin receives the frames as a real output transmits them (DigitalTwin::send()), so the timing commands must survive serialize().
+class LimitedChain : public FrameOutput
+{
+public:
+  LimitedChain(DigitalTwin &twin) : twin(twin), corrupted(0)
+  {
+  }
+
+  bool send(const Frame &frame) override
+  {
+    if (this->isReliable())
+      return this->twin.send(frame);
+
+    // The first clock still reads its instruction, the instructions it passes on are broken
+    Frame broken = frame;
+    for (size_t i = 1; i < broken.getClocks(); i++)
+      broken.setInstruction(i, broken.getInstruction(i) ^ 0x4);
+    this->corrupted++;
+    return this->twin.send(broken);
+  }
+
+  bool receive(Frame &frame, unsigned int timeout_ms) override
+  {
+    return this->twin.receive(frame, timeout_ms);
+  }
+
+  bool setTiming(const ChainTiming &timing) override
+  {
+    if (!timing.isValid())
+      return false;
+    this->timing = timing;
+    return true;
+  }
+
+  uint32_t getReturnLatency() override
+  {
+    return this->timing.getLatencyMicros(TEST_CLOCKS);
+  }
+
+  bool isReliable() const
+  {
+    if (this->timing.tick_period < TEST_MIN_TICK_PERIOD || this->timing.clock_out_high < TEST_MIN_CLOCK_OUT_HIGH)
+      return false;
+    for (size_t clock = 0; clock < TEST_CLOCKS; clock++)
+    {
+      const TwinTiming &timing = this->twin.getTiming(clock);
+      if (timing.clock_out_high < TEST_MIN_CLOCK_OUT_HIGH || timing.frame_gap < TEST_MIN_FRAME_GAP || timing.frame_gap >= this->timing.frame_gap)
+        return false;
+    }
+    return true;
+  }
+
+  DigitalTwin &twin;
+  ChainTiming timing;
+  size_t corrupted;
+};
+
+// Waits in simulated time
+class TwinTuner : public ChainTuner
+{
+public:
+  TwinTuner(LimitedChain &chain) : ChainTuner(chain), twin(chain.twin)
+  {
+  }
+
+protected:
+  void wait(unsigned int ms) override
+  {
+    this->twin.advance(ms * 1000ULL);
+  }
+
+private:
+  DigitalTwin &twin;
+};
+
+void test_finds_fastest_timing()
+{
+  DigitalTwin twin(TEST_CLOCKS, 0);
+  LimitedChain chain(twin);
+  TwinTuner tuner(chain);
+  TEST_ASSERT_TRUE(tuner.tune());
+
+  // One step slower than the limits
+  const ChainTunerReport &report = tuner.getReport();
+  TEST_ASSERT_EQUAL(TEST_CLOCKS, report.clocks);
+  TEST_ASSERT_EQUAL(TEST_MIN_TICK_PERIOD + TUNER_TICK_STEP, report.timing.tick_period);
+  TEST_ASSERT_EQUAL(TEST_MIN_CLOCK_OUT_HIGH + 1, report.timing.clock_out_high);
+  TEST_ASSERT_EQUAL(TEST_MIN_FRAME_GAP + TUNER_GAP_STEP, report.clock_frame_gap);
+  TEST_ASSERT_EQUAL(report.clock_frame_gap + TUNER_GAP_MARGIN, report.timing.frame_gap);
+  TEST_ASSERT_EQUAL(report.timing.getLatencyMicros(TEST_CLOCKS), report.max_latency);
+  TEST_ASSERT_TRUE(report.corrupted_frames > 0);
+  TEST_ASSERT_TRUE(report.disturbed);
+  TEST_ASSERT_EQUAL(report.timing.tick_period, chain.timing.tick_period);
+  TEST_ASSERT_EQUAL(report.timing.frame_gap, chain.timing.frame_gap);
+
+  // The clocks kept the tuned timing and did not revert it
+  twin.advance(2 * TIMING_TRIAL_PERIOD * 1000ULL);
+  for (size_t clock = 0; clock < TEST_CLOCKS; clock++)
+  {
+    TEST_ASSERT_EQUAL(report.timing.clock_out_high, twin.getTiming(clock).clock_out_high);
+    TEST_ASSERT_EQUAL(report.clock_frame_gap, twin.getTiming(clock).frame_gap);
+    TEST_ASSERT_FALSE(twin.getTiming(clock).trial);
+  }
+  TEST_ASSERT_TRUE(chain.isReliable());
+
+  // The chain still works with the tuned timing
+  size_t corrupted = chain.corrupted;
+  Frame frame(TEST_CLOCKS);
+  frame.setHand(TEST_CLOCKS - 1, MINUTE_HAND, HAND_FORWARD);
+  chain.send(frame);
+  twin.settle();
+  TEST_ASSERT_EQUAL(corrupted, chain.corrupted);
+  TEST_ASSERT_EQUAL(1, twin.getPosition(TEST_CLOCKS - 1, MINUTE_HAND));
+}
+
+void test_reverts_unkept_timing()
+{
+  DigitalTwin twin(TEST_CLOCKS, 0);
+  CommandEncoder encoder(TEST_CLOCKS);
+  encoder.setTiming(0, 2, 100);
+  encoder.setTiming(1, 0, 100); // invalid, ignored
+  Frame frame;
+  while (encoder.hasNextFrame())
+  {
+    encoder.nextFrame(frame);
+    twin.send(frame);
+  }
+  TEST_ASSERT_EQUAL(2, twin.getTiming(0).clock_out_high);
+  TEST_ASSERT_EQUAL(100, twin.getTiming(0).frame_gap);
+  TEST_ASSERT_EQUAL(CLOCK_OUT_HIGH, twin.getTiming(1).clock_out_high);
+
+  twin.advance(TIMING_TRIAL_PERIOD * 1000ULL);
+  TEST_ASSERT_EQUAL(CLOCK_OUT_HIGH, twin.getTiming(0).clock_out_high);
+  TEST_ASSERT_EQUAL(DELAY_BETWEEN_INSTRUCTIONS, twin.getTiming(0).frame_gap);
+}
+
+void test_needs_loopback()
+{
+  // Plays the frames, but nothing is read back
+  DigitalTwin twin(TEST_CLOCKS, 0);
+  class OpenChain : public FrameOutput
+  {
+  public:
+    bool send(const Frame &frame) override
+    {
+      return true;
+    }
+    bool setTiming(const ChainTiming &timing) override
+    {
+      return true;
+    }
+  } open_chain;
+  ChainTuner open_tuner(open_chain);
+  TEST_ASSERT_FALSE(open_tuner.tune());
+  TEST_ASSERT_EQUAL(0, open_tuner.getReport().clocks);
+
+  // Returns the frames, but the timing can not be changed
+  ChainTuner fixed_tuner(twin);
+  TEST_ASSERT_FALSE(fixed_tuner.tune());
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_finds_fastest_timing);
+  RUN_TEST(test_reverts_unkept_timing);
+  RUN_TEST(test_needs_loopback);
+
+  UNITY_END();
+}
@@ -0,0 +1,378 @@
+#include <unity.h>
+#include "DigitalTwin.h"
+#include "MotionPlanner.h"
+#include "CommandEncoder.h"
+#include "FrameTelemetry.h"
+#include "Config.h"
+
+#define TEST_CLOCKS 4
+
+void sendSteps(DigitalTwin &twin, size_t clock, Hand hand, HandInstruction instruction, size_t frames)
+{
+  Frame frame(TEST_CLOCKS);
+  frame.setHand(clock, hand, instruction);
+  for (size_t i = 0; i < frames; i++)
+    twin.send(frame);
+}
+
+void test_follows_frames()
+{
+  DigitalTwin twin(TEST_CLOCKS, 2 * MIN_STEP_DELAY);
+  sendSteps(twin, 1, MINUTE_HAND, HAND_FORWARD, 100);
+  sendSteps(twin, 2, HOUR_HAND, HAND_BACKWARD, 10);
+
+  TEST_ASSERT_EQUAL(100, twin.getPosition(1, MINUTE_HAND));
+  TEST_ASSERT_EQUAL(0, twin.getPosition(1, HOUR_HAND));
+  TEST_ASSERT_EQUAL(MAX_STEPS - 10, twin.getPosition(2, HOUR_HAND));
+  TEST_ASSERT_TRUE(twin.isSettled());
+}
+
+void test_step_rate_limit()
+{
+  // Frames faster than MIN_STEP_DELAY pile up planned steps in the motor
+  DigitalTwin twin(TEST_CLOCKS, MIN_STEP_DELAY / 2);
+  sendSteps(twin, 0, HOUR_HAND, HAND_FORWARD, 100);
+  TEST_ASSERT_TRUE(twin.getPlannedSteps(0, HOUR_HAND) >= 49);
+  TEST_ASSERT_EQUAL(100, twin.getPosition(0, HOUR_HAND) + twin.getPlannedSteps(0, HOUR_HAND));
+
+  uint16_t positions[TEST_CLOCKS * 2];
+  twin.getPositions(positions);
+  TEST_ASSERT_EQUAL(100, positions[0]);
+
+  twin.settle();
+  TEST_ASSERT_EQUAL(100, twin.getPosition(0, HOUR_HAND));
+}
+
+void test_step_pacing()
+{
+  // Slow instructions: every step is spread over the interval instead of a step and a pause
+  DigitalTwin twin(TEST_CLOCKS, 4 * MIN_STEP_DELAY);
+  sendSteps(twin, 0, HOUR_HAND, HAND_FORWARD, 20);
+  TEST_ASSERT_TRUE(twin.getPlannedSteps(0, HOUR_HAND) <= 1);
+  TEST_ASSERT_TRUE(twin.getPosition(0, HOUR_HAND) >= 19);
+
+  twin.settle();
+  TEST_ASSERT_EQUAL(20, twin.getPosition(0, HOUR_HAND));
+}
+
+void test_tuned_motor()
+{
+  // Both hands get more steps than they can execute, the tuned hand accelerates beyond MIN_STEP_DELAY
+  DigitalTwin twin(TEST_CLOCKS, MIN_STEP_DELAY / 4);
+  twin.setTuning(1, MINUTE_HAND, MIN_STEP_DELAY / 2, 20);
+  Frame frame(TEST_CLOCKS);
+  frame.setHand(1, HOUR_HAND, HAND_FORWARD);
+  frame.setHand(1, MINUTE_HAND, HAND_FORWARD);
+  for (size_t i = 0; i < 400; i++)
+    twin.send(frame);
+
+  TEST_ASSERT_TRUE(twin.getPosition(1, MINUTE_HAND) > twin.getPosition(1, HOUR_HAND) + 50);
+  TEST_ASSERT_TRUE(twin.getPosition(1, MINUTE_HAND) <= 400 * (MIN_STEP_DELAY / 4) / (MIN_STEP_DELAY / 2) + 1);
+
+  twin.settle();
+  TEST_ASSERT_EQUAL(400, twin.getPosition(1, MINUTE_HAND));
+  TEST_ASSERT_EQUAL(400, twin.getPosition(1, HOUR_HAND));
+}
+
+void test_calibration()
+{
+  DigitalTwin twin(TEST_CLOCKS, 1000);
+  sendSteps(twin, 3, HOUR_HAND, HAND_FORWARD, 500);
+
+  Frame frame(TEST_CLOCKS);
+  frame.setHand(3, MINUTE_HAND, HAND_CALIBRATE);
+  twin.send(frame);
+  TEST_ASSERT_TRUE(twin.isCalibrating(3));
+  TEST_ASSERT_EQUAL(0, twin.getPosition(3, HOUR_HAND));
+
+  // Only the last instruction received while calibrating is executed
+  sendSteps(twin, 3, HOUR_HAND, HAND_FORWARD, 5);
+  twin.settle();
+  TEST_ASSERT_EQUAL(1, twin.getPosition(3, HOUR_HAND));
+}
+
+void test_recalibration_after_lost_steps()
+{
+  DigitalTwin twin(TEST_CLOCKS, 2 * MIN_STEP_DELAY);
+
+  // The first field after the calibration is ignored
+  sendSteps(twin, 0, MINUTE_HAND, HAND_FORWARD, MAX_STEPS + 200);
+  TEST_ASSERT_EQUAL(0, twin.getRecalibrations(0, MINUTE_HAND));
+
+  twin.loseSteps(0, MINUTE_HAND, 40);
+  TEST_ASSERT_EQUAL(200, twin.getPosition(0, MINUTE_HAND));
+  TEST_ASSERT_EQUAL(160, twin.getPhysicalPosition(0, MINUTE_HAND));
+
+  sendSteps(twin, 0, MINUTE_HAND, HAND_FORWARD, MAX_STEPS);
+  twin.settle();
+  TEST_ASSERT_EQUAL(1, twin.getRecalibrations(0, MINUTE_HAND));
+  TEST_ASSERT_EQUAL(200, twin.getPosition(0, MINUTE_HAND));
+  TEST_ASSERT_EQUAL(200, twin.getPhysicalPosition(0, MINUTE_HAND));
+}
+
+void test_recalibrations_wrap()
+{
+  DigitalTwin twin(TEST_CLOCKS, 2 * MIN_STEP_DELAY);
+  sendSteps(twin, 0, MINUTE_HAND, HAND_FORWARD, MAX_STEPS + 200);
+  for (size_t i = 0; i < 17; i++)
+  {
+    twin.loseSteps(0, MINUTE_HAND, 40);
+    sendSteps(twin, 0, MINUTE_HAND, HAND_FORWARD, MAX_STEPS);
+    twin.settle();
+  }
+  TEST_ASSERT_EQUAL(17, twin.getRecalibrations(0, MINUTE_HAND));
+
+  // Reported in one nibble, like the clock does
+  Telemetry telemetry;
+  twin.getTelemetry(0, telemetry);
+  TEST_ASSERT_EQUAL(1, telemetry.recalibrations[MINUTE_HAND]);
+  TEST_ASSERT_EQUAL(1, getTelemetryNibble(telemetry, 8 + MINUTE_HAND));
+}
+
+void test_speed_governor()
+{
+  DigitalTwin twin(TEST_CLOCKS, MIN_STEP_DELAY / 4);
+  twin.setTuning(0, MINUTE_HAND, MIN_STEP_DELAY / 2, 20);
+  sendSteps(twin, 0, MINUTE_HAND, HAND_FORWARD, MAX_STEPS + 200);
+  twin.settle();
+
+  // Lost steps derate the motor
+  twin.loseSteps(0, MINUTE_HAND, 40);
+  sendSteps(twin, 0, MINUTE_HAND, HAND_FORWARD, MAX_STEPS);
+  twin.settle();
+  TEST_ASSERT_EQUAL(1, twin.getRecalibrations(0, MINUTE_HAND));
+  TEST_ASSERT_EQUAL(MIN_STEP_DELAY / 2 + GOVERNOR_DERATE, twin.getMinStepDelay(0, MINUTE_HAND));
+
+  // Clean crossings at the derated speed speed it up again
+  sendSteps(twin, 0, MINUTE_HAND, HAND_FORWARD, (size_t)MAX_STEPS * GOVERNOR_PROBE_CROSSINGS);
+  twin.settle();
+  TEST_ASSERT_EQUAL(MIN_STEP_DELAY / 2 + GOVERNOR_DERATE - GOVERNOR_PROBE_STEP, twin.getMinStepDelay(0, MINUTE_HAND));
+  TEST_ASSERT_EQUAL(200, twin.getPosition(0, MINUTE_HAND));
+}
+
+void test_velocity_command()
+{
+  DigitalTwin twin(TEST_CLOCKS, 2 * MIN_STEP_DELAY);
+  CommandEncoder encoder(TEST_CLOCKS);
+  encoder.setVelocity(2, 10, -5);
+  Frame frame;
+  while (encoder.hasNextFrame())
+  {
+    encoder.nextFrame(frame);
+    twin.send(frame);
+  }
+
+  // The clock generates the steps without further frames
+  twin.advance(1000000 - 2 * MIN_STEP_DELAY);
+  TEST_ASSERT_INT_WITHIN(1, 10 * VELOCITY_UNIT, twin.getPosition(2, HOUR_HAND));
+  TEST_ASSERT_INT_WITHIN(1, MAX_STEPS - 5 * VELOCITY_UNIT, twin.getPosition(2, MINUTE_HAND));
+  TEST_ASSERT_EQUAL(0, twin.getPosition(1, HOUR_HAND));
+  TEST_ASSERT_TRUE(twin.isSettled());
+
+  // A step instruction ends the rotation of its hand, the other hand keeps rotating
+  sendSteps(twin, 2, HOUR_HAND, HAND_BACKWARD, 1);
+  uint16_t hour = twin.getPosition(2, HOUR_HAND);
+  uint16_t minute = twin.getPosition(2, MINUTE_HAND);
+  twin.advance(1000000);
+  TEST_ASSERT_EQUAL(hour, twin.getPosition(2, HOUR_HAND));
+  TEST_ASSERT_INT_WITHIN(1, minute - 5 * VELOCITY_UNIT, twin.getPosition(2, MINUTE_HAND));
+}
+
+void sendCommands(DigitalTwin &twin, CommandEncoder &encoder)
+{
+  Frame frame;
+  while (encoder.hasNextFrame())
+  {
+    encoder.nextFrame(frame);
+    twin.send(frame);
+  }
+  encoder.clear();
+}
+
+void test_macro()
+{
+  DigitalTwin twin(TEST_CLOCKS, 2 * MIN_STEP_DELAY);
+  CommandEncoder encoder(TEST_CLOCKS);
+  encoder.storeMacroMove(1, 3, 0, 100, -50, 200);
+  sendCommands(twin, encoder);
+  encoder.storeMacroMove(1, 3, 1, -100, 0, 0);
+  sendCommands(twin, encoder);
+
+  // Broadcast: clocks without the macro ignore the command
+  for (size_t clock = 0; clock < TEST_CLOCKS; clock++)
+    encoder.playMacro(clock, 3);
+  sendCommands(twin, encoder);
+  twin.advance(100 * MACRO_FRAME_PERIOD);
+  TEST_ASSERT_INT_WITHIN(2, 50, twin.getPosition(1, HOUR_HAND));
+  TEST_ASSERT_INT_WITHIN(2, MAX_STEPS - 25, twin.getPosition(1, MINUTE_HAND));
+  TEST_ASSERT_FALSE(twin.isSettled());
+
+  twin.settle();
+  TEST_ASSERT_EQUAL(0, twin.getPosition(1, HOUR_HAND));
+  TEST_ASSERT_EQUAL(MAX_STEPS - 50, twin.getPosition(1, MINUTE_HAND));
+  TEST_ASSERT_EQUAL(0, twin.getPosition(2, HOUR_HAND));
+
+  // A step instruction ends the macro
+  encoder.playMacro(1, 3);
+  sendCommands(twin, encoder);
+  twin.advance(10 * MACRO_FRAME_PERIOD);
+  sendSteps(twin, 1, MINUTE_HAND, HAND_FORWARD, 1);
+  twin.settle();
+  TEST_ASSERT_INT_WITHIN(2, 5, twin.getPosition(1, HOUR_HAND));
+}
+
+void test_marker_arguments_while_busy()
+{
+  // The first clock calibrates and processes the command much later, its arguments 0x7 still do not mark the frames
+  DigitalTwin twin(TEST_CLOCKS, 2 * MIN_STEP_DELAY);
+  Frame calibrate(1);
+  calibrate.setHand(0, HOUR_HAND, HAND_CALIBRATE);
+  twin.send(calibrate);
+  TEST_ASSERT_TRUE(twin.isCalibrating(0));
+
+  CommandEncoder encoder(TEST_CLOCKS);
+  encoder.setVelocity(0, 0x77, 0x77);
+  encoder.setVelocity(1, 1, 0);
+  sendCommands(twin, encoder);
+  TEST_ASSERT_TRUE(twin.isCalibrating(0));
+
+  twin.advance(1000000);
+  TEST_ASSERT_INT_WITHIN(1, VELOCITY_UNIT, twin.getPosition(1, HOUR_HAND));
+}
+
+void test_command_while_busy()
+{
+  // Step instructions received while calibrating are dropped, the command is still executed with its own arguments
+  DigitalTwin twin(TEST_CLOCKS, 2 * MIN_STEP_DELAY);
+  Frame calibrate(1);
+  calibrate.setHand(0, HOUR_HAND, HAND_CALIBRATE);
+  twin.send(calibrate);
+
+  CommandEncoder encoder(TEST_CLOCKS);
+  encoder.setVelocity(0, 3, 0);
+  sendCommands(twin, encoder);
+  sendSteps(twin, 0, MINUTE_HAND, HAND_FORWARD, 2);
+  TEST_ASSERT_TRUE(twin.isCalibrating(0));
+
+  twin.settle();
+  uint16_t hour = twin.getPosition(0, HOUR_HAND);
+  twin.advance(1000000);
+  TEST_ASSERT_INT_WITHIN(1, hour + 3 * VELOCITY_UNIT, twin.getPosition(0, HOUR_HAND));
+  TEST_ASSERT_EQUAL(1, twin.getPosition(0, MINUTE_HAND));
+}
+
+void test_addressed_frames()
+{
+  DigitalTwin twin(TEST_CLOCKS, 2 * MIN_STEP_DELAY);
+  Frame addressed(1);
+  addressed.setInstruction(0, FRAME_MARKER_ADDRESSED);
+  addAddressedInstruction(addressed, 2, HAND_FORWARD);
+
+  // Before the enumeration no clock has the index
+  twin.send(addressed);
+  TEST_ASSERT_EQUAL(ADDRESS_BROADCAST, twin.getIndex(2));
+  TEST_ASSERT_EQUAL(0, twin.getPosition(2, MINUTE_HAND));
+
+  Frame enumeration;
+  encodeEnumeration(enumeration);
+  twin.send(enumeration);
+  TEST_ASSERT_EQUAL(2, twin.getIndex(2));
+  for (size_t i = 0; i < 10; i++)
+    twin.send(addressed);
+  TEST_ASSERT_EQUAL(10, twin.getPosition(2, MINUTE_HAND));
+  TEST_ASSERT_EQUAL(0, twin.getPosition(0, MINUTE_HAND));
+
+  addAddressedInstruction(addressed, FRAME_ADDRESS_BROADCAST, HAND_BACKWARD << 2);
+  twin.send(addressed);
+  twin.settle();
+  for (size_t clock = 0; clock < TEST_CLOCKS; clock++)
+    TEST_ASSERT_EQUAL(MAX_STEPS - 1, twin.getPosition(clock, HOUR_HAND));
+  TEST_ASSERT_EQUAL(11, twin.getPosition(2, MINUTE_HAND));
+}
+
+void test_telemetry()
+{
+  DigitalTwin twin(TEST_CLOCKS, 2 * MIN_STEP_DELAY);
+  Frame frame;
+  encodeEnumeration(frame);
+  twin.send(frame);
+  size_t clocks = 0;
+  TEST_ASSERT_TRUE(twin.receive(frame, 0));
+  TEST_ASSERT_TRUE(decodeEnumeration(frame, clocks));
+  TEST_ASSERT_EQUAL(TEST_CLOCKS, clocks);
+
+  sendSteps(twin, 2, HOUR_HAND, HAND_BACKWARD, 30);
+  sendSteps(twin, 3, MINUTE_HAND, HAND_FORWARD, 40);
+
+  // Instructions received while calibrating are dropped, except the last one
+  Frame calibrate(TEST_CLOCKS);
+  calibrate.setHand(3, HOUR_HAND, HAND_CALIBRATE);
+  twin.send(calibrate);
+  sendSteps(twin, 3, MINUTE_HAND, HAND_FORWARD, 3);
+
+  encodeTelemetryRequest(frame, 2, 2);
+  twin.apply(frame);
+  TEST_ASSERT_TRUE(twin.receive(frame, 0));
+  ClockTelemetry telemetry;
+  TEST_ASSERT_TRUE(decodeTelemetry(frame, 0, telemetry));
+  TEST_ASSERT_EQUAL(MAX_STEPS - 30, telemetry.positions[HOUR_HAND]);
+  TEST_ASSERT_EQUAL(0, telemetry.positions[MINUTE_HAND]);
+  TEST_ASSERT_EQUAL(0, telemetry.dropped_instructions);
+  TEST_ASSERT_TRUE(decodeTelemetry(frame, 1, telemetry));
+  TEST_ASSERT_EQUAL(0, telemetry.positions[MINUTE_HAND]);
+  TEST_ASSERT_EQUAL(2, telemetry.dropped_instructions);
+  TEST_ASSERT_FALSE(twin.receive(frame, 0));
+}
+
+void test_plan_from_twin()
+{
+  DigitalTwin twin(TEST_CLOCKS, 2 * MIN_STEP_DELAY);
+  MotionPlanner planner(TEST_CLOCKS, MAX_STEPS);
+  uint16_t current[TEST_CLOCKS * 2];
+  uint16_t target[TEST_CLOCKS * 2];
+  for (size_t i = 0; i < TEST_CLOCKS * 2; i++)
+    target[i] = i * 100;
+
+  twin.getPositions(current);
+  planner.plan(current, target);
+  Frame frame;
+  while (planner.hasNextFrame())
+  {
+    planner.nextFrame(frame);
+    twin.send(frame);
+  }
+
+  twin.getPositions(current);
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(target, current, TEST_CLOCKS * 2);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_follows_frames);
+  RUN_TEST(test_step_rate_limit);
+  RUN_TEST(test_step_pacing);
+  RUN_TEST(test_tuned_motor);
+  RUN_TEST(test_calibration);
+  RUN_TEST(test_recalibration_after_lost_steps);
+  RUN_TEST(test_recalibrations_wrap);
+  RUN_TEST(test_speed_governor);
+  RUN_TEST(test_velocity_command);
+  RUN_TEST(test_macro);
+  RUN_TEST(test_marker_arguments_while_busy);
+  RUN_TEST(test_command_while_busy);
+  RUN_TEST(test_addressed_frames);
+  RUN_TEST(test_telemetry);
+  RUN_TEST(test_plan_from_twin);
+
+  UNITY_END();
+}
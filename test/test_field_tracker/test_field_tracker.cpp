@@ -0,0 +1,100 @@
+#include <unity.h>
+#include "FieldTracker.h"
+#include "Config.h"
+
+#define TEST_FIELD_WIDTH (4 * MIN_WIDTH_FOR_RECALIBRATION)
+
+// Enters the field at enter and leaves it at leave
+bool cross(FieldTracker &tracker, size_t enter, size_t leave, bool forward, FieldCrossing &crossing)
+{
+  FieldEdge edge;
+  edge.forward = forward;
+  edge.position = enter;
+  edge.in_field = true;
+  TEST_ASSERT_FALSE(tracker.processEdge(edge, crossing));
+  edge.position = leave;
+  edge.in_field = false;
+  return tracker.processEdge(edge, crossing);
+}
+
+// Calibrated in the center of the field, the first field is left backwards
+void startCalibrated(FieldTracker &tracker)
+{
+  tracker.reset(TEST_FIELD_WIDTH, true, 0, false);
+  FieldEdge edge = {MAX_STEPS - TEST_FIELD_WIDTH / 2, false, false};
+  FieldCrossing crossing;
+  TEST_ASSERT_FALSE(tracker.processEdge(edge, crossing));
+}
+
+void test_clean_crossing()
+{
+  FieldTracker tracker;
+  startCalibrated(tracker);
+
+  FieldCrossing crossing;
+  TEST_ASSERT_TRUE(cross(tracker, MAX_STEPS - TEST_FIELD_WIDTH / 2, TEST_FIELD_WIDTH / 2, true, crossing));
+  TEST_ASSERT_EQUAL(0, crossing.steps_off);
+  TEST_ASSERT_FALSE(crossing.lost_steps);
+
+  // Turned back in the field and left on the same side
+  FieldEdge edge = {TEST_FIELD_WIDTH / 2, false, true};
+  TEST_ASSERT_FALSE(tracker.processEdge(edge, crossing));
+  edge.position = TEST_FIELD_WIDTH / 2 - 1;
+  edge.forward = true;
+  edge.in_field = false;
+  TEST_ASSERT_FALSE(tracker.processEdge(edge, crossing));
+}
+
+void test_lost_steps()
+{
+  FieldTracker tracker;
+  startCalibrated(tracker);
+
+  // The hand is further than the position says
+  size_t off = MIN_STEPS_OFF_FOR_RECALIBRATION + 2;
+  FieldCrossing crossing;
+  TEST_ASSERT_TRUE(cross(tracker, MAX_STEPS - TEST_FIELD_WIDTH / 2 - off, TEST_FIELD_WIDTH / 2 - off, true, crossing));
+  TEST_ASSERT_EQUAL(off, crossing.steps_off);
+  TEST_ASSERT_TRUE(crossing.lost_steps);
+  TEST_ASSERT_TRUE(crossing.correction_direction);
+
+  TEST_ASSERT_TRUE(cross(tracker, TEST_FIELD_WIDTH / 2 + off, MAX_STEPS - TEST_FIELD_WIDTH / 2 + off, false, crossing));
+  TEST_ASSERT_EQUAL(off, crossing.steps_off);
+  TEST_ASSERT_FALSE(crossing.correction_direction);
+}
+
+void test_width_outliers()
+{
+  FieldTracker tracker;
+  startCalibrated(tracker);
+
+  // A wider field is rejected, until it was measured FIELD_MODEL_MAX_OUTLIERS times
+  size_t wider = TEST_FIELD_WIDTH / 2 + FIELD_WIDTH_TOLERANCE + 2;
+  FieldCrossing crossing;
+  for (size_t i = 0; i < FIELD_MODEL_MAX_OUTLIERS; i++)
+    TEST_ASSERT_FALSE(cross(tracker, MAX_STEPS - wider, wider, true, crossing));
+  TEST_ASSERT_TRUE(cross(tracker, MAX_STEPS - wider, wider, true, crossing));
+  TEST_ASSERT_EQUAL(0, crossing.steps_off);
+
+  // The model of the other direction is unchanged
+  TEST_ASSERT_FALSE(cross(tracker, wider, MAX_STEPS - wider, false, crossing));
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_clean_crossing);
+  RUN_TEST(test_lost_steps);
+  RUN_TEST(test_width_outliers);
+
+  UNITY_END();
+}
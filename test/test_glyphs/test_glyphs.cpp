@@ -0,0 +1,130 @@
+#include <unity.h>
+#include "TextDisplay.h"
+#include "DigitalTwin.h"
+#include "Config.h"
+
+#define TEST_COLUMNS 8
+#define TEST_ROWS 3
+#define TEST_CLOCKS (TEST_COLUMNS * TEST_ROWS)
+
+void playAll(TextDisplay &display, DigitalTwin &twin)
+{
+  Frame frame;
+  while (display.hasNextFrame())
+  {
+    display.nextFrame(frame);
+    twin.send(frame);
+  }
+  twin.settle();
+}
+
+void assertShows(TextDisplay &display, TransitionCache &cache, size_t block, char character)
+{
+  uint16_t pose[GLYPH_CLOCKS * 2];
+  uint16_t positions[TEST_CLOCKS * 2];
+  cache.getPose(*findGlyph(character), pose);
+  display.getPositions(positions);
+
+  for (size_t clock = 0; clock < GLYPH_CLOCKS; clock++)
+  {
+    size_t column = block * GLYPH_COLUMNS + clock % GLYPH_COLUMNS;
+    size_t row = clock / GLYPH_COLUMNS;
+    size_t wall_clock = display.getClock(column, row);
+    TEST_ASSERT_EQUAL(pose[clock * 2 + HOUR_HAND], positions[wall_clock * 2 + HOUR_HAND]);
+    TEST_ASSERT_EQUAL(pose[clock * 2 + MINUTE_HAND], positions[wall_clock * 2 + MINUTE_HAND]);
+  }
+}
+
+void test_glyph_table()
+{
+  for (char digit = '0'; digit <= '9'; digit++)
+  {
+    TEST_ASSERT_TRUE(findGlyph(digit) != NULL);
+  }
+  TEST_ASSERT_TRUE(findGlyph(' ') != NULL);
+  TEST_ASSERT_TRUE(findGlyph('#') == NULL);
+  TEST_ASSERT_EQUAL('0', getGlyph(0)->character);
+  TEST_ASSERT_TRUE(getGlyph(getGlyphCount()) == NULL);
+}
+
+void test_precompute()
+{
+  TransitionCache cache(MAX_STEPS);
+  TEST_ASSERT_EQUAL(100, cache.precompute("0123456789"));
+  TEST_ASSERT_EQUAL(100, cache.getMisses());
+
+  const Transition &same = cache.get(*findGlyph('5'), *findGlyph('5'));
+  TEST_ASSERT_EQUAL(0, same.frames);
+  const Transition &transition = cache.get(*findGlyph('1'), *findGlyph('8'));
+  TEST_ASSERT_TRUE(transition.frames > 0 && transition.frames <= MAX_STEPS / 2);
+  TEST_ASSERT_EQUAL(2, cache.getHits());
+  TEST_ASSERT_EQUAL(100, cache.getMisses());
+}
+
+void test_show_time()
+{
+  TransitionCache cache(MAX_STEPS);
+  cache.precompute("0123456789 ");
+  TextDisplay display(cache, TEST_COLUMNS, TEST_ROWS);
+  DigitalTwin twin(TEST_CLOCKS, 2 * MIN_STEP_DELAY);
+  TEST_ASSERT_EQUAL(4, display.getBlocks());
+
+  // After the startup no block shows a glyph, the first text is planned from the positions
+  TEST_ASSERT_EQUAL(4, display.show("12"));
+  playAll(display, twin);
+  assertShows(display, cache, 0, '1');
+  assertShows(display, cache, 1, '2');
+  assertShows(display, cache, 3, ' ');
+
+  // Time updates only use cached transitions
+  unsigned long misses = cache.getMisses();
+  TEST_ASSERT_EQUAL(2, display.show("1259"));
+  TEST_ASSERT_TRUE(display.hasNextFrame());
+  playAll(display, twin);
+  TEST_ASSERT_EQUAL(misses, cache.getMisses());
+  assertShows(display, cache, 2, '5');
+  assertShows(display, cache, 3, '9');
+
+  // The frames move the clocks exactly to the poses
+  uint16_t expected[TEST_CLOCKS * 2];
+  uint16_t actual[TEST_CLOCKS * 2];
+  display.getPositions(expected);
+  twin.getPositions(actual);
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(expected, actual, TEST_CLOCKS * 2);
+}
+
+void test_show_while_moving()
+{
+  TransitionCache cache(MAX_STEPS);
+  TextDisplay display(cache, TEST_COLUMNS, TEST_ROWS);
+  display.show("0000");
+  Frame frame;
+  for (size_t i = 0; i < 100; i++)
+    display.nextFrame(frame);
+
+  display.show("8888");
+  while (display.hasNextFrame())
+    display.nextFrame(frame);
+  assertShows(display, cache, 0, '8');
+  assertShows(display, cache, 3, '8');
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_glyph_table);
+  RUN_TEST(test_precompute);
+  RUN_TEST(test_show_time);
+  RUN_TEST(test_show_while_moving);
+
+  UNITY_END();
+}
@@ -0,0 +1,112 @@
+#include <unity.h>
+#include "MotionPlanner.h"
+
+#define TEST_CLOCKS 24
+#define TEST_STEPS 1000
+
+void test_shortest_direction()
+{
+  MotionPlanner planner(1, TEST_STEPS);
+  uint16_t current[2] = {990, 100};
+  uint16_t target[2] = {10, 50};
+
+  TEST_ASSERT_EQUAL(50, planner.plan(current, target));
+  TEST_ASSERT_EQUAL(20, planner.getSteps(0, HOUR_HAND));
+  TEST_ASSERT_EQUAL(-50, planner.getSteps(0, MINUTE_HAND));
+}
+
+void test_direction_policy()
+{
+  MotionPlanner planner(1, TEST_STEPS);
+  planner.setDirectionPolicy(ALWAYS_BACKWARD);
+  uint16_t current[2] = {990, 100};
+  uint16_t target[2] = {10, 50};
+
+  TEST_ASSERT_EQUAL(980, planner.plan(current, target));
+  TEST_ASSERT_EQUAL(-980, planner.getSteps(0, HOUR_HAND));
+  TEST_ASSERT_EQUAL(-50, planner.getSteps(0, MINUTE_HAND));
+}
+
+void replay(MotionPlanner &planner, long *moved, size_t *last_frame)
+{
+  Frame frame;
+  size_t index = 0;
+  while (planner.hasNextFrame())
+  {
+    planner.nextFrame(frame);
+    for (size_t clock = 0; clock < TEST_CLOCKS; clock++)
+    {
+      for (size_t hand = 0; hand < 2; hand++)
+      {
+        HandInstruction instruction = frame.getHand(clock, (Hand)hand);
+        if (instruction == HAND_STILL)
+          continue;
+        moved[clock * 2 + hand] += instruction == HAND_FORWARD ? 1 : -1;
+        last_frame[clock * 2 + hand] = index;
+      }
+    }
+    index++;
+  }
+}
+
+void test_goals()
+{
+  uint16_t current[TEST_CLOCKS * 2];
+  uint16_t target[TEST_CLOCKS * 2];
+  for (size_t i = 0; i < TEST_CLOCKS * 2; i++)
+  {
+    current[i] = i * 20;
+    target[i] = (i * 20 + 1000 - i * 7) % TEST_STEPS;
+  }
+
+  PlanGoal goals[2] = {MINIMIZE_FRAMES, FINISH_TOGETHER};
+  for (size_t g = 0; g < 2; g++)
+  {
+    MotionPlanner planner(TEST_CLOCKS, TEST_STEPS);
+    planner.setGoal(goals[g]);
+    size_t frames = planner.plan(current, target);
+    TEST_ASSERT_EQUAL((TEST_CLOCKS * 2 - 1) * 7, frames);
+
+    long moved[TEST_CLOCKS * 2] = {};
+    size_t last_frame[TEST_CLOCKS * 2] = {};
+    replay(planner, moved, last_frame);
+
+    for (size_t i = 1; i < TEST_CLOCKS * 2; i++)
+    {
+      TEST_ASSERT_EQUAL(-(long)i * 7, moved[i]);
+      if (goals[g] == FINISH_TOGETHER)
+        TEST_ASSERT_EQUAL(frames - 1, last_frame[i]);
+      else
+        TEST_ASSERT_EQUAL(i * 7 - 1, last_frame[i]);
+    }
+  }
+}
+
+void test_angle_to_steps()
+{
+  MotionPlanner planner(1, TEST_STEPS);
+  TEST_ASSERT_EQUAL(0, planner.angleToSteps(0));
+  TEST_ASSERT_EQUAL(250, planner.angleToSteps(90));
+  TEST_ASSERT_EQUAL(750, planner.angleToSteps(-90));
+  TEST_ASSERT_EQUAL(0, planner.angleToSteps(360));
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_shortest_direction);
+  RUN_TEST(test_direction_policy);
+  RUN_TEST(test_goals);
+  RUN_TEST(test_angle_to_steps);
+
+  UNITY_END();
+}
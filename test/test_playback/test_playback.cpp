@@ -0,0 +1,375 @@
+#include <unity.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "PlaybackEngine.h"
+#include "ChainSimulator.h"
+#include "CommandEncoder.h"
+#include "DigitalTwin.h"
+#include "MotionPlanner.h"
+#include "SerialOutput.h"
+
+#define TEST_CLOCKS 24
+#define TEST_FRAMES 200
+#define TEST_FRAME_PERIOD 500
+
+// Numbers the frames by the instruction of the first clocks
+class CountingSource : public FrameSource
+{
+public:
+  CountingSource(size_t frames, useconds_t delay) : frames(frames), delay(delay), index(0)
+  {
+  }
+
+  bool next(Frame &frame) override
+  {
+    if (this->index == this->frames)
+      return false;
+    if (this->delay > 0)
+      usleep(this->delay);
+
+    frame = Frame(TEST_CLOCKS);
+    frame.setInstruction(0, this->index & 0x0F);
+    frame.setInstruction(1, (this->index >> 4) & 0x0F);
+    frame.setInstruction(2, 0x1);
+    this->index++;
+    return true;
+  }
+
+private:
+  size_t frames;
+  useconds_t delay;
+  size_t index;
+};
+
+class RecordingOutput : public FrameOutput
+{
+public:
+  RecordingOutput() : count(0), in_order(true)
+  {
+  }
+
+  bool send(const Frame &frame) override
+  {
+    size_t index = frame.getInstruction(0) | (frame.getInstruction(1) << 4);
+    this->in_order = this->in_order && index == (this->count & 0xFF);
+    this->count++;
+    return true;
+  }
+
+  size_t count;
+  bool in_order;
+};
+
+// Fails to send every second frame
+class FailingOutput : public FrameOutput
+{
+public:
+  FailingOutput() : count(0)
+  {
+  }
+
+  bool send(const Frame &frame) override
+  {
+    return this->count++ % 2 == 0;
+  }
+
+  size_t count;
+};
+
+void test_ring()
+{
+  FrameRing<4> ring;
+  Frame frame(2);
+  TEST_ASSERT_EQUAL(0, ring.size());
+  for (size_t i = 0; i < 3; i++)
+  {
+    frame.setInstruction(0, i);
+    TEST_ASSERT_TRUE(ring.push(frame));
+  }
+  TEST_ASSERT_TRUE(ring.isFull());
+  TEST_ASSERT_FALSE(ring.push(frame));
+
+  for (size_t i = 0; i < 3; i++)
+  {
+    TEST_ASSERT_TRUE(ring.pop(frame));
+    TEST_ASSERT_EQUAL(i, frame.getInstruction(0));
+  }
+  TEST_ASSERT_FALSE(ring.pop(frame));
+}
+
+void test_playback_in_order()
+{
+  CountingSource source(TEST_FRAMES, 0);
+  RecordingOutput output;
+  PlaybackEngine engine(source, output, TEST_FRAME_PERIOD);
+
+  TEST_ASSERT_TRUE(engine.start());
+  engine.wait();
+
+  PlaybackStats stats = engine.getStats();
+  TEST_ASSERT_EQUAL(TEST_FRAMES, stats.frames);
+  TEST_ASSERT_EQUAL(TEST_FRAMES, output.count);
+  TEST_ASSERT_TRUE(output.in_order);
+  TEST_ASSERT_EQUAL(0, stats.errors);
+}
+
+void test_playback_errors()
+{
+  CountingSource source(TEST_FRAMES, 0);
+  FailingOutput output;
+  PlaybackEngine engine(source, output, TEST_FRAME_PERIOD);
+
+  TEST_ASSERT_TRUE(engine.start());
+  engine.wait();
+
+  PlaybackStats stats = engine.getStats();
+  TEST_ASSERT_EQUAL(TEST_FRAMES, output.count);
+  TEST_ASSERT_EQUAL(TEST_FRAMES / 2, stats.frames);
+  TEST_ASSERT_EQUAL(TEST_FRAMES / 2, stats.errors);
+}
+
+void test_planner_waits_for_slow_output()
+{
+  // The ring is full for seconds with a long frame period, the planner must sleep meanwhile
+  CountingSource source(PLAYBACK_RING_SIZE + 10, 0);
+  RecordingOutput output;
+  PlaybackEngine engine(source, output, 20000);
+
+  struct timespec cpu_start, cpu_end;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_start);
+  TEST_ASSERT_TRUE(engine.start());
+  usleep(300000);
+  engine.stop();
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_end);
+
+  uint64_t cpu_micros = (cpu_end.tv_sec - cpu_start.tv_sec) * 1000000LL + (cpu_end.tv_nsec - cpu_start.tv_nsec) / 1000;
+  TEST_ASSERT_TRUE(cpu_micros < 100000);
+  TEST_ASSERT_TRUE(output.in_order);
+}
+
+void test_playback_underruns()
+{
+  // The source is slower than the frame period
+  CountingSource source(20, TEST_FRAME_PERIOD * 3);
+  RecordingOutput output;
+  PlaybackEngine engine(source, output, TEST_FRAME_PERIOD);
+
+  TEST_ASSERT_TRUE(engine.start());
+  engine.wait();
+
+  PlaybackStats stats = engine.getStats();
+  TEST_ASSERT_EQUAL(20, output.count);
+  TEST_ASSERT_TRUE(output.in_order);
+  TEST_ASSERT_TRUE(stats.underruns > 0);
+}
+
+// Moves every hand by a different number of steps
+uint32_t simulateChains(size_t chains, uint16_t *positions)
+{
+  DigitalTwin twin(TEST_CLOCKS, 5000);
+  ChainTiming timing;
+  ChainSimulator simulator(ChainLayout(TEST_CLOCKS, chains), timing, &twin);
+  MotionPlanner planner(TEST_CLOCKS, 3414);
+  uint16_t current[TEST_CLOCKS * 2] = {0};
+  uint16_t target[TEST_CLOCKS * 2];
+  for (size_t i = 0; i < TEST_CLOCKS * 2; i++)
+    target[i] = i * 7 + 1;
+
+  planner.plan(current, target);
+  Frame frame;
+  TEST_ASSERT_TRUE(simulator.begin());
+  while (planner.hasNextFrame())
+  {
+    planner.nextFrame(frame);
+    TEST_ASSERT_TRUE(simulator.send(frame));
+  }
+  simulator.end();
+  twin.settle();
+  twin.getPositions(positions);
+
+  ChainSimulatorStats stats = simulator.getStats();
+  TEST_ASSERT_EQUAL(planner.getFrames(), stats.frames);
+  TEST_ASSERT_EQUAL(timing.getLatencyMicros(TEST_CLOCKS / chains - 1), stats.max_latency);
+  return stats.max_frame_micros;
+}
+
+void test_parallel_chains()
+{
+  uint16_t single[TEST_CLOCKS * 2];
+  uint16_t parallel[TEST_CLOCKS * 2];
+  uint32_t single_micros = simulateChains(1, single);
+  uint32_t parallel_micros = simulateChains(4, parallel);
+
+  // Same positions, but the bus time of the instructions is 4 times shorter
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(single, parallel, TEST_CLOCKS * 2);
+  ChainTiming timing;
+  TEST_ASSERT_EQUAL(4 * (parallel_micros - timing.frame_gap), single_micros - timing.frame_gap);
+}
+
+// The chain head end of a pseudo terminal: passes the frames SerialOutput writes on to a twin, like the chain head clocks them out
+class PseudoChainHead
+{
+public:
+  PseudoChainHead(DigitalTwin &twin) : twin(twin), frames(0)
+  {
+    this->fd = posix_openpt(O_RDWR | O_NOCTTY);
+    grantpt(this->fd);
+    unlockpt(this->fd);
+  }
+
+  ~PseudoChainHead()
+  {
+    close(this->fd);
+  }
+
+  const char *getPort() const
+  {
+    return ptsname(this->fd);
+  }
+
+  void acknowledge(size_t frames)
+  {
+    for (size_t i = 0; i < frames; i++)
+    {
+      uint8_t ack = SERIAL_ACK;
+      TEST_ASSERT_EQUAL(1, write(this->fd, &ack, 1));
+    }
+  }
+
+  // Sends the encoded commands through a SerialOutput and applies the received frames
+  void sendCommands(CommandEncoder &encoder)
+  {
+    SerialOutput output(this->getPort());
+    TEST_ASSERT_TRUE(output.begin());
+    this->acknowledge(encoder.getRemainingFrames());
+    Frame frame;
+    while (encoder.hasNextFrame())
+    {
+      encoder.nextFrame(frame);
+      TEST_ASSERT_TRUE(output.send(frame));
+    }
+    this->receive();
+    output.end();
+  }
+
+  void receive()
+  {
+    uint8_t buffer[MAX_COMMAND_FRAMES * MAX_SERIALIZED_FRAME_BYTES];
+    size_t size = 0;
+    struct pollfd request = {this->fd, POLLIN, 0};
+    while (size < sizeof(buffer) && poll(&request, 1, 50) > 0)
+    {
+      ssize_t count = read(this->fd, buffer + size, sizeof(buffer) - size);
+      if (count <= 0)
+        break;
+      size += count;
+    }
+
+    size_t offset = 0;
+    Frame frame;
+    while (offset < size && frame.deserialize(buffer + offset, size - offset))
+    {
+      this->twin.send(frame);
+      this->frames++;
+      offset += 2 + frame.getSize();
+    }
+    TEST_ASSERT_EQUAL(size, offset);
+  }
+
+  DigitalTwin &twin;
+  size_t frames;
+
+private:
+  int fd;
+};
+
+void test_serial_velocity_command()
+{
+  // Every argument of the second and fourth frame is 0, a skipped frame would shift the arguments
+  DigitalTwin twin(2, 2 * MIN_STEP_DELAY);
+  PseudoChainHead chain_head(twin);
+  CommandEncoder encoder(2);
+  encoder.setVelocity(0, 1, 2);
+  encoder.setVelocity(1, 1, -2);
+  chain_head.sendCommands(encoder);
+  TEST_ASSERT_EQUAL(2 + getCommandLength(COMMAND_VELOCITY), chain_head.frames);
+
+  twin.advance(1000000);
+  TEST_ASSERT_INT_WITHIN(1, VELOCITY_UNIT, twin.getPosition(0, HOUR_HAND));
+  TEST_ASSERT_INT_WITHIN(1, 2 * VELOCITY_UNIT, twin.getPosition(0, MINUTE_HAND));
+  TEST_ASSERT_INT_WITHIN(1, MAX_STEPS - 2 * VELOCITY_UNIT, twin.getPosition(1, MINUTE_HAND));
+}
+
+void test_serial_macro_upload()
+{
+  // Most nibbles of the 16 bit words are 0
+  DigitalTwin twin(3, 2 * MIN_STEP_DELAY);
+  PseudoChainHead chain_head(twin);
+  CommandEncoder encoder(3);
+  encoder.storeMacroMove(2, 1, 0, 16, -2, 32);
+  chain_head.sendCommands(encoder);
+  twin.advance(MACRO_STORE_PAUSE);
+  encoder.clear();
+  encoder.playMacro(2, 1);
+  chain_head.sendCommands(encoder);
+  TEST_ASSERT_EQUAL(2 + getCommandLength(COMMAND_MACRO_STORE) + 2 + getCommandLength(COMMAND_MACRO_PLAY), chain_head.frames);
+
+  twin.advance(40 * MACRO_FRAME_PERIOD);
+  twin.settle();
+  TEST_ASSERT_EQUAL(16, twin.getPosition(2, HOUR_HAND));
+  TEST_ASSERT_EQUAL(MAX_STEPS - 2, twin.getPosition(2, MINUTE_HAND));
+  TEST_ASSERT_EQUAL(0, twin.getPosition(1, HOUR_HAND));
+}
+
+void test_serial_timing_command()
+{
+  // The upper nibbles of both values are 0 for every clock, whole frames are 0
+  DigitalTwin twin(4, 2 * MIN_STEP_DELAY);
+  PseudoChainHead chain_head(twin);
+  CommandEncoder encoder(4);
+  for (size_t clock = 0; clock < 4; clock++)
+    encoder.setTiming(clock, 2, 150);
+  chain_head.sendCommands(encoder);
+  TEST_ASSERT_EQUAL(2 + getCommandLength(COMMAND_TIMING), chain_head.frames);
+  for (size_t clock = 0; clock < 4; clock++)
+  {
+    TEST_ASSERT_EQUAL(2, twin.getTiming(clock).clock_out_high);
+    TEST_ASSERT_EQUAL(150, twin.getTiming(clock).frame_gap);
+    TEST_ASSERT_TRUE(twin.getTiming(clock).trial);
+  }
+
+  encoder.clear();
+  for (size_t clock = 0; clock < 4; clock++)
+    encoder.keepTiming(clock);
+  chain_head.sendCommands(encoder);
+  twin.advance(2 * TIMING_TRIAL_PERIOD * 1000ULL);
+  TEST_ASSERT_EQUAL(150, twin.getTiming(3).frame_gap);
+  TEST_ASSERT_FALSE(twin.getTiming(3).trial);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_ring);
+  RUN_TEST(test_playback_in_order);
+  RUN_TEST(test_playback_errors);
+  RUN_TEST(test_playback_underruns);
+  RUN_TEST(test_planner_waits_for_slow_output);
+  RUN_TEST(test_parallel_chains);
+  RUN_TEST(test_serial_velocity_command);
+  RUN_TEST(test_serial_macro_upload);
+  RUN_TEST(test_serial_timing_command);
+
+  UNITY_END();
+}
@@ -0,0 +1,161 @@
+#include <unity.h>
+#include "Scheduler.h"
+#include "Config.h"
+
+#define TEST_LOOP_TIME 10    // us, of a loop() without a task
+#define TEST_TASK_TIME 20    // us, of a short task
+#define TEST_STEP_DELAY 1000 // us, of a moving motor
+
+// Simulated micros(), the tasks advance it by their runtime
+static unsigned long now;
+static unsigned long step_delay;
+static unsigned long late_steps;
+static unsigned long next_step;
+static unsigned long runs[4];
+static unsigned long calibration_time; // us, runtime of the next calibration task
+
+static unsigned long clock()
+{
+  return now;
+}
+
+static unsigned long stepMotors()
+{
+  if (step_delay != 0 && now > next_step + TEST_TASK_TIME)
+    late_steps++;
+  now += TEST_TASK_TIME;
+  runs[PRIORITY_STEP]++;
+  if (step_delay == 0)
+    return SCHEDULER_MAX_DELAY;
+  next_step = now + step_delay;
+  return step_delay;
+}
+
+static unsigned long tickCommunication()
+{
+  now += TEST_TASK_TIME;
+  runs[PRIORITY_COMM]++;
+  return DELAY_BETWEEN_INSTRUCTIONS / 2;
+}
+
+static unsigned long checkCalibration()
+{
+  now += calibration_time;
+  calibration_time = TEST_TASK_TIME;
+  runs[PRIORITY_CALIBRATION]++;
+  return CALIBRATION_TASK_INTERVAL;
+}
+
+static unsigned long parkMotors()
+{
+  now += PARK_WORST_CASE;
+  runs[PRIORITY_BACKGROUND]++;
+  return PARK_TASK_INTERVAL;
+}
+
+static uint8_t addTasks(Scheduler &scheduler)
+{
+  scheduler.add(stepMotors, PRIORITY_STEP);
+  scheduler.add(tickCommunication, PRIORITY_COMM, 0, true);
+  uint8_t calibration_task = scheduler.add(checkCalibration, PRIORITY_CALIBRATION, 0, true);
+  scheduler.add(parkMotors, PRIORITY_BACKGROUND, PARK_WORST_CASE);
+  return calibration_task;
+}
+
+static void runFor(Scheduler &scheduler, unsigned long duration)
+{
+  unsigned long end = now + duration;
+  while (now < end)
+  {
+    if (!scheduler.run())
+      now += TEST_LOOP_TIME;
+  }
+}
+
+void test_background_task_runs_while_idle()
+{
+  Scheduler scheduler(clock);
+  addTasks(scheduler);
+  runFor(scheduler, 2000000);
+
+  // Polled every PARK_TASK_INTERVAL plus its runtime, although the polling tasks are due every few 100 us
+  TEST_ASSERT_TRUE(runs[PRIORITY_BACKGROUND] >= 2000000 / (PARK_TASK_INTERVAL + PARK_WORST_CASE));
+  TEST_ASSERT_TRUE(runs[PRIORITY_COMM] > 2000000 / DELAY_BETWEEN_INSTRUCTIONS);
+  TEST_ASSERT_TRUE(runs[PRIORITY_CALIBRATION] > 1000);
+}
+
+void test_background_task_waits_for_steps()
+{
+  Scheduler scheduler(clock);
+  addTasks(scheduler);
+  step_delay = TEST_STEP_DELAY;
+  runFor(scheduler, 2000000);
+
+  TEST_ASSERT_EQUAL(0, runs[PRIORITY_BACKGROUND]);
+  TEST_ASSERT_EQUAL(0, late_steps);
+  TEST_ASSERT_TRUE(runs[PRIORITY_STEP] > 2000000 / (TEST_STEP_DELAY + TEST_TASK_TIME) - 10);
+  TEST_ASSERT_TRUE(runs[PRIORITY_CALIBRATION] > 1000);
+
+  // Runs once the motors stopped
+  step_delay = 0;
+  runFor(scheduler, PARK_TASK_INTERVAL + PARK_WORST_CASE);
+  TEST_ASSERT_TRUE(runs[PRIORITY_BACKGROUND] > 0);
+  TEST_ASSERT_EQUAL(0, late_steps);
+}
+
+void test_stretched_run_is_forgotten()
+{
+  Scheduler scheduler(clock);
+  uint8_t calibration_task = addTasks(scheduler);
+
+  // A fast chain leaves less slack between two steps than the stretched run took
+  step_delay = 200;
+  calibration_time = 300;
+  runFor(scheduler, 10 * SCHEDULER_WORST_CASE_WINDOW);
+  TEST_ASSERT_EQUAL(TEST_TASK_TIME, scheduler.getWorstCase(calibration_task));
+  TEST_ASSERT_TRUE(runs[PRIORITY_CALIBRATION] > 10 * SCHEDULER_WORST_CASE_WINDOW / CALIBRATION_TASK_INTERVAL / 2);
+  TEST_ASSERT_EQUAL(1, late_steps); // only by the stretched run itself
+}
+
+void test_measured_runtime_is_capped()
+{
+  Scheduler scheduler(clock);
+  uint8_t calibration_task = addTasks(scheduler);
+
+  step_delay = TEST_STEP_DELAY;
+  calibration_time = 5000;
+  runFor(scheduler, SCHEDULER_WORST_CASE_WINDOW / 2);
+  TEST_ASSERT_EQUAL(SCHEDULER_MAX_MEASURED, scheduler.getWorstCase(calibration_task));
+
+  // Still fits between two steps
+  unsigned long calibrations = runs[PRIORITY_CALIBRATION];
+  runFor(scheduler, 100 * CALIBRATION_TASK_INTERVAL);
+  TEST_ASSERT_TRUE(runs[PRIORITY_CALIBRATION] - calibrations > 50);
+}
+
+void setUp(void)
+{
+  now = 0;
+  step_delay = 0;
+  late_steps = 0;
+  next_step = 0;
+  calibration_time = TEST_TASK_TIME;
+  for (size_t i = 0; i < 4; i++)
+    runs[i] = 0;
+}
+
+void tearDown(void)
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_background_task_runs_while_idle);
+  RUN_TEST(test_background_task_waits_for_steps);
+  RUN_TEST(test_stretched_run_is_forgotten);
+  RUN_TEST(test_measured_runtime_is_capped);
+
+  UNITY_END();
+}
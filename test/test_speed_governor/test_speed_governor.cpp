@@ -0,0 +1,71 @@
+#include <unity.h>
+#include "SpeedGovernor.h"
+#include "Config.h"
+
+#define TEST_MIN_STEP_DELAY 800
+
+void test_derate_after_lost_steps()
+{
+  SpeedGovernor governor;
+  TEST_ASSERT_EQUAL(TEST_MIN_STEP_DELAY, governor.getStepDelay(TEST_MIN_STEP_DELAY));
+
+  governor.recordCrossing(MIN_STEPS_OFF_FOR_RECALIBRATION, TEST_MIN_STEP_DELAY, TEST_MIN_STEP_DELAY);
+  TEST_ASSERT_EQUAL(GOVERNOR_DERATE, governor.getDerate());
+  TEST_ASSERT_EQUAL(TEST_MIN_STEP_DELAY + GOVERNOR_DERATE, governor.getStepDelay(TEST_MIN_STEP_DELAY));
+
+  for (size_t i = 0; i < 2 * GOVERNOR_MAX_DERATE / GOVERNOR_DERATE; i++)
+    governor.recordCrossing(MAX_STEPS / 2, TEST_MIN_STEP_DELAY, TEST_MIN_STEP_DELAY);
+  TEST_ASSERT_EQUAL(GOVERNOR_MAX_DERATE, governor.getDerate());
+}
+
+void test_probe_after_clean_crossings()
+{
+  SpeedGovernor governor;
+  governor.recordCrossing(MIN_STEPS_OFF_FOR_RECALIBRATION, TEST_MIN_STEP_DELAY, TEST_MIN_STEP_DELAY);
+  unsigned int governed_delay = governor.getStepDelay(TEST_MIN_STEP_DELAY);
+
+  for (size_t i = 0; i < GOVERNOR_PROBE_CROSSINGS - 1; i++)
+    governor.recordCrossing(0, governed_delay, TEST_MIN_STEP_DELAY);
+  TEST_ASSERT_EQUAL(GOVERNOR_DERATE, governor.getDerate());
+
+  governor.recordCrossing(GOVERNOR_CLEAN_ERROR - 1, governed_delay, TEST_MIN_STEP_DELAY);
+  TEST_ASSERT_EQUAL(GOVERNOR_DERATE - GOVERNOR_PROBE_STEP, governor.getDerate());
+}
+
+void test_only_clean_crossings_at_speed_count()
+{
+  SpeedGovernor governor;
+  governor.recordCrossing(MIN_STEPS_OFF_FOR_RECALIBRATION, TEST_MIN_STEP_DELAY, TEST_MIN_STEP_DELAY);
+  unsigned int governed_delay = governor.getStepDelay(TEST_MIN_STEP_DELAY);
+
+  // Slow crossings do not prove anything
+  for (size_t i = 0; i < 2 * GOVERNOR_PROBE_CROSSINGS; i++)
+    governor.recordCrossing(0, 2 * governed_delay, TEST_MIN_STEP_DELAY);
+  TEST_ASSERT_EQUAL(GOVERNOR_DERATE, governor.getDerate());
+
+  // A crossing that is not clean starts counting again
+  for (size_t i = 0; i < GOVERNOR_PROBE_CROSSINGS - 1; i++)
+    governor.recordCrossing(0, governed_delay, TEST_MIN_STEP_DELAY);
+  governor.recordCrossing(GOVERNOR_CLEAN_ERROR, governed_delay, TEST_MIN_STEP_DELAY);
+  governor.recordCrossing(0, governed_delay, TEST_MIN_STEP_DELAY);
+  TEST_ASSERT_EQUAL(GOVERNOR_DERATE, governor.getDerate());
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_derate_after_lost_steps);
+  RUN_TEST(test_probe_after_clean_crossings);
+  RUN_TEST(test_only_clean_crossings_at_speed_count);
+
+  UNITY_END();
+}
@@ -0,0 +1,111 @@
+#include <unity.h>
+#include "Utils.h"
+#include "Config.h"
+
+void test_forward_diff()
+{
+  TEST_ASSERT_EQUAL(10, diff(20, 30, true));
+  TEST_ASSERT_EQUAL(10, diff(1650, 1660, true));
+  TEST_ASSERT_EQUAL(10, diff(1700, 5, true));
+}
+
+void test_backward_diff()
+{
+  TEST_ASSERT_EQUAL(10, diff(30, 20, false));
+  TEST_ASSERT_EQUAL(10, diff(1660, 1650, false));
+  TEST_ASSERT_EQUAL(10, diff(5, 1700, false));
+}
+
+void test_target_pos()
+{
+  TEST_ASSERT_EQUAL(100, calculateFieldLeavePosition(200, true));
+  TEST_ASSERT_EQUAL(1605, calculateFieldLeavePosition(200, false));
+  TEST_ASSERT_EQUAL(100, calculateFieldLeavePosition(201, true));
+  TEST_ASSERT_EQUAL(1605, calculateFieldLeavePosition(201, false));
+}
+
+void test_shortest_direction()
+{
+  TEST_ASSERT_EQUAL(true, getShortestDirection(0, 10));
+  TEST_ASSERT_EQUAL(true, getShortestDirection(1700, 10));
+  TEST_ASSERT_EQUAL(false, getShortestDirection(1600, 1500));
+  TEST_ASSERT_EQUAL(false, getShortestDirection(10, 1700));
+}
+
+void test_signed_position()
+{
+  TEST_ASSERT_EQUAL(0, toSignedPosition(0));
+  TEST_ASSERT_EQUAL(10, toSignedPosition(10));
+  TEST_ASSERT_EQUAL(-10, toSignedPosition(MAX_STEPS - 10));
+  TEST_ASSERT_EQUAL(MAX_STEPS / 2, toSignedPosition(MAX_STEPS / 2));
+}
+
+void test_step_pacing()
+{
+  TEST_ASSERT_EQUAL(5000, updatePlanInterval(4000, 8000));
+  TEST_ASSERT_EQUAL(3000, updatePlanInterval(4000, 0));
+  TEST_ASSERT_EQUAL(MIN_STEP_DELAY, updatePlanInterval(4000, PACING_MAX_INTERVAL + 1));
+
+  TEST_ASSERT_EQUAL(8000, calculateStepDelay(8000, 1));
+  TEST_ASSERT_EQUAL(8000, calculateStepDelay(8000, -1));
+  TEST_ASSERT_EQUAL(4000, calculateStepDelay(8000, PACING_BACKLOG + 1));
+  TEST_ASSERT_EQUAL(MIN_STEP_DELAY, calculateStepDelay(MIN_STEP_DELAY / 2, 1));
+  TEST_ASSERT_EQUAL(MIN_STEP_DELAY, calculateStepDelay(8000, 0));
+}
+
+void test_ramp_delay()
+{
+  // Not tuned: MIN_STEP_DELAY
+  TEST_ASSERT_EQUAL(MIN_STEP_DELAY, calculateRampDelay(MIN_STEP_DELAY / 2, MIN_STEP_DELAY, 0));
+
+  // Tuned: accelerates from MIN_STEP_DELAY after a standstill
+  TEST_ASSERT_EQUAL(MIN_STEP_DELAY - 20, calculateRampDelay(PACING_MAX_INTERVAL, MIN_STEP_DELAY / 2, 20));
+  TEST_ASSERT_EQUAL(MIN_STEP_DELAY / 2 + 10, calculateRampDelay(MIN_STEP_DELAY / 2 + 30, MIN_STEP_DELAY / 2, 20));
+  TEST_ASSERT_EQUAL(MIN_STEP_DELAY / 2, calculateRampDelay(MIN_STEP_DELAY / 2 + 10, MIN_STEP_DELAY / 2, 20));
+  TEST_ASSERT_EQUAL(MIN_STEP_DELAY + 100, calculateRampDelay(PACING_MAX_INTERVAL, MIN_STEP_DELAY + 100, 20));
+
+  TEST_ASSERT_EQUAL(MIN_STEP_DELAY / 2, calculateStepDelay(8000, 100, MIN_STEP_DELAY / 2));
+}
+
+void test_velocity_interval()
+{
+  TEST_ASSERT_EQUAL(0, calculateVelocityInterval(0));
+  TEST_ASSERT_EQUAL(2000, calculateVelocityInterval(500));
+  TEST_ASSERT_EQUAL(4000, calculateVelocityInterval(-250));
+}
+
+void test_valid_timing()
+{
+  TEST_ASSERT_TRUE(isValidTiming(CLOCK_OUT_HIGH, DELAY_BETWEEN_INSTRUCTIONS));
+  TEST_ASSERT_TRUE(isValidTiming(1, TIMING_MIN_FRAME_GAP));
+  TEST_ASSERT_FALSE(isValidTiming(0, DELAY_BETWEEN_INSTRUCTIONS));
+  TEST_ASSERT_FALSE(isValidTiming(CLOCK_OUT_HIGH, TIMING_MIN_FRAME_GAP - 1));
+  TEST_ASSERT_FALSE(isValidTiming(TIMING_MIN_FRAME_GAP, TIMING_MIN_FRAME_GAP));
+}
+
+void setUp(void)
+{
+  // set stuff up here
+}
+
+void tearDown(void)
+{
+  // clean stuff up here
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_forward_diff);
+  RUN_TEST(test_backward_diff);
+  RUN_TEST(test_target_pos);
+  RUN_TEST(test_shortest_direction);
+  RUN_TEST(test_signed_position);
+  RUN_TEST(test_step_pacing);
+  RUN_TEST(test_ramp_delay);
+  RUN_TEST(test_velocity_interval);
+  RUN_TEST(test_valid_timing);
+
+  UNITY_END();
+}
\ No newline at end of file